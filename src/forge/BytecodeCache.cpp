@@ -0,0 +1,348 @@
+//
+// BytecodeCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "BytecodeCache.hpp"
+#include <assert/assert.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <functional>
+#include <lua.hpp>
+#include <string.h>
+#include <stdio.h>
+
+using std::string;
+using boost::filesystem::path;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const char BYTECODE_FORMAT [] = "Forge Bytecode";
+static const int32_t BYTECODE_VERSION = 2;
+
+/**
+// The header at the start of a cache file.
+*/
+struct BytecodeHeader
+{
+    char format [16]; ///< The format identifier "Forge Bytecode" padded with nulls.
+    int32_t version; ///< The version of the cache file format.
+    uint32_t filename_size; ///< The size of the source filename that follows the header.
+    uint64_t source_size; ///< The size of the source file when it was compiled.
+    uint64_t source_hash; ///< The hash of the contents of the source file when it was compiled.
+    uint64_t bytecode_size; ///< The size of the bytecode that follows the source filename.
+    uint64_t bytecode_hash; ///< The hash of the bytecode that follows the source filename.
+};
+
+/**
+// Hash bytes with the 64 bit FNV-1a hash.
+*/
+static uint64_t hash_bytes( const char* data, size_t length )
+{
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    const uint64_t FNV_PRIME = 0x100000001b3ull;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for ( size_t i = 0; i < length; ++i )
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+// Find the start of the chunk in the contents of a file.
+//
+// As `luaL_loadfile()` does, a leading UTF-8 byte order mark is skipped and 
+// a first line starting with '#' is treated as a comment.  The newline 
+// that ends the comment is kept in text chunks so that line numbers are 
+// unchanged and skipped in binary chunks.
+//
+// @param source
+//  The contents of the file.
+//
+// @param binary
+//  Set to true if the chunk is a precompiled binary chunk.
+//
+// @return
+//  The offset of the start of the chunk.
+*/
+static size_t chunk_start( const std::string& source, bool* binary )
+{
+    SWEET_ASSERT( binary );
+    size_t start = 0;
+    if ( source.compare(0, 3, "\xEF\xBB\xBF") == 0 )
+    {
+        start = 3;
+    }
+    if ( start < source.size() && source[start] == '#' )
+    {
+        size_t newline = source.find( '\n', start );
+        start = newline != string::npos ? newline : source.size();
+        if ( start + 1 < source.size() && source[start + 1] == LUA_SIGNATURE[0] )
+        {
+            ++start;
+        }
+    }
+    *binary = start < source.size() && source[start] == LUA_SIGNATURE[0];
+    return start;
+}
+
+/**
+// Load a text or binary chunk read from a file.
+*/
+static int load_source( lua_State* lua_state, const std::string& source, const std::string& filename )
+{
+    bool binary = false;
+    size_t start = chunk_start( source, &binary );
+    string chunkname = string( "@" ) + filename;
+    return luaL_loadbufferx( lua_state, source.data() + start, source.size() - start, chunkname.c_str(), "bt" );
+}
+
+/**
+// Append a piece of a chunk dumped by `lua_dump()` to a string.
+*/
+static int append_bytecode( lua_State* /*lua_state*/, const void* data, size_t size, void* context )
+{
+    SWEET_ASSERT( context );
+    string* bytecode = reinterpret_cast<string*>( context );
+    bytecode->append( reinterpret_cast<const char*>(data), size );
+    return 0;
+}
+
+/**
+// Constructor.
+*/
+BytecodeCache::BytecodeCache()
+: directory_(),
+  hits_( 0 ),
+  misses_( 0 )
+{
+}
+
+/**
+// Get the directory that cache files are stored in.
+//
+// @return
+//  The directory or an empty path if caching is disabled.
+*/
+const boost::filesystem::path& BytecodeCache::directory() const
+{
+    return directory_;
+}
+
+/**
+// Get the number of chunks loaded from cache files.
+//
+// @return
+//  The number of chunks.
+*/
+int BytecodeCache::hits() const
+{
+    return hits_;
+}
+
+/**
+// Get the number of chunks compiled from source files.
+//
+// @return
+//  The number of chunks.
+*/
+int BytecodeCache::misses() const
+{
+    return misses_;
+}
+
+/**
+// Set the directory that cache files are stored in.
+//
+// @param directory
+//  The directory to store cache files in (created when the first cache file
+//  is written) or an empty path to disable caching.
+*/
+void BytecodeCache::set_directory( const boost::filesystem::path& directory )
+{
+    directory_ = directory;
+}
+
+/**
+// Load a Lua chunk from a file, using its cached bytecode when it is valid.
+//
+// @param lua_state
+//  The lua_State to load the chunk into.
+//
+// @param filename
+//  The name of the source file to load.
+//
+// @return
+//  The status returned by `luaL_loadfile()`; on success the loaded chunk is
+//  pushed onto the stack otherwise an error message is.
+*/
+int BytecodeCache::load( lua_State* lua_state, const char* filename )
+{
+    SWEET_ASSERT( lua_state );
+    SWEET_ASSERT( filename );
+
+    if ( directory_.empty() )
+    {
+        return luaL_loadfile( lua_state, filename );
+    }
+
+    // The source is read even when its bytecode is cached so that the cache
+    // is keyed on its contents.  Reading and hashing a buildfile is much 
+    // cheaper than parsing it.  Files that can't be read are left to 
+    // `luaL_loadfile()` to report.
+    std::ifstream ifstream( filename, std::ios::binary );
+    string source( (std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>() );
+    if ( !ifstream.is_open() || ifstream.bad() )
+    {
+        return luaL_loadfile( lua_state, filename );
+    }
+
+    // Precompiled chunks are loaded as they are; there's nothing to gain by
+    // caching them.
+    bool binary = false;
+    chunk_start( source, &binary );
+    if ( binary )
+    {
+        return load_source( lua_state, source, filename );
+    }
+
+    path cache_filename = BytecodeCache::cache_filename( filename );
+    if ( load_cached(lua_state, cache_filename, filename, source) )
+    {
+        ++hits_;
+        return LUA_OK;
+    }
+
+    ++misses_;
+    int result = load_source( lua_state, source, filename );
+    if ( result == LUA_OK )
+    {
+        save_cached( lua_state, cache_filename, filename, source );
+    }
+    return result;
+}
+
+/**
+// Get the name of the cache file for a source file.
+//
+// The full source filename is also stored in the cache file so that 
+// colliding hashes are detected and treated as misses.
+//
+// @param filename
+//  The name of the source file.
+//
+// @return
+//  The name of the cache file.
+*/
+boost::filesystem::path BytecodeCache::cache_filename( const std::string& filename ) const
+{
+    char leaf [32];
+    snprintf( leaf, sizeof(leaf), "%016llx.luac", static_cast<unsigned long long>(std::hash<string>()(filename)) );
+    return directory_ / leaf;
+}
+
+bool BytecodeCache::load_cached( lua_State* lua_state, const boost::filesystem::path& cache_filename, const std::string& filename, const std::string& source )
+{
+    std::ifstream ifstream( cache_filename.string(), std::ios::binary );
+    if ( !ifstream.is_open() )
+    {
+        return false;
+    }
+
+    BytecodeHeader header;
+    memset( &header, 0, sizeof(header) );
+    ifstream.read( reinterpret_cast<char*>(&header), sizeof(header) );
+    bool valid = 
+        ifstream.good() &&
+        strncmp( header.format, BYTECODE_FORMAT, sizeof(header.format) ) == 0 &&
+        header.version == BYTECODE_VERSION &&
+        header.filename_size == filename.size() &&
+        header.source_size == source.size() &&
+        header.source_hash == hash_bytes( source.data(), source.size() )
+    ;
+    if ( !valid )
+    {
+        return false;
+    }
+
+    string cached_filename( header.filename_size, 0 );
+    ifstream.read( &cached_filename[0], cached_filename.size() );
+    if ( !ifstream.good() || cached_filename != filename )
+    {
+        return false;
+    }
+
+    string bytecode( (std::istreambuf_iterator<char>(ifstream)), std::istreambuf_iterator<char>() );
+    if ( bytecode.empty() || bytecode.size() != header.bytecode_size || hash_bytes(bytecode.data(), bytecode.size()) != header.bytecode_hash )
+    {
+        return false;
+    }
+
+    // Chunks loaded from cache files are named the same as chunks loaded
+    // from their source files so that error messages are unchanged.  Any 
+    // chunk that fails to load, e.g. because it was dumped by a different
+    // version of Lua, is loaded from its source file instead.
+    string chunkname = string( "@" ) + filename;
+    if ( luaL_loadbufferx(lua_state, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") != LUA_OK )
+    {
+        lua_pop( lua_state, 1 );
+        return false;
+    }
+    return true;
+}
+
+void BytecodeCache::save_cached( lua_State* lua_state, const boost::filesystem::path& cache_filename, const std::string& filename, const std::string& source )
+{
+    string bytecode;
+    if ( lua_dump(lua_state, &append_bytecode, &bytecode, 0) != 0 || bytecode.empty() )
+    {
+        return;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories( directory_, error );
+
+    BytecodeHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.format, BYTECODE_FORMAT, sizeof(BYTECODE_FORMAT) );
+    header.version = BYTECODE_VERSION;
+    header.filename_size = uint32_t(filename.size());
+    header.source_size = source.size();
+    header.source_hash = hash_bytes( source.data(), source.size() );
+    header.bytecode_size = bytecode.size();
+    header.bytecode_hash = hash_bytes( bytecode.data(), bytecode.size() );
+
+    // Write to a uniquely named temporary file and rename it over the cache
+    // file so that concurrent builds never read a partially written cache
+    // file or write to the same temporary file.
+    path temporary_filename = cache_filename;
+    temporary_filename += boost::filesystem::unique_path( ".%%%%-%%%%-%%%%-%%%%.tmp", error );
+    if ( error )
+    {
+        return;
+    }
+    {
+        std::ofstream ofstream( temporary_filename.string(), std::ios::binary | std::ios::trunc );
+        if ( !ofstream.is_open() )
+        {
+            return;
+        }
+        ofstream.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+        ofstream.write( filename.data(), filename.size() );
+        ofstream.write( bytecode.data(), bytecode.size() );
+        if ( !ofstream.good() )
+        {
+            ofstream.close();
+            boost::filesystem::remove( temporary_filename, error );
+            return;
+        }
+    }
+    boost::filesystem::rename( temporary_filename, cache_filename, error );
+    if ( error )
+    {
+        boost::filesystem::remove( temporary_filename, error );
+    }
+}
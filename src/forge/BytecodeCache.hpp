@@ -0,0 +1,59 @@
+#ifndef FORGE_BYTECODECACHE_HPP_INCLUDED
+#define FORGE_BYTECODECACHE_HPP_INCLUDED
+
+#include <boost/filesystem/path.hpp>
+#include <string>
+
+struct lua_State;
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// A cache of compiled Lua chunks for buildfiles and modules.
+//
+// Each source file is compiled once and its bytecode, as dumped by 
+// `lua_dump()`, is written to a file in the cache directory along with the 
+// path, size, and a hash of the contents of the source file and a checksum
+// of the bytecode.  Later loads of a source file with the same contents 
+// load the bytecode instead of parsing the source again.  Keying on the 
+// contents rather than the last write time catches edits made within the
+// resolution of file timestamps.  A missing, stale, or invalid cache file
+// quietly falls back to compiling the source and replaces the cache file.
+//
+// Cache files are written to uniquely named temporary files and renamed 
+// into place so that concurrent builds never interleave their writes.  The
+// checksum guards against loading damaged bytecode as Lua doesn't verify
+// bytecode before running it.
+//
+// Debug information is kept in the dumped chunks so that error messages and
+// stack traces still refer to source files and line numbers.
+*/
+class BytecodeCache
+{
+    boost::filesystem::path directory_; ///< The directory that cache files are stored in or empty if caching is disabled.
+    int hits_; ///< The number of chunks loaded from cache files.
+    int misses_; ///< The number of chunks loaded from source files.
+
+public:
+    BytecodeCache();
+    const boost::filesystem::path& directory() const;
+    int hits() const;
+    int misses() const;
+    void set_directory( const boost::filesystem::path& directory );
+    int load( lua_State* lua_state, const char* filename );
+
+private:
+    boost::filesystem::path cache_filename( const std::string& filename ) const;
+    bool load_cached( lua_State* lua_state, const boost::filesystem::path& cache_filename, const std::string& filename, const std::string& source );
+    void save_cached( lua_State* lua_state, const boost::filesystem::path& cache_filename, const std::string& filename, const std::string& source );
+};
+
+}
+
+}
+
+#endif
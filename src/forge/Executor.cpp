@@ -9,6 +9,7 @@
 #include "Context.hpp"
 #include "Reader.hpp"
 #include "Scheduler.hpp"
+#include "Tracer.hpp"
 #include <process/Process.hpp>
 #include <process/Environment.hpp>
 #include <assert/assert.hpp>
@@ -113,6 +114,11 @@ void Executor::thread_execute( const std::string& command, const std::string& co
 {
     SWEET_ASSERT( forge_ );
     
+    // The span is recorded before the result is pushed back to the main 
+    // thread so that it is in the trace even if the result is the last 
+    // thing that the main thread waits for before writing the trace.
+    Tracer* tracer = forge_->tracer();
+    int64_t begin = tracer->enabled() ? tracer->now() : 0;
     try
     {
         environment = inject_build_hooks_linux( environment, dependencies_filter != NULL );
@@ -144,14 +150,26 @@ void Executor::thread_execute( const std::string& command, const std::string& co
         scheduler->read( stdout_pipe, stdout_filter, arguments, working_directory );
         scheduler->read( stderr_pipe, stderr_filter, arguments, working_directory );
         process.wait();
-        scheduler->push_execute_finished( process.exit_code(), context, environment );
+        trace_process( command, command_line, begin );
+        scheduler->push_execute_finished( process.exit_code(), process.usage(), context, environment );
     }
 
     catch ( const std::exception& exception )
     {
+        trace_process( command, command_line, begin );
         Scheduler* scheduler = forge_->scheduler();
         scheduler->push_errorf( "%s", exception.what() );
-        scheduler->push_execute_finished( EXIT_FAILURE, context, environment );
+        process::Usage usage = { 0, 0, 0, 0, 0, 0 };
+        scheduler->push_execute_finished( EXIT_FAILURE, usage, context, environment );
+    }
+}
+
+void Executor::trace_process( const std::string& command, const std::string& command_line, int64_t begin )
+{
+    Tracer* tracer = forge_->tracer();
+    if ( tracer->enabled() )
+    {
+        tracer->span( "process", boost::filesystem::path(command).filename().string(), command_line, begin, tracer->now() );
     }
 }
 
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <thread>
 #include <string>
+#include <stdint.h>
 
 namespace sweet
 {
@@ -58,6 +59,7 @@ class Executor
         static int thread_main( void* context );
         void thread_process();
         void thread_execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Target* working_directory, Context* context );
+        void trace_process( const std::string& command, const std::string& command_line, int64_t begin );
         void start();
         void stop();
         process::Environment* inject_build_hooks_linux( process::Environment* environment, bool dependencies_filter_exists ) const;
@@ -8,6 +8,12 @@
 #include "System.hpp"
 #include "Scheduler.hpp"
 #include "Executor.hpp"
+#include "BytecodeCache.hpp"
+#include "Tracer.hpp"
+#include "Phases.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
+#include "Statistics.hpp"
 #include "Reader.hpp"
 #include "Graph.hpp"
 #include "Toolset.hpp"
@@ -21,12 +27,24 @@
 #include <forge/forge_lua/LuaToolsetPrototype.hpp>
 #include <error/ErrorPolicy.hpp>
 #include <assert/assert.hpp>
+#include <lua.hpp>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(BUILD_OS_WINDOWS)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using std::string;
 using std::vector;
 using namespace sweet;
 using namespace sweet::forge;
 
+static const int PROFILE_INTERVAL = 1000; ///< The number of Lua VM instructions between profile samples.
+static const int PROFILE_COUNT = 20; ///< The number of functions and buildfiles printed in profiles.
+
 /**
 // Constructor.
 //
@@ -47,6 +65,11 @@ Forge::Forge( const std::string& initial_directory, error::ErrorPolicy& error_po
   graph_( NULL ),
   scheduler_( NULL ),
   executor_( NULL ),
+  bytecode_cache_( NULL ),
+  tracer_( NULL ),
+  phases_( NULL ),
+  profiler_( NULL ),
+  progress_( NULL ),
   root_directory_(),
   initial_directory_(),
   home_directory_(),
@@ -60,8 +83,13 @@ Forge::Forge( const std::string& initial_directory, error::ErrorPolicy& error_po
     home_directory_ = make_drive_uppercase( system_->home() );
     executable_directory_ = make_drive_uppercase( system_->executable() ).parent_path();
 
+    bytecode_cache_ = new BytecodeCache;
+    tracer_ = new Tracer;
+    profiler_ = new Profiler;
     lua_ = new Lua( this );
     system_ = new System;
+    phases_ = new Phases( system_ );
+    progress_ = new Progress( system_ );
     reader_ = new Reader( this );
     graph_ = new Graph( this );
     scheduler_ = new Scheduler( this );
@@ -93,6 +121,11 @@ Forge::~Forge()
     delete reader_;
     delete system_;
     delete lua_;
+    delete bytecode_cache_;
+    delete tracer_;
+    delete phases_;
+    delete profiler_;
+    delete progress_;
 }
 
 /**
@@ -166,6 +199,66 @@ Executor* Forge::executor() const
     return executor_;
 }
 
+/**
+// Get the BytecodeCache for this Forge.
+//
+// @return
+//  The BytecodeCache.
+*/
+BytecodeCache* Forge::bytecode_cache() const
+{
+    SWEET_ASSERT( bytecode_cache_ );
+    return bytecode_cache_;
+}
+
+/**
+// Get the Tracer for this Forge.
+//
+// @return
+//  The Tracer.
+*/
+Tracer* Forge::tracer() const
+{
+    SWEET_ASSERT( tracer_ );
+    return tracer_;
+}
+
+/**
+// Get the Phases for this Forge.
+//
+// @return
+//  The Phases.
+*/
+Phases* Forge::phases() const
+{
+    SWEET_ASSERT( phases_ );
+    return phases_;
+}
+
+/**
+// Get the Profiler for this Forge.
+//
+// @return
+//  The Profiler.
+*/
+Profiler* Forge::profiler() const
+{
+    SWEET_ASSERT( profiler_ );
+    return profiler_;
+}
+
+/**
+// Get the Progress for this Forge.
+//
+// @return
+//  The Progress.
+*/
+Progress* Forge::progress() const
+{
+    SWEET_ASSERT( progress_ );
+    return progress_;
+}
+
 /**
 // Get the currently active Context for this Forge.
 //
@@ -313,6 +406,19 @@ int Forge::maximum_parallel_jobs() const
     return executor_->maximum_parallel_jobs();
 }
 
+/**
+// Set the directory that compiled buildfiles and modules are cached in.
+//
+// @param bytecode_cache_directory
+//  The directory to cache compiled buildfiles and modules in or an empty 
+//  string to disable caching.
+*/
+void Forge::set_bytecode_cache_directory( const std::string& bytecode_cache_directory )
+{
+    SWEET_ASSERT( bytecode_cache_ );
+    bytecode_cache_->set_directory( bytecode_cache_directory );
+}
+
 /**
 // Set the path to the build hooks library.
 //
@@ -390,14 +496,83 @@ void Forge::set_package_path( const std::string& path )
 */
 void Forge::execute( const std::string& filename, const std::string& command )
 {
+    // Trace the build to the file named by the `trace` variable when it has
+    // been set on the command line (e.g. `forge trace=build.json`).
+    lua_State* lua_state = lua_->lua_state();
+    lua_getglobal( lua_state, "trace" );
+    if ( lua_type(lua_state, -1) == LUA_TSTRING )
+    {
+        tracer_->start( initial(lua_tostring(lua_state, -1)).generic_string() );
+    }
+    lua_pop( lua_state, 1 );
+
+    // Sample Lua stacks and write them as folded stacks to the file named by
+    // the `profile` variable when it has been set on the command line (e.g.
+    // `forge profile=build.folded`).
+    lua_getglobal( lua_state, "profile" );
+    if ( lua_type(lua_state, -1) == LUA_TSTRING )
+    {
+        profiler_->start( initial(lua_tostring(lua_state, -1)).generic_string(), PROFILE_INTERVAL );
+    }
+    lua_pop( lua_state, 1 );
+
+    // Report progress unless the `progress` variable has been set to false 
+    // or 0 on the command line.  Progress is redrawn in place when stdout is
+    // a terminal and printed as periodic plain lines otherwise.
+    lua_getglobal( lua_state, "progress" );
+    const char* progress = lua_tostring( lua_state, -1 );
+    bool enabled = !progress || (strcmp(progress, "false") != 0 && strcmp(progress, "0") != 0);
+#if defined(BUILD_OS_WINDOWS)
+    progress_->set_enabled( enabled, _isatty(_fileno(stdout)) != 0 );
+#else
+    progress_->set_enabled( enabled, isatty(STDOUT_FILENO) != 0 );
+#endif
+    lua_pop( lua_state, 1 );
+
     error_policy_.push_errors();
     boost::filesystem::path path( root_directory_ / filename );    
-    scheduler_->load( path );
+    {
+        Tracer::Span span( tracer_, "forge", filename );
+        Phases::Scope phase( phases_, "load" );
+        scheduler_->load( path );
+    }
     int errors = error_policy_.pop_errors();
     if ( errors == 0 )
     {
+        Tracer::Span span( tracer_, "forge", command );
         scheduler_->command( path, command );
     }
+
+    if ( tracer_->enabled() && !tracer_->write() )
+    {
+        errorf( "Writing trace to '%s' failed", tracer_->filename().c_str() );
+    }
+
+    if ( profiler_->enabled() )
+    {
+        profiler_->print( PROFILE_COUNT );
+        if ( !profiler_->write() )
+        {
+            errorf( "Writing profile to '%s' failed", profiler_->filename().c_str() );
+        }
+    }
+
+    // Print a summary of build statistics and write them as JSON to the file
+    // named by the `statistics` variable when it has been set on the command
+    // line (e.g. `forge statistics=stats.json`).
+    lua_getglobal( lua_state, "statistics" );
+    if ( lua_type(lua_state, -1) == LUA_TSTRING )
+    {
+        string filename = initial( lua_tostring(lua_state, -1) ).generic_string();
+        Statistics statistics;
+        statistics.collect( this );
+        statistics.print();
+        if ( !statistics.write(filename) )
+        {
+            errorf( "Writing statistics to '%s' failed", filename.c_str() );
+        }
+    }
+    lua_pop( lua_state, 1 );
 }
 
 /**
@@ -506,6 +681,7 @@ void Forge::outputf( const char* format, ... )
         vsnprintf( message, sizeof(message), format, args );
         message[sizeof(message) - 1] = 0;
         va_end( args );
+        progress_->clear();
         event_sink_->forge_output( this, message );
     }
 }
@@ -531,6 +707,7 @@ void Forge::errorf( const char* format, ... )
         vsnprintf( message, sizeof(message), format, args );
         message[sizeof(message) - 1] = 0;
         va_end( args );
+        progress_->clear();
         event_sink_->forge_error( this, message );
     }
 }
@@ -539,6 +716,7 @@ void Forge::output( const char* message )
 {
     if ( event_sink_ && message )
     {
+        progress_->clear();
         event_sink_->forge_output( this, message );
     }
 }
@@ -547,6 +725,7 @@ void Forge::error( const char* message )
 {
     if ( event_sink_ && message )
     {
+        progress_->clear();
         event_sink_->forge_error( this, message );
     }
 }
@@ -25,7 +25,12 @@ class ForgeEventSink;
 class Reader;
 class Executor;
 class Scheduler;
+class BytecodeCache;
 class System;
+class Tracer;
+class Phases;
+class Profiler;
+class Progress;
 class TargetPrototype;
 class ToolsetPrototype;
 class Toolset;
@@ -46,6 +51,11 @@ class Forge
     Graph* graph_; ///< The dependency graph of targets used to determine which targets are outdated.
     Scheduler* scheduler_; ///< The scheduler that schedules environments to process jobs in the dependency graph.
     Executor* executor_; ///< The executor that schedules threads to process commands.
+    BytecodeCache* bytecode_cache_; ///< The cache of compiled buildfiles and modules.
+    Tracer* tracer_; ///< The tracer that records spans of time spent in each phase of a build.
+    Phases* phases_; ///< The phase timers and counters reported when a build finishes.
+    Profiler* profiler_; ///< The profiler that samples Lua stacks when profiling is enabled.
+    Progress* progress_; ///< The progress of postorder traversals reported while building.
     boost::filesystem::path root_directory_; ///< The full path to the root directory.
     boost::filesystem::path initial_directory_; ///< The full path to the initial directory.
     boost::filesystem::path home_directory_; ///< The full path to the user's home directory.
@@ -62,6 +72,11 @@ class Forge
         Graph* graph() const;
         Scheduler* scheduler() const;
         Executor* executor() const;
+        BytecodeCache* bytecode_cache() const;
+        Tracer* tracer() const;
+        Phases* phases() const;
+        Profiler* profiler() const;
+        Progress* progress() const;
         Context* context() const;
         lua_State* lua_state() const;
 
@@ -82,6 +97,7 @@ class Forge
         int maximum_parallel_jobs() const;
         void set_forge_hooks_library( const std::string& forge_hooks_library );
         const std::string& forge_hooks_library() const;
+        void set_bytecode_cache_directory( const std::string& bytecode_cache_directory );
 
         void set_root_directory( const std::string& root_directory );
         void assign_global_variables( const std::vector<std::string>& assignments_and_commands );
@@ -14,9 +14,15 @@
 #include "path_functions.hpp"
 #include "GraphReader.hpp"
 #include "GraphWriter.hpp"
+#include "GraphJournal.hpp"
+#include "Tracer.hpp"
+#include "Phases.hpp"
+#include <process/Usage.hpp>
 #include <assert/assert.hpp>
+#include <algorithm>
 #include <memory>
 #include <fstream>
+#include <unordered_set>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -24,6 +30,10 @@ using std::list;
 using std::vector;
 using std::string;
 using std::unique_ptr;
+using std::shared_ptr;
+using std::weak_ptr;
+using std::unordered_multimap;
+using std::unordered_map;
 using std::transform;
 using namespace sweet;
 using namespace sweet::forge;
@@ -39,6 +49,12 @@ Graph::Graph()
   filename_(),
   root_target_( nullptr ),
   cache_target_( nullptr ),
+  journal_(),
+  implicit_dependencies_by_hash_(),
+  settings_keys_by_hash_(),
+  transitive_libraries_by_target_(),
+  transitive_libraries_prototype_( nullptr ),
+  snapshot_exists_( false ),
   traversal_in_progress_( false ),
   visited_revision_( 0 ),
   successful_revision_( 0 )
@@ -59,12 +75,19 @@ Graph::Graph( Forge* forge )
   filename_(),
   root_target_(),
   cache_target_(),
+  journal_(),
+  implicit_dependencies_by_hash_(),
+  settings_keys_by_hash_(),
+  transitive_libraries_by_target_(),
+  transitive_libraries_prototype_( nullptr ),
+  snapshot_exists_( false ),
   traversal_in_progress_( false ),
   visited_revision_( 0 ),
   successful_revision_( 0 )
 {
     SWEET_ASSERT( forge_ );
     root_target_.reset( new Target("$$root", this) );
+    journal_.reset( new GraphJournal(this) );
 }
 
 Graph::~Graph()
@@ -151,6 +174,7 @@ void Graph::begin_traversal()
     traversal_in_progress_ = true;
     ++visited_revision_;
     ++successful_revision_;
+    transitive_libraries_by_target_.clear();
 }
 
 /**
@@ -160,6 +184,7 @@ void Graph::end_traversal()
 {
     SWEET_ASSERT( traversal_in_progress_ );
     traversal_in_progress_ = false;
+    transitive_libraries_by_target_.clear();
 }
 
 /**
@@ -458,6 +483,99 @@ Target* Graph::find_or_create_target_by_element( Target* target, const std::stri
     return found_target;
 }
 
+/**
+// Intern a list of implicit dependencies.
+//
+// Returns an existing list with identical contents if there is one so that
+// Targets with identical implicit dependencies share a single list.  Lists
+// are only weakly referenced here and are freed once no Targets refer to 
+// them.  The list passed in must not be changed after it has been interned.
+//
+// @param implicit_dependencies
+//  The list of implicit dependencies to intern (assumed not null).
+//
+// @return
+//  The shared list of implicit dependencies with the same contents as 
+//  \e implicit_dependencies.
+*/
+std::shared_ptr<std::vector<Target*>> Graph::intern_implicit_dependencies( const std::shared_ptr<std::vector<Target*>>& implicit_dependencies )
+{
+    SWEET_ASSERT( implicit_dependencies );
+
+    size_t hash = 0;
+    for ( vector<Target*>::const_iterator i = implicit_dependencies->begin(); i != implicit_dependencies->end(); ++i )
+    {
+        hash ^= std::hash<Target*>()( *i ) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    typedef unordered_multimap<size_t, weak_ptr<vector<Target*>>>::iterator iterator;
+    std::pair<iterator, iterator> lists = implicit_dependencies_by_hash_.equal_range( hash );
+    iterator i = lists.first;
+    while ( i != lists.second )
+    {
+        shared_ptr<vector<Target*>> list = i->second.lock();
+        if ( !list )
+        {
+            i = implicit_dependencies_by_hash_.erase( i );
+        }
+        else if ( list == implicit_dependencies || *list == *implicit_dependencies )
+        {
+            return list;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    implicit_dependencies_by_hash_.insert( std::make_pair(hash, weak_ptr<vector<Target*>>(implicit_dependencies)) );
+    return implicit_dependencies;
+}
+
+/**
+// Intern a list of settings keys.
+//
+// Returns an existing list with identical contents if there is one so that
+// Targets that read the same settings share a single list.  Unlike lists of
+// implicit dependencies there are only ever a few distinct lists of settings
+// keys, roughly one per target prototype and toolset, so lists are strongly
+// referenced here.  This keeps the address of each list unique for the 
+// lifetime of the Graph so that it can be used to identify the list in the
+// hashes cached by LuaSystem::hash_settings().  The list passed in must not
+// be changed after it has been interned.
+//
+// @param settings_keys
+//  The list of settings keys to intern (assumed not null).
+//
+// @return
+//  The shared list of settings keys with the same contents as 
+//  \e settings_keys.
+*/
+std::shared_ptr<std::vector<std::string>> Graph::intern_settings_keys( const std::shared_ptr<std::vector<std::string>>& settings_keys )
+{
+    SWEET_ASSERT( settings_keys );
+
+    size_t hash = 0;
+    for ( vector<string>::const_iterator i = settings_keys->begin(); i != settings_keys->end(); ++i )
+    {
+        hash ^= std::hash<string>()( *i ) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+
+    typedef unordered_multimap<size_t, shared_ptr<vector<string>>>::const_iterator iterator;
+    std::pair<iterator, iterator> lists = settings_keys_by_hash_.equal_range( hash );
+    for ( iterator i = lists.first; i != lists.second; ++i )
+    {
+        const shared_ptr<vector<string>>& list = i->second;
+        if ( list == settings_keys || *list == *settings_keys )
+        {
+            return list;
+        }
+    }
+
+    settings_keys_by_hash_.insert( std::make_pair(hash, settings_keys) );
+    return settings_keys;
+}
+
 /**
 // Load a buildfile into this Graph.
 //
@@ -577,6 +695,8 @@ int Graph::bind( Target* target )
         return 0;
     }
 
+    Tracer::Span span( forge_->tracer(), "graph", "bind" );
+    Phases::Scope phase( forge_->phases(), "bind" );
     Bind bind( forge_ );
     bind.visit( target ? target : root_target_.get() );
     return bind.failures_;
@@ -631,6 +751,7 @@ void Graph::clear()
         }
     };
 
+    transitive_libraries_by_target_.clear();
     RecursiveClear::clear( root_target_.get() );
 }
 
@@ -653,6 +774,11 @@ void Graph::recover()
 /**
 // Load this Graph from a binary file.
 //
+// Any journal of changes made since the file was last written is replayed 
+// onto the loaded Graph and then opened to append further changes to.  If 
+// the journal has grown larger than a quarter of the size of the file then 
+// it is compacted by writing the Graph out to the file again.
+//
 // @param filename
 //  The name of the file to load this Graph from.
 //
@@ -665,10 +791,18 @@ Target* Graph::load_binary( const std::string& filename )
     SWEET_ASSERT( !filename.empty() );
     SWEET_ASSERT( boost::filesystem::path(filename).is_absolute() );
     SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( journal_ );
     
+    Tracer::Span span( forge_->tracer(), "graph", "load_binary", filename );
+    Phases::Scope phase( forge_->phases(), "load_binary" );
     filename_ = filename;
     cache_target_ = NULL;
+    snapshot_exists_ = false;
 
+    // Count the bytes read from the snapshot and the journal replayed onto
+    // it so that the size of the dependency graph can be reported (see 
+    // Statistics).
+    uintmax_t snapshot_size = 0;
     if ( forge_->system()->exists(filename) )
     {
         std::ifstream ifstream( filename, std::ios::binary );
@@ -677,31 +811,662 @@ Target* Graph::load_binary( const std::string& filename )
         if ( root_target )
         {
             root_target_.swap( root_target );
-            recover();
-            return cache_target_;
+            snapshot_exists_ = true;
+            snapshot_size = boost::filesystem::file_size( filename );
         }
     }
-    
+
+    string journal_filename = filename + ".journal";
+    if ( snapshot_exists_ )
+    {
+        boost::system::error_code error;
+        uintmax_t journal_size = boost::filesystem::file_size( journal_filename, error );
+        forge_->phases()->count( "load_bytes", int64_t(snapshot_size + (!error ? journal_size : 0)) );
+        journal_->replay( journal_filename, &forge_->error_policy() );
+    }
+
     recover();
-    return nullptr;
+    journal_->open( journal_filename );
+    if ( snapshot_exists_ && journal_->size() > snapshot_size / 4 )
+    {
+        save_snapshot();
+    }
+    return snapshot_exists_ ? cache_target_ : nullptr;
 }
 
 /**
 // Save this Graph to a binary file.
+//
+// Only Targets that have changed since the Graph was loaded or last saved
+// are appended to the journal when the file already holds a snapshot of the
+// Graph otherwise the whole Graph is written out.
+//
+// Stale Targets aren't removed here as Targets that aren't part of this 
+// run, e.g. those of another variant, are still needed by later runs (see
+// Graph::remove_stale_targets()).
 */
 void Graph::save_binary()
 {
     SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( journal_ );
+
+    struct RecursiveJournal
+    {
+        static int64_t append( GraphJournal* journal, Target* target )
+        {
+            SWEET_ASSERT( target );
+            int64_t bytes = 0;
+            if ( target->modified() && target->parent() )
+            {
+                bytes += journal->append( target );
+            }
+
+            const vector<Target*>& targets = target->targets();
+            for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+            {
+                bytes += RecursiveJournal::append( journal, *i );
+            }
+            return bytes;
+        }
+    };
+
+    Tracer::Span span( forge_->tracer(), "graph", "save_binary", filename_ );
+    Phases::Scope phase( forge_->phases(), "save_binary" );
+    if ( filename_.empty() )
+    {
+        forge_->error( "Unable to save a dependency graph without trying to load it first" );        
+    }
+    else
+    {
+        if ( snapshot_exists_ )
+        {
+            forge_->phases()->count( "save_bytes", RecursiveJournal::append(journal_.get(), root_target_.get()) );
+        }
+        else
+        {
+            save_snapshot();
+        }
+    }
+}
+
+/**
+// Write the whole of this Graph out to a binary file and discard the 
+// journal.
+//
+// The snapshot is written to a temporary file that is then renamed over the
+// binary file and only then is the journal discarded.  An interrupted write
+// leaves the previous snapshot and the journal that applies to it intact.
+// An interruption between the rename and discarding the journal replays
+// entries that the new snapshot already contains; each entry is a state
+// that its Target held before the snapshot so at worst Targets are rebuilt.
+*/
+void Graph::save_snapshot()
+{
+    SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( journal_ );
 
     if ( !filename_.empty() )
     {
-        std::ofstream ofstream( filename_, std::ios::binary );
+        string temporary_filename = filename_ + ".tmp";
+        std::ofstream ofstream( temporary_filename, std::ios::binary | std::ios::trunc );
         GraphWriter graph_writer( &ofstream );
         graph_writer.write( root_target_.get() );
+        int64_t bytes = int64_t(ofstream.tellp());
+        ofstream.close();
+
+        boost::system::error_code error;
+        if ( !ofstream.fail() )
+        {
+            boost::filesystem::rename( temporary_filename, filename_, error );
+        }
+        if ( ofstream.fail() || error )
+        {
+            boost::filesystem::remove( temporary_filename, error );
+            forge_->errorf( "Writing the dependency graph to '%s' failed", filename_.c_str() );
+            return;
+        }
+
+        journal_->truncate();
+        snapshot_exists_ = true;
+        forge_->phases()->count( "save_bytes", bytes );
+    }
+}
+
+/**
+// Append the persistent state of a Target to the journal if it has changed
+// since it was last loaded, saved, or journaled.
+//
+// Called as each job in a postorder traversal completes so that finished
+// work isn't lost if the build is interrupted.
+//
+// @param target
+//  The Target to append to the journal.
+*/
+void Graph::append_to_journal( Target* target )
+{
+    SWEET_ASSERT( target );
+    SWEET_ASSERT( journal_ );
+    if ( snapshot_exists_ && target->modified() )
+    {
+        forge_->phases()->count( "save_bytes", int64_t(journal_->append(target)) );
+    }
+}
+
+/**
+// Mark the Targets in a Graph that are still part of the build.
+//
+// Targets referenced by scripts are those that buildfiles have defined or
+// looked up in the current run.  They, the cache Target, and everything they
+// reach through their working directories and dependencies, including 
+// implicit dependencies, are marked as visited.  Any other Target that 
+// contains a marked Target in the Target namespace is kept but isn't 
+// marked.
+*/
+struct MarkLive
+{
+    Graph* graph_;
+    int roots_;
+
+    MarkLive( Graph* graph )
+    : graph_( graph ),
+      roots_( 0 )
+    {
+        SWEET_ASSERT( graph_ );
+        graph_->begin_traversal();
+        mark_roots( graph_->root_target() );
+        if ( graph_->cache_target() )
+        {
+            mark( graph_->cache_target() );
+        }
+    }
+
+    ~MarkLive()
+    {
+        graph_->end_traversal();
+    }
+
+    void mark_roots( Target* target )
+    {
+        SWEET_ASSERT( target );
+        if ( target->referenced_by_script() )
+        {
+            ++roots_;
+            mark( target );
+        }
+
+        const vector<Target*>& targets = target->targets();
+        for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+        {
+            mark_roots( *i );
+        }
+    }
+
+    void mark( Target* target )
+    {
+        SWEET_ASSERT( target );
+        if ( !target->visited() )
+        {
+            target->set_visited( true );
+
+            if ( target->working_directory() )
+            {
+                mark( target->working_directory() );
+            }
+
+            int i = 0;
+            Target* dependency = target->any_dependency( i );
+            while ( dependency )
+            {
+                mark( dependency );
+                ++i;
+                dependency = target->any_dependency( i );
+            }
+        }
+    }
+
+    bool sweep( Target* target, bool remove, vector<Target*>* stale_targets )
+    {
+        SWEET_ASSERT( target );
+        SWEET_ASSERT( stale_targets );
+
+        bool reachable = target->visited();
+        bool live = reachable;
+        const vector<Target*>& targets = target->targets();
+        for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+        {
+            live = sweep( *i, remove, stale_targets ) || live;
+        }
+
+        if ( !live )
+        {
+            stale_targets->push_back( target );
+        }
+        else if ( remove )
+        {
+            // Targets that are only kept to hold live Targets in the Target 
+            // namespace drop their implicit dependencies as those may refer
+            // to stale Targets that are about to be destroyed.
+            if ( !reachable )
+            {
+                target->clear_implicit_dependencies();
+                target->set_visited( true );
+            }
+            target->destroy_unvisited_targets();
+        }
+        return live;
+    }
+};
+
+/**
+// Remove stale Targets from this Graph.
+//
+// Targets are stale when they aren't reachable from any Target that has 
+// been defined by a buildfile in the current run or from the cache Target, 
+// aren't the implicit dependency of a reachable Target, and don't contain
+// any reachable Targets.  Nothing is removed when no Targets have been 
+// referenced by scripts, e.g. when no buildfiles have been loaded.
+//
+// Removal is only ever explicit (e.g. the `gc` command) as Targets that 
+// aren't reachable in one run, e.g. those of another variant, are often 
+// reachable again in the next.  The whole Graph is written out the next 
+// time it is saved when any Targets are removed so that the journal never
+// refers to destroyed Targets.
+//
+// @return
+//  The number of Targets removed.
+*/
+int Graph::remove_stale_targets()
+{
+    SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( root_target_ );
+
+    if ( traversal_in_progress_ )
+    {
+        forge_->error( "Remove stale targets called from within a bind or postorder traversal" );
+        return 0;
+    }
+
+    int removed = 0;
+    {
+        MarkLive mark_live( this );
+        if ( mark_live.roots_ > 0 )
+        {
+            vector<Target*> stale_targets;
+            mark_live.sweep( root_target_.get(), true, &stale_targets );
+            removed = int(stale_targets.size());
+        }
+    }
+    if ( removed > 0 )
+    {
+        snapshot_exists_ = false;
+    }
+    return removed;
+}
+
+/**
+// Print the stale Targets that would be removed from this Graph by 
+// Graph::remove_stale_targets().
+//
+// @return
+//  The number of stale Targets.
+*/
+int Graph::print_stale_targets()
+{
+    SWEET_ASSERT( forge_ );
+    SWEET_ASSERT( root_target_ );
+
+    if ( traversal_in_progress_ )
+    {
+        forge_->error( "Print stale targets called from within a bind or postorder traversal" );
+        return 0;
+    }
+
+    vector<Target*> stale_targets;
+    {
+        MarkLive mark_live( this );
+        if ( mark_live.roots_ > 0 )
+        {
+            mark_live.sweep( root_target_.get(), false, &stale_targets );
+        }
+    }
+
+    for ( vector<Target*>::const_iterator i = stale_targets.begin(); i != stale_targets.end(); ++i )
+    {
+        const Target* target = *i;
+        SWEET_ASSERT( target );
+        printf( "%s\n", target->path().c_str() );
+    }
+    printf( "%d stale targets\n", int(stale_targets.size()) );
+    return int(stale_targets.size());
+}
+
+/**
+// Find the Targets affected by changes to files.
+//
+// A reverse dependency index mapping each Target to the Targets that 
+// explicitly or implicitly depend on it is built from the current Graph 
+// along with an index of Targets by the filenames that they are bound to.
+// Ordering dependencies aren't followed as they don't make a Target 
+// outdated.  This means that the query should be made after buildfiles 
+// have been loaded so that explicit dependencies are known.
+//
+// Each changed path is matched to the Target at that path in the Target
+// namespace and to any Targets bound to a file at that path.  Paths that 
+// don't match any Target, e.g. files that have been added or removed, and
+// buildfiles are matched to the Targets whose working directory is the 
+// directory that contains them, or failing that the nearest directory above
+// it that is the working directory of any Target, as those are the Targets
+// that the buildfile in that directory defines.  Changes to Lua scripts and
+// paths that no such directory is found for can affect any Target and so 
+// match every Target in the Graph.  Everything that transitively depends on
+// a matched Target is affected.
+//
+// When only goals are requested the affected Targets are reduced to those 
+// that have a TargetPrototype and that have no affected dependents with a
+// TargetPrototype.  These are typically executables, libraries, and other
+// top level outputs rather than groups like `all`.
+//
+// @param paths
+//  The absolute paths of the files that have changed.
+//
+// @param all
+//  True to return all affected Targets or false to return only the affected
+//  goals.
+//
+// @param affected_targets
+//  The vector to return the affected Targets in.
+*/
+void Graph::affected_targets( const std::vector<std::string>& paths, bool all, std::vector<Target*>* affected_targets )
+{
+    SWEET_ASSERT( root_target_ );
+    SWEET_ASSERT( affected_targets );
+
+    struct Index
+    {
+        vector<Target*> targets_;
+        unordered_map<Target*, vector<Target*>> dependents_;
+        unordered_map<string, vector<Target*>> targets_by_filename_;
+        unordered_map<Target*, vector<Target*>> targets_by_working_directory_;
+
+        void add( Target* target )
+        {
+            SWEET_ASSERT( target );
+            targets_.push_back( target );
+            if ( target->working_directory() )
+            {
+                targets_by_working_directory_[target->working_directory()].push_back( target );
+            }
+
+            int i = 0;
+            Target* dependency = target->binding_dependency( i );
+            while ( dependency )
+            {
+                dependents_[dependency].push_back( target );
+                ++i;
+                dependency = target->binding_dependency( i );
+            }
+
+            const vector<string>& filenames = target->filenames();
+            for ( vector<string>::const_iterator filename = filenames.begin(); filename != filenames.end(); ++filename )
+            {
+                if ( !filename->empty() )
+                {
+                    targets_by_filename_[*filename].push_back( target );
+                }
+            }
+
+            const vector<Target*>& targets = target->targets();
+            for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+            {
+                add( *i );
+            }
+        }
+
+        const vector<Target*>& dependents( Target* target ) const
+        {
+            static const vector<Target*> NO_DEPENDENTS;
+            unordered_map<Target*, vector<Target*>>::const_iterator i = dependents_.find( target );
+            return i != dependents_.end() ? i->second : NO_DEPENDENTS;
+        }
+
+        bool prototyped_dependent( Target* target, unordered_map<Target*, bool>* prototyped_dependents ) const
+        {
+            SWEET_ASSERT( prototyped_dependents );
+            unordered_map<Target*, bool>::const_iterator i = prototyped_dependents->find( target );
+            if ( i != prototyped_dependents->end() )
+            {
+                return i->second;
+            }
+
+            // Mark as false before recursing so that cyclic dependencies 
+            // terminate.
+            (*prototyped_dependents)[target] = false;
+            bool prototyped = false;
+            const vector<Target*>& dependents = Index::dependents( target );
+            for ( vector<Target*>::const_iterator j = dependents.begin(); j != dependents.end() && !prototyped; ++j )
+            {
+                Target* dependent = *j;
+                prototyped = dependent->prototype() || prototyped_dependent( dependent, prototyped_dependents );
+            }
+            (*prototyped_dependents)[target] = prototyped;
+            return prototyped;
+        }
+    };
+
+    Index index;
+    index.add( root_target_.get() );
+
+    vector<Target*> affected;
+    std::unordered_set<Target*> visited;
+    for ( vector<string>::const_iterator path = paths.begin(); path != paths.end(); ++path )
+    {
+        vector<Target*> matches;
+        Target* target = find_target( *path, nullptr );
+        if ( target )
+        {
+            matches.push_back( target );
+        }
+
+        unordered_map<string, vector<Target*>>::const_iterator i = index.targets_by_filename_.find( *path );
+        if ( i != index.targets_by_filename_.end() )
+        {
+            matches.insert( matches.end(), i->second.begin(), i->second.end() );
+        }
+
+        boost::filesystem::path extension = boost::filesystem::path( *path ).extension();
+        if ( extension == ".lua" )
+        {
+            matches = index.targets_;
+        }
+        else if ( matches.empty() || extension == ".forge" )
+        {
+            Target* directory = nullptr;
+            boost::filesystem::path directory_path = boost::filesystem::path( *path ).parent_path();
+            while ( !directory && directory_path.has_relative_path() )
+            {
+                directory = find_target( directory_path.generic_string(), nullptr );
+                directory_path = directory_path.parent_path();
+            }
+
+            unordered_map<Target*, vector<Target*>>::const_iterator i = index.targets_by_working_directory_.end();
+            while ( directory && directory != root_target_.get() && i == index.targets_by_working_directory_.end() )
+            {
+                i = index.targets_by_working_directory_.find( directory );
+                directory = directory->parent();
+            }
+            const vector<Target*>& defined_targets = i != index.targets_by_working_directory_.end() ? i->second : index.targets_;
+            matches.insert( matches.end(), defined_targets.begin(), defined_targets.end() );
+        }
+
+        for ( vector<Target*>::const_iterator match = matches.begin(); match != matches.end(); ++match )
+        {
+            if ( visited.insert(*match).second )
+            {
+                affected.push_back( *match );
+            }
+        }
+    }
+
+    for ( size_t i = 0; i < affected.size(); ++i )
+    {
+        const vector<Target*>& dependents = index.dependents( affected[i] );
+        for ( vector<Target*>::const_iterator dependent = dependents.begin(); dependent != dependents.end(); ++dependent )
+        {
+            if ( visited.insert(*dependent).second )
+            {
+                affected.push_back( *dependent );
+            }
+        }
+    }
+
+    affected_targets->clear();
+    if ( all )
+    {
+        affected_targets->swap( affected );
     }
     else
     {
-        forge_->error( "Unable to save a dependency graph without trying to load it first" );        
+        unordered_map<Target*, bool> prototyped_dependents;
+        for ( vector<Target*>::const_iterator i = affected.begin(); i != affected.end(); ++i )
+        {
+            Target* target = *i;
+            if ( target->prototype() && !index.prototyped_dependent(target, &prototyped_dependents) )
+            {
+                affected_targets->push_back( target );
+            }
+        }
+    }
+}
+
+/**
+// Find the static and dynamic libraries that a Target links with.
+//
+// The dependencies of \e target are walked, recursing into dependencies 
+// that aren't bound to files, to find the libraries that it depends on 
+// directly.  Each library is followed by the static libraries that it
+// transitively depends on through ordering dependencies.  Duplicates are
+// removed keeping the last occurrence so that every library appears before
+// the libraries that it depends on as linkers expect.
+//
+// The static libraries that each library transitively depends on are 
+// memoized until the end of the current traversal so that the libraries 
+// shared by many executables are only walked once per build.  Outside of
+// a traversal they are only reused within a single call.
+//
+// @param target
+//  The Target to find the libraries for.
+//
+// @param static_library
+//  The TargetPrototype for static libraries.
+//
+// @param dynamic_library
+//  The TargetPrototype for dynamic libraries (optional).
+//
+// @param libraries
+//  The vector to return the libraries in, in linker order.
+*/
+void Graph::transitive_libraries( Target* target, TargetPrototype* static_library, TargetPrototype* dynamic_library, std::vector<Target*>* libraries )
+{
+    SWEET_ASSERT( target );
+    SWEET_ASSERT( libraries );
+
+    struct Walk
+    {
+        Graph* graph_;
+        TargetPrototype* static_library_;
+        TargetPrototype* dynamic_library_;
+
+        static void unique( vector<Target*>* libraries )
+        {
+            SWEET_ASSERT( libraries );
+            std::unordered_set<Target*> seen;
+            vector<Target*>::iterator end = libraries->end();
+            vector<Target*>::iterator begin = libraries->begin();
+            vector<Target*>::iterator last = end;
+            for ( vector<Target*>::iterator i = end; i != begin; --i )
+            {
+                if ( seen.insert(*(i - 1)).second )
+                {
+                    --last;
+                    *last = *(i - 1);
+                }
+            }
+            libraries->erase( begin, last );
+        }
+
+        const vector<Target*>& static_libraries( Target* library )
+        {
+            SWEET_ASSERT( library );
+            unordered_map<Target*, vector<Target*>>& libraries_by_target = graph_->transitive_libraries_by_target_;
+            unordered_map<Target*, vector<Target*>>::iterator i = libraries_by_target.find( library );
+            if ( i != libraries_by_target.end() )
+            {
+                return i->second;
+            }
+
+            // Insert an empty list before recursing so that cyclic ordering
+            // dependencies terminate.
+            libraries_by_target[library];
+            vector<Target*> libraries;
+            int index = 0;
+            Target* dependency = library->ordering_dependency( index );
+            while ( dependency )
+            {
+                if ( dependency->prototype() && dependency->prototype() == static_library_ )
+                {
+                    libraries.push_back( dependency );
+                    const vector<Target*>& transitive_libraries = static_libraries( dependency );
+                    libraries.insert( libraries.end(), transitive_libraries.begin(), transitive_libraries.end() );
+                }
+                ++index;
+                dependency = library->ordering_dependency( index );
+            }
+            unique( &libraries );
+
+            vector<Target*>& memoized_libraries = libraries_by_target[library];
+            memoized_libraries.swap( libraries );
+            return memoized_libraries;
+        }
+
+        void libraries( Target* target, vector<Target*>* libraries )
+        {
+            SWEET_ASSERT( target );
+            SWEET_ASSERT( libraries );
+            int index = 0;
+            Target* dependency = target->explicit_dependency( index );
+            while ( dependency )
+            {
+                bool phony = dependency->filenames().empty() || dependency->filename( 0 ).empty();
+                if ( phony )
+                {
+                    Walk::libraries( dependency, libraries );
+                }
+                else if ( dependency->prototype() && (dependency->prototype() == static_library_ || dependency->prototype() == dynamic_library_) )
+                {
+                    libraries->push_back( dependency );
+                    const vector<Target*>& transitive_libraries = static_libraries( dependency );
+                    libraries->insert( libraries->end(), transitive_libraries.begin(), transitive_libraries.end() );
+                }
+                ++index;
+                dependency = target->explicit_dependency( index );
+            }
+        }
+    };
+
+    if ( !traversal_in_progress_ || static_library != transitive_libraries_prototype_ )
+    {
+        transitive_libraries_by_target_.clear();
+        transitive_libraries_prototype_ = static_library;
+    }
+
+    Walk walk = { this, static_library, dynamic_library };
+    libraries->clear();
+    walk.libraries( target, libraries );
+    Walk::unique( libraries );
+
+    if ( !traversal_in_progress_ )
+    {
+        transitive_libraries_by_target_.clear();
     }
 }
 
@@ -955,3 +1720,207 @@ void Graph::print_namespace( Target* target )
     recursive_printer.print( target ? target : root_target_.get(), 0 );
     printf( "\n\n" );
 }
+
+/**
+// Print why a Target is outdated.
+//
+// The first reason found for \e target being outdated is printed followed
+// by the reason for each dependency responsible in turn until a Target that
+// is outdated for a reason of its own is reached.  A dependency that is 
+// newer without being outdated itself is followed to the dependency that 
+// its timestamp came from so that the chain ends at the file that actually
+// changed.
+//
+// @param target
+//  The Target to explain or null to explain the root Target of this Graph.
+*/
+void Graph::print_explanation( Target* target )
+{
+    struct Explainer
+    {
+        System* system_;
+
+        Explainer( System* system )
+        : system_( system )
+        {
+            SWEET_ASSERT( system_ );
+        }
+
+        const char* missing_filename( Target* target ) const
+        {
+            const vector<string>& filenames = target->filenames();
+            for ( vector<string>::const_iterator i = filenames.begin(); i != filenames.end(); ++i )
+            {
+                if ( !system_->exists(*i) )
+                {
+                    return i->c_str();
+                }
+            }
+            return "";
+        }
+
+        Target* newest_dependency( Target* target ) const
+        {
+            int i = 0;
+            Target* dependency = target->binding_dependency( i );
+            while ( dependency )
+            {
+                if ( dependency->timestamp() == target->timestamp() )
+                {
+                    return dependency;
+                }
+                ++i;
+                dependency = target->binding_dependency( i );
+            }
+            return NULL;
+        }
+
+        void explain( Target* target )
+        {
+            SWEET_ASSERT( target );
+            while ( target )
+            {
+                Target* dependency = target->outdated_dependency();
+                switch ( target->outdated_reason() )
+                {
+                    case OUTDATED_NONE:
+                        printf( target->outdated() ? "'%s' was marked outdated by a build script\n" : "'%s' is up to date\n", target->path().c_str() );
+                        return;
+
+                    case OUTDATED_MISSING_FILE:
+                        printf( "'%s' is outdated because its file '%s' doesn't exist\n", target->path().c_str(), missing_filename(target) );
+                        return;
+
+                    case OUTDATED_NOT_BUILT:
+                        printf( "'%s' is outdated because it hasn't been built\n", target->path().c_str() );
+                        return;
+
+                    case OUTDATED_SETTINGS_CHANGED:
+                        printf( "'%s' is outdated because the settings read to build it changed\n", target->path().c_str() );
+                        return;
+
+                    case OUTDATED_DEPENDENCY_OUTDATED:
+                        SWEET_ASSERT( dependency );
+                        printf( "'%s' is outdated because its dependency '%s' is outdated\n", target->path().c_str(), dependency->path().c_str() );
+                        target = dependency;
+                        break;
+
+                    case OUTDATED_DEPENDENCY_NEWER:
+                        if ( !dependency )
+                        {
+                            printf( "'%s' is outdated because its files were last written at different times\n", target->path().c_str() );
+                            return;
+                        }
+                        printf( "'%s' is outdated because its dependency '%s' is newer by %ds\n", 
+                            target->path().c_str(), 
+                            dependency->path().c_str(),
+                            int(dependency->timestamp() - target->last_write_time())
+                        );
+                        explain_newer( dependency );
+                        return;
+
+                    default:
+                        SWEET_ASSERT( false );
+                        return;
+                }
+            }
+        }
+
+        void explain_newer( Target* target )
+        {
+            SWEET_ASSERT( target );
+            while ( target && (target->filenames().empty() || target->timestamp() > target->last_write_time()) )
+            {
+                Target* dependency = newest_dependency( target );
+                if ( !dependency )
+                {
+                    return;
+                }
+                printf( "'%s' is as new as its dependency '%s'\n", target->path().c_str(), dependency->path().c_str() );
+                target = dependency;
+            }
+        }
+    };
+
+    bind( target );
+    Explainer explainer( forge_->system() );
+    explainer.explain( target ? target : root_target_.get() );
+}
+
+/**
+// Print the Targets whose commands used the most wall time, CPU time, and
+// memory the last time that they were built.
+//
+// @param target
+//  The Target to search for Targets from in the Target namespace or null to
+//  search from the root Target of this Graph.
+//
+// @param count
+//  The maximum number of Targets to print for each resource.
+*/
+void Graph::print_usage( Target* target, int count )
+{
+    struct Usages
+    {
+        vector<Target*> targets_;
+
+        void collect( Target* target )
+        {
+            SWEET_ASSERT( target );
+            if ( target->usage() )
+            {
+                targets_.push_back( target );
+            }
+            const vector<Target*>& targets = target->targets();
+            for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+            {
+                collect( *i );
+            }
+        }
+
+        static int64_t wall_time( const Target* target )
+        {
+            return target->usage()->wall_time;
+        }
+
+        static int64_t cpu_time( const Target* target )
+        {
+            return target->usage()->user_time + target->usage()->system_time;
+        }
+
+        static int64_t peak_memory( const Target* target )
+        {
+            return target->usage()->peak_memory;
+        }
+
+        void print( const char* title, int64_t (*value)(const Target*), int64_t unit, const char* units, int count )
+        {
+            std::stable_sort( targets_.begin(), targets_.end(), [value]( const Target* lhs, const Target* rhs ) {
+                return value( lhs ) > value( rhs );
+            } );
+            printf( "%s:\n", title );
+            int printed = std::min( count, int(targets_.size()) );
+            for ( int i = 0; i < printed; ++i )
+            {
+                const Target* target = targets_[i];
+                printf( "%10" PRId64 "%-2s %s\n", value(target) / unit, units, target->path().c_str() );
+            }
+        }
+    };
+
+    Usages usages;
+    usages.collect( target ? target : root_target_.get() );
+
+    int64_t wall_time = 0;
+    int64_t cpu_time = 0;
+    for ( vector<Target*>::const_iterator i = usages.targets_.begin(); i != usages.targets_.end(); ++i )
+    {
+        wall_time += Usages::wall_time( *i );
+        cpu_time += Usages::cpu_time( *i );
+    }
+
+    usages.print( "Wall time", &Usages::wall_time, 1000, "ms", count );
+    usages.print( "CPU time", &Usages::cpu_time, 1000, "ms", count );
+    usages.print( "Peak memory", &Usages::peak_memory, 1024 * 1024, "MB", count );
+    printf( "%d targets used %" PRId64 "ms wall time and %" PRId64 "ms CPU time\n", int(usages.targets_.size()), wall_time / 1000, cpu_time / 1000 );
+}
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <unordered_map>
 
 namespace sweet
 {
@@ -17,6 +18,7 @@ class ToolsetPrototype;
 class TargetPrototype;
 class Toolset;
 class Target;
+class GraphJournal;
 class Forge;
 
 /**
@@ -31,6 +33,12 @@ class Graph
     std::string filename_; ///< The filename that this Graph was most recently loaded from.
     std::unique_ptr<Target> root_target_; ///< The root Target for this Graph.
     Target* cache_target_; ///< The cache Target for this Graph.
+    std::unique_ptr<GraphJournal> journal_; ///< The journal of changes made since this Graph was last saved.
+    std::unordered_multimap<size_t, std::weak_ptr<std::vector<Target*>>> implicit_dependencies_by_hash_; ///< The shared lists of implicit dependencies by hash of their contents.
+    std::unordered_multimap<size_t, std::shared_ptr<std::vector<std::string>>> settings_keys_by_hash_; ///< The shared lists of settings keys by hash of their contents.
+    std::unordered_map<Target*, std::vector<Target*>> transitive_libraries_by_target_; ///< The memoized static libraries transitively depended on by each library in the current traversal.
+    TargetPrototype* transitive_libraries_prototype_; ///< The static library TargetPrototype that the memoized transitive libraries were found with.
+    bool snapshot_exists_; ///< True when the file that this Graph is saved to holds a snapshot that the journal applies to.
     bool traversal_in_progress_; ///< True when a traversal is in progress otherwise false.
     int visited_revision_; ///< The current visit revision.
     int successful_revision_; ///< The current success revision.
@@ -59,6 +67,8 @@ class Graph
         Target* find_target( const std::string& path, Target* working_directory );
         Target* find_target_by_element( Target* target, const std::string& element );
         Target* find_or_create_target_by_element( Target* target, const std::string& element );
+        std::shared_ptr<std::vector<Target*>> intern_implicit_dependencies( const std::shared_ptr<std::vector<Target*>>& implicit_dependencies );
+        std::shared_ptr<std::vector<std::string>> intern_settings_keys( const std::shared_ptr<std::vector<std::string>>& settings_keys );
                 
         int buildfile( const std::string& filename );
         int bind( Target* target = NULL );        
@@ -67,8 +77,16 @@ class Graph
         void recover();
         Target* load_binary( const std::string& filename );
         void save_binary();
+        void save_snapshot();
+        void append_to_journal( Target* target );
+        int remove_stale_targets();
+        int print_stale_targets();
+        void affected_targets( const std::vector<std::string>& paths, bool all, std::vector<Target*>* affected_targets );
+        void transitive_libraries( Target* target, TargetPrototype* static_library, TargetPrototype* dynamic_library, std::vector<Target*>* libraries );
         void print_dependencies( Target* target, const std::string& directory );
         void print_namespace( Target* target );
+        void print_explanation( Target* target );
+        void print_usage( Target* target, int count );
 };
 
 }
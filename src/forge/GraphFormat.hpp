@@ -0,0 +1,89 @@
+#ifndef FORGE_GRAPHFORMAT_HPP_INCLUDED
+#define FORGE_GRAPHFORMAT_HPP_INCLUDED
+
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// The version of the dependency graph file format written by GraphWriter
+// and expected by GraphReader.
+*/
+static const int32_t GRAPH_FORMAT_VERSION = 36;
+
+/**
+// The number of references written for the resources used by a target 
+// (see GraphTargetRecord::usage).
+*/
+static const uint32_t GRAPH_USAGE_REFERENCES = 6;
+
+/**
+// A range of elements in the target record or reference sections of a
+// dependency graph file.
+*/
+struct GraphRange
+{
+    uint32_t first; ///< The index of the first element in the range.
+    uint32_t count; ///< The number of elements in the range.
+};
+
+/**
+// The header at the start of a dependency graph file.
+//
+// The header is followed by the target records section, the references
+// section, and then the strings section.  All sections are laid out with
+// fixed size, naturally aligned elements so that the file can be mapped
+// into memory and used directly.  Targets refer to each other and to
+// strings by index and offset rather than by address.
+*/
+struct GraphHeader
+{
+    char format [24]; ///< The format identifier "Sweet Build Graph" padded with nulls.
+    int32_t version; ///< The version of the file format.
+    uint32_t targets; ///< The number of target records.
+    uint32_t references; ///< The number of 32-bit references.
+    uint32_t strings_size; ///< The size of the strings section in bytes.
+};
+
+/**
+// The flags stored in a target record.
+*/
+enum GraphTargetFlags
+{
+    GRAPH_TARGET_BUILT = 0x01, ///< The target has been built.
+    GRAPH_TARGET_SETTINGS_KEYS = 0x02 ///< The target's hash only covers the settings named by its settings keys.
+};
+
+/**
+// A target record in a dependency graph file.
+//
+// Target records are written in breadth-first order from the root target so
+// that the children of any target are contiguous and always follow their
+// parent.  The root target is always the first record.
+*/
+struct GraphTargetRecord
+{
+    int64_t last_write_time; ///< The last write time of the target.
+    uint64_t hash; ///< The hash of the target.
+    uint64_t fingerprint; ///< The digest of the commands executed when the target was last built.
+    uint32_t id; ///< The offset of the target's identifier in the strings section.
+    uint32_t flags; ///< The flags for the target (see GraphTargetFlags).
+    GraphRange targets; ///< The range of target records that are children of the target.
+    GraphRange filenames; ///< The range of references that are string offsets of the target's filenames.
+    GraphRange implicit_dependencies; ///< The range of references that are target indices of the target's implicit dependencies.
+    GraphRange settings_keys; ///< The range of references that are string offsets of the settings read when the target was last built.
+    GraphRange usage; ///< The range of references that are the wall, user, and system times in milliseconds, peak memory in kilobytes, and block input and output of the commands executed when the target was last built or empty if it executed none.
+};
+
+static_assert( sizeof(GraphHeader) == 40, "Unexpected size for GraphHeader" );
+static_assert( sizeof(GraphTargetRecord) == 72, "Unexpected size for GraphTargetRecord" );
+
+}
+
+}
+
+#endif
@@ -0,0 +1,403 @@
+//
+// GraphJournal.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "GraphJournal.hpp"
+#include "GraphFormat.hpp"
+#include "Graph.hpp"
+#include "Target.hpp"
+#include <error/ErrorPolicy.hpp>
+#include <assert/assert.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <string.h>
+
+using std::vector;
+using std::string;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const char JOURNAL_FORMAT [] = "Sweet Build Journal";
+
+/**
+// The header at the start of a journal file.
+*/
+struct GraphJournalHeader
+{
+    char format [24]; ///< The format identifier "Sweet Build Journal" padded with nulls.
+    int32_t version; ///< The version of the dependency graph format that the journal applies to.
+    uint32_t reserved; ///< Reserved (always zero).
+};
+
+/**
+// Constructor.
+//
+// @param graph
+//  The Graph that this GraphJournal records changes to.
+*/
+GraphJournal::GraphJournal( Graph* graph )
+: graph_( graph ),
+  filename_(),
+  ofstream_(),
+  entry_(),
+  position_( nullptr ),
+  end_( nullptr ),
+  entries_( 0 )
+{
+    SWEET_ASSERT( graph_ );
+}
+
+GraphJournal::~GraphJournal()
+{
+    close();
+}
+
+/**
+// Get the name of the journal file.
+//
+// @return
+//  The name of the journal file or the empty string if the journal hasn't
+//  been opened.
+*/
+const std::string& GraphJournal::filename() const
+{
+    return filename_;
+}
+
+/**
+// Get the number of entries appended since the journal was opened.
+//
+// @return
+//  The number of entries.
+*/
+int GraphJournal::entries() const
+{
+    return entries_;
+}
+
+/**
+// Get the size of the journal file.
+//
+// @return
+//  The size of the journal file in bytes or 0 if the journal file doesn't
+//  exist.
+*/
+uintmax_t GraphJournal::size() const
+{
+    boost::system::error_code error;
+    uintmax_t size = boost::filesystem::file_size( filename_, error );
+    return !error ? size : 0;
+}
+
+/**
+// Replay the entries in a journal file onto the Graph.
+//
+// Entries are applied in the order that they were appended so that the most
+// recent state of each Target wins.  A truncated entry at the end of the
+// file, as left by a build that was interrupted while appending, is quietly
+// ignored.  So is an entry whose size runs past the end of the file, which
+// ends the replay before any memory is allocated for it.  Anything after the
+// last complete entry is cut from the file so that entries appended later 
+// follow on from it and are replayed in turn.
+//
+// @param filename
+//  The name of the journal file to replay.
+//
+// @param error_policy
+//  The ErrorPolicy to report an invalid journal file to.
+//
+// @return
+//  The number of entries replayed.
+*/
+int GraphJournal::replay( const std::string& filename, error::ErrorPolicy* error_policy )
+{
+    SWEET_ASSERT( error_policy );
+
+    std::ifstream ifstream( filename, std::ios::binary );
+    if ( !ifstream.is_open() )
+    {
+        return 0;
+    }
+
+    GraphJournalHeader header;
+    memset( &header, 0, sizeof(header) );
+    ifstream.read( reinterpret_cast<char*>(&header), sizeof(header) );
+    if ( !ifstream.good() || strncmp(header.format, JOURNAL_FORMAT, sizeof(JOURNAL_FORMAT)) != 0 || header.version != GRAPH_FORMAT_VERSION )
+    {
+        error_policy->print( "The file '%s' is not a valid journal for this version", filename.c_str() );
+        return 0;
+    }
+
+    boost::system::error_code error;
+    uintmax_t file_size = boost::filesystem::file_size( filename, error );
+    if ( error )
+    {
+        return 0;
+    }
+
+    int entries = 0;
+    uintmax_t complete_size = uintmax_t(ifstream.tellg());
+    uint32_t size = 0;
+    ifstream.read( reinterpret_cast<char*>(&size), sizeof(size) );
+    while ( ifstream.gcount() == sizeof(size) )
+    {
+        std::streamoff position = ifstream.tellg();
+        if ( position < 0 || uintmax_t(size) > file_size - uintmax_t(position) )
+        {
+            break;
+        }
+
+        entry_.resize( size );
+        ifstream.read( &entry_[0], size );
+        if ( uint32_t(ifstream.gcount()) != size )
+        {
+            break;
+        }
+        complete_size = uintmax_t(position) + size;
+
+        position_ = entry_.data();
+        end_ = entry_.data() + entry_.size();
+        string path;
+        if ( value(&path) && !path.empty() )
+        {
+            Target* target = graph_->target( path );
+            SWEET_ASSERT( target );
+            if ( target->read(*this) )
+            {
+                ++entries;
+            }
+        }
+        ifstream.read( reinterpret_cast<char*>(&size), sizeof(size) );
+    }
+
+    entry_.clear();
+    position_ = nullptr;
+    end_ = nullptr;
+
+    ifstream.close();
+    if ( complete_size < file_size )
+    {
+        boost::filesystem::resize_file( filename, complete_size, error );
+    }
+    return entries;
+}
+
+/**
+// Open a journal file to append entries to.
+//
+// @param filename
+//  The name of the journal file to open (created if it doesn't exist).
+*/
+void GraphJournal::open( const std::string& filename )
+{
+    close();
+    filename_ = filename;
+    entries_ = 0;
+    ofstream_.open( filename_, std::ios::binary | std::ios::app );
+    if ( ofstream_.is_open() && ofstream_.tellp() == std::streampos(0) )
+    {
+        header();
+    }
+}
+
+/**
+// Discard all entries in the journal file.
+//
+// Called when the Graph is written to its dependency graph file and the
+// entries in the journal are no longer needed.
+*/
+void GraphJournal::truncate()
+{
+    if ( !filename_.empty() )
+    {
+        ofstream_.close();
+        ofstream_.open( filename_, std::ios::binary | std::ios::trunc );
+        header();
+    }
+}
+
+/**
+// Close the journal file.
+*/
+void GraphJournal::close()
+{
+    if ( ofstream_.is_open() )
+    {
+        ofstream_.close();
+    }
+}
+
+/**
+// Append an entry recording the persistent state of a Target.
+//
+// The entry is written out and flushed immediately.
+//
+// @param target
+//  The Target to append an entry for.
+//
+// @return
+//  The number of bytes appended or 0 if the journal file isn't open.
+*/
+size_t GraphJournal::append( Target* target )
+{
+    SWEET_ASSERT( target );
+    if ( ofstream_.is_open() )
+    {
+        entry_.clear();
+        value( target->path() );
+        target->write( *this );
+        uint32_t size = uint32_t(entry_.size());
+        ofstream_.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+        ofstream_.write( entry_.data(), entry_.size() );
+        ofstream_.flush();
+        ++entries_;
+        return sizeof(size) + entry_.size();
+    }
+    return 0;
+}
+
+void GraphJournal::value( bool value )
+{
+    uint8_t byte = value ? 1 : 0;
+    entry_.append( reinterpret_cast<const char*>(&byte), sizeof(byte) );
+}
+
+void GraphJournal::value( uint64_t value )
+{
+    entry_.append( reinterpret_cast<const char*>(&value), sizeof(value) );
+}
+
+void GraphJournal::value( std::time_t value )
+{
+    int64_t time = int64_t(value);
+    entry_.append( reinterpret_cast<const char*>(&time), sizeof(time) );
+}
+
+void GraphJournal::value( const std::string& value )
+{
+    uint32_t size = uint32_t(value.size());
+    entry_.append( reinterpret_cast<const char*>(&size), sizeof(size) );
+    entry_.append( value );
+}
+
+void GraphJournal::value( const std::vector<std::string>& values )
+{
+    uint32_t length = uint32_t(values.size());
+    entry_.append( reinterpret_cast<const char*>(&length), sizeof(length) );
+    for ( vector<string>::const_iterator i = values.begin(); i != values.end(); ++i )
+    {
+        value( *i );
+    }
+}
+
+void GraphJournal::refer( const std::vector<Target*>& values )
+{
+    uint32_t length = uint32_t(values.size());
+    entry_.append( reinterpret_cast<const char*>(&length), sizeof(length) );
+    for ( vector<Target*>::const_iterator i = values.begin(); i != values.end(); ++i )
+    {
+        Target* target = *i;
+        SWEET_ASSERT( target );
+        value( target->path() );
+    }
+}
+
+bool GraphJournal::value( bool* value )
+{
+    SWEET_ASSERT( value );
+    uint8_t byte = 0;
+    bool valid = read( &byte, sizeof(byte) );
+    *value = byte != 0;
+    return valid;
+}
+
+bool GraphJournal::value( uint64_t* value )
+{
+    SWEET_ASSERT( value );
+    return read( value, sizeof(*value) );
+}
+
+bool GraphJournal::value( std::time_t* value )
+{
+    SWEET_ASSERT( value );
+    int64_t time = 0;
+    bool valid = read( &time, sizeof(time) );
+    *value = std::time_t(time);
+    return valid;
+}
+
+bool GraphJournal::value( std::string* value )
+{
+    SWEET_ASSERT( value );
+    uint32_t size = 0;
+    if ( !read(&size, sizeof(size)) || size > uint32_t(end_ - position_) )
+    {
+        return false;
+    }
+    value->assign( position_, size );
+    position_ += size;
+    return true;
+}
+
+bool GraphJournal::value( std::vector<std::string>* values )
+{
+    SWEET_ASSERT( values );
+    uint32_t length = 0;
+    if ( !read(&length, sizeof(length)) )
+    {
+        return false;
+    }
+    values->clear();
+    for ( uint32_t i = 0; i < length; ++i )
+    {
+        string filename;
+        if ( !value(&filename) )
+        {
+            return false;
+        }
+        values->push_back( filename );
+    }
+    return true;
+}
+
+bool GraphJournal::refer( std::vector<Target*>* values )
+{
+    SWEET_ASSERT( values );
+    uint32_t length = 0;
+    if ( !read(&length, sizeof(length)) )
+    {
+        return false;
+    }
+    values->clear();
+    for ( uint32_t i = 0; i < length; ++i )
+    {
+        string path;
+        if ( !value(&path) || path.empty() )
+        {
+            return false;
+        }
+        values->push_back( graph_->target(path) );
+    }
+    return true;
+}
+
+void GraphJournal::header()
+{
+    GraphJournalHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.format, JOURNAL_FORMAT, sizeof(JOURNAL_FORMAT) );
+    header.version = GRAPH_FORMAT_VERSION;
+    ofstream_.write( reinterpret_cast<const char*>(&header), sizeof(header) );
+    ofstream_.flush();
+}
+
+bool GraphJournal::read( void* value, size_t size )
+{
+    if ( size > size_t(end_ - position_) )
+    {
+        return false;
+    }
+    memcpy( value, position_, size );
+    position_ += size;
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef FORGE_GRAPHJOURNAL_HPP_INCLUDED
+#define FORGE_GRAPHJOURNAL_HPP_INCLUDED
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <ctime>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace error
+{
+
+class ErrorPolicy;
+
+}
+
+namespace forge
+{
+
+class Target;
+class Graph;
+
+/**
+// An append-only journal of changes made to Targets since their Graph was
+// last written to a dependency graph file.
+//
+// Each entry records the persistent state of a single Target identified by
+// its path.  Entries are appended and flushed as soon as a Target changes
+// so that progress survives a build being interrupted.  Replaying the
+// journal after loading the dependency graph file restores the most recent
+// state of each Target.
+*/
+class GraphJournal
+{
+    Graph* graph_; ///< The Graph that this GraphJournal records changes to.
+    std::string filename_; ///< The name of the journal file.
+    std::ofstream ofstream_; ///< The stream that entries are appended to.
+    std::string entry_; ///< The entry being written.
+    const char* position_; ///< The position of the next value in the entry being read.
+    const char* end_; ///< The end of the entry being read.
+    int entries_; ///< The number of entries appended since the journal was opened.
+
+public:
+    GraphJournal( Graph* graph );
+    ~GraphJournal();
+    const std::string& filename() const;
+    int entries() const;
+    uintmax_t size() const;
+    int replay( const std::string& filename, error::ErrorPolicy* error_policy );
+    void open( const std::string& filename );
+    void truncate();
+    void close();
+    size_t append( Target* target );
+    void value( bool value );
+    void value( uint64_t value );
+    void value( std::time_t value );
+    void value( const std::string& value );
+    void value( const std::vector<std::string>& values );
+    void refer( const std::vector<Target*>& values );
+    bool value( bool* value );
+    bool value( uint64_t* value );
+    bool value( std::time_t* value );
+    bool value( std::string* value );
+    bool value( std::vector<std::string>* values );
+    bool refer( std::vector<Target*>* values );
+
+private:
+    void header();
+    bool read( void* value, size_t size );
+};
+
+}
+
+}
+
+#endif
@@ -5,15 +5,16 @@
 
 #include "GraphReader.hpp"
 #include "Target.hpp"
+#include <process/Usage.hpp>
 #include <error/ErrorPolicy.hpp>
 #include <assert/assert.hpp>
 #include <memory>
 #include <string.h>
 
-using std::map;
 using std::vector;
-using std::string;
 using std::unique_ptr;
+using std::shared_ptr;
+using std::make_shared;
 using std::make_pair;
 using namespace sweet;
 using namespace sweet::forge;
@@ -21,118 +22,303 @@ using namespace sweet::forge;
 GraphReader::GraphReader( std::istream* istream, error::ErrorPolicy* error_policy  )
 : istream_( istream ),
   error_policy_( error_policy ),
-  address_by_old_address_()
+  header_(),
+  buffer_(),
+  records_( nullptr ),
+  references_( nullptr ),
+  strings_( nullptr ),
+  targets_(),
+  references_by_range_(),
+  strings_by_range_()
 {
     SWEET_ASSERT( istream_ );
     SWEET_ASSERT( error_policy_ );
 }
 
-void* GraphReader::find_address_by_old_address( const void* old_address ) const
-{
-    map<const void*, void*>::const_iterator i = address_by_old_address_.find( old_address );
-    return i != address_by_old_address_.end() ? i->second : nullptr;
-}
-
+/**
+// Read a Graph.
+//
+// The header is read and checked and then the remainder of the file is read
+// in a single read.  Every range and reference in the file is validated
+// before any Targets are created so that Targets can then be created
+// directly from their records without any further checks or address fix ups.
+//
+// @param filename
+//  The name of the file being read (used in error messages).
+//
+// @return
+//  The root Target of the Graph or null if the file isn't a valid
+//  dependency graph.
+*/
 std::unique_ptr<Target> GraphReader::read( const std::string& filename )
 {
     const char FORMAT [] = "Sweet Build Graph";
-    char format [sizeof(FORMAT)];
-    value( &format[0], sizeof(format) );
-    if ( strncmp(format, FORMAT, sizeof(FORMAT)) != 0 )
+    memset( &header_, 0, sizeof(header_) );
+    istream_->read( reinterpret_cast<char*>(&header_), sizeof(header_) );
+    if ( !istream_->good() || strncmp(header_.format, FORMAT, sizeof(FORMAT)) != 0 )
     {
         error_policy_->print( "The file '%s' is not a valid dependency graph", filename.c_str() );
         return unique_ptr<Target>();
     }
 
-    const int VERSION = 32;
-    int version = 0;
-    value( &version );
-    if ( version != VERSION )
+    if ( header_.version != GRAPH_FORMAT_VERSION )
+    {
+        error_policy_->print( "The file '%s' is version %d not version %d as expected", filename.c_str(), header_.version, GRAPH_FORMAT_VERSION );
+        return unique_ptr<Target>();
+    }
+
+    uint64_t records_size = uint64_t(header_.targets) * sizeof(GraphTargetRecord);
+    uint64_t references_size = uint64_t(header_.references) * sizeof(uint32_t);
+    uint64_t size = records_size + references_size + header_.strings_size;
+    buffer_.resize( size_t((size + sizeof(uint64_t) - 1) / sizeof(uint64_t)) );
+    istream_->read( reinterpret_cast<char*>(buffer_.data()), std::streamsize(size) );
+    if ( uint64_t(istream_->gcount()) != size )
+    {
+        error_policy_->print( "The file '%s' is truncated", filename.c_str() );
+        return unique_ptr<Target>();
+    }
+
+    const char* data = reinterpret_cast<const char*>( buffer_.data() );
+    records_ = reinterpret_cast<const GraphTargetRecord*>( data );
+    references_ = reinterpret_cast<const uint32_t*>( data + records_size );
+    strings_ = data + records_size + references_size;
+    if ( !valid() )
     {
-        error_policy_->print( "The file '%s' is version %d not version %d as expected", filename.c_str(), version, VERSION );
+        error_policy_->print( "The file '%s' is not a valid dependency graph", filename.c_str() );
         return unique_ptr<Target>();
     }
 
-    unique_ptr<Target> root_target;
-    root_target.reset( new Target );
-    root_target->read( *this );
-    root_target->resolve( *this );
+    unique_ptr<Target> root_target( new Target );
+    targets_.resize( header_.targets );
+    targets_[0] = root_target.get();
+    for ( uint32_t i = 1; i < header_.targets; ++i )
+    {
+        targets_[i] = new Target;
+    }
+    for ( uint32_t i = 0; i < header_.targets; ++i )
+    {
+        targets_[i]->read( *this, records_[i] );
+    }
     return root_target;
 }
 
-void GraphReader::object_address( void* address )
+/**
+// Get a string from the strings section.
+//
+// @param offset
+//  The offset of the string in the strings section.
+//
+// @return
+//  The null terminated string.
+*/
+const char* GraphReader::string( uint32_t offset ) const
 {
-    const void* old_address = nullptr;
-    istream_->read( reinterpret_cast<char*>(&old_address), sizeof(old_address) );
-    address_by_old_address_.insert( make_pair(old_address, address) );
+    SWEET_ASSERT( offset < header_.strings_size );
+    return strings_ + offset;
 }
 
-void GraphReader::value( bool* value )
+/**
+// Get the strings referred to by a range of references.
+//
+// @param range
+//  The range of references that contain offsets into the strings section.
+//
+// @param values
+//  The vector to return the strings in.
+*/
+void GraphReader::strings( const GraphRange& range, std::vector<std::string>* values ) const
 {
-    istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
+    SWEET_ASSERT( values );
+    values->reserve( range.count );
+    for ( uint32_t i = range.first; i < range.first + range.count; ++i )
+    {
+        values->push_back( string(references_[i]) );
+    }
 }
 
-void GraphReader::value( int* value )
+/**
+// Get the strings referred to by a range of references as a list shared 
+// with any other records that refer to the same range.
+//
+// @param range
+//  The range of references that contain offsets into the strings section.
+//
+// @return
+//  The list of strings (possibly empty but never null).
+*/
+std::shared_ptr<std::vector<std::string>> GraphReader::shared_strings( const GraphRange& range )
 {
-    istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
-}
+    uint64_t key = (uint64_t(range.first) << 32) | uint64_t(range.count);
+    std::unordered_map<uint64_t, shared_ptr<vector<std::string>>>::const_iterator i = strings_by_range_.find( key );
+    if ( i != strings_by_range_.end() )
+    {
+        return i->second;
+    }
 
-void GraphReader::value( uint64_t* value )
-{
-    istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
+    shared_ptr<vector<std::string>> values = make_shared<vector<std::string>>();
+    strings( range, values.get() );
+    strings_by_range_.insert( make_pair(key, values) );
+    return values;
 }
 
-void GraphReader::value( std::time_t* value )
+/**
+// Get the Targets for a range of target records.
+//
+// @param range
+//  The range of target records.
+//
+// @param targets
+//  The vector to return the Targets in.
+*/
+void GraphReader::targets( const GraphRange& range, std::vector<Target*>* targets ) const
 {
-    istream_->read( reinterpret_cast<char*>(value), sizeof(*value) );
+    SWEET_ASSERT( targets );
+    targets->assign( targets_.begin() + range.first, targets_.begin() + range.first + range.count );
 }
 
-void GraphReader::value( std::string* value )
+/**
+// Get the Targets referred to by a range of references.
+//
+// Records that share the same range of references, as written for identical
+// lists by GraphWriter::refer(), share the same list of Targets.
+//
+// @param range
+//  The range of references that contain target record indices.
+//
+// @return
+//  The list of Targets or null if the range is empty.
+*/
+std::shared_ptr<std::vector<Target*>> GraphReader::refer( const GraphRange& range )
 {
-    size_t size = 0;
-    istream_->read( reinterpret_cast<char*>(&size), sizeof(size) );
-    value->resize( size );
-    istream_->read( reinterpret_cast<char*>(&(*value)[0]), size );
+    if ( range.count == 0 )
+    {
+        return shared_ptr<vector<Target*>>();
+    }
+
+    uint64_t key = (uint64_t(range.first) << 32) | uint64_t(range.count);
+    std::unordered_map<uint64_t, shared_ptr<vector<Target*>>>::const_iterator i = references_by_range_.find( key );
+    if ( i != references_by_range_.end() )
+    {
+        return i->second;
+    }
+
+    shared_ptr<vector<Target*>> references = make_shared<vector<Target*>>();
+    references->reserve( range.count );
+    for ( uint32_t i = range.first; i < range.first + range.count; ++i )
+    {
+        references->push_back( targets_[references_[i]] );
+    }
+    references_by_range_.insert( make_pair(key, references) );
+    return references;
 }
 
-void GraphReader::value( char* value, size_t size )
+/**
+// Get the resources used by a Target's commands from a range of references.
+//
+// @param range
+//  The range of GRAPH_USAGE_REFERENCES references written by 
+//  GraphWriter::usage().
+//
+// @param usage
+//  The Usage to return the resources used in.
+*/
+void GraphReader::usage( const GraphRange& range, process::Usage* usage ) const
 {
-    istream_->read( value, size );
+    SWEET_ASSERT( range.count == GRAPH_USAGE_REFERENCES );
+    SWEET_ASSERT( usage );
+    const uint32_t* values = references_ + range.first;
+    usage->wall_time = int64_t(values[0]) * 1000;
+    usage->user_time = int64_t(values[1]) * 1000;
+    usage->system_time = int64_t(values[2]) * 1000;
+    usage->peak_memory = int64_t(values[3]) * 1024;
+    usage->input_blocks = int64_t(values[4]);
+    usage->output_blocks = int64_t(values[5]);
 }
 
-void GraphReader::value( std::vector<std::string>* values )
+/**
+// Check that the sections read from a file are consistent.
+//
+// Children must be numbered breadth-first from the root so that each Target
+// other than the root is the child of exactly one Target that precedes it.
+// All ranges must fall within their sections and all string offsets and
+// target indices must be in range.  The strings section must be null
+// terminated.
+//
+// @return
+//  True if the file is valid otherwise false.
+*/
+bool GraphReader::valid() const
 {
-    size_t length = 0;
-    istream_->read( reinterpret_cast<char*>(&length), sizeof(length) );
-    values->resize( length );
-    for ( vector<string>::iterator i = values->begin(); i != values->end(); ++i )
+    if ( header_.targets == 0 || header_.strings_size == 0 || strings_[header_.strings_size - 1] != 0 )
     {
-        value( &(*i) );
+        return false;
     }
-}
 
-void GraphReader::value( std::vector<Target*>* values )
-{
-    size_t length = 0;
-    istream_->read( reinterpret_cast<char*>(&length), sizeof(length) );
-    values->resize( length );
-    for ( vector<Target*>::iterator i = values->begin(); i != values->end(); ++i )
+    uint64_t next_target = 1;
+    for ( uint32_t i = 0; i < header_.targets; ++i )
     {
-        unique_ptr<Target> target( new Target );
-        target->read( *this );
-        *i = target.release();
+        const GraphTargetRecord& record = records_[i];
+        if ( record.id >= header_.strings_size )
+        {
+            return false;
+        }
+
+        if ( record.targets.count > 0 && (record.targets.first != next_target || record.targets.first <= i) )
+        {
+            return false;
+        }
+        next_target += record.targets.count;
+
+        if ( !valid(record.filenames, header_.references) || !valid(record.implicit_dependencies, header_.references) || !valid(record.settings_keys, header_.references) || !valid(record.usage, header_.references) )
+        {
+            return false;
+        }
+
+        if ( record.usage.count != 0 && record.usage.count != GRAPH_USAGE_REFERENCES )
+        {
+            return false;
+        }
+
+        for ( uint32_t j = record.filenames.first; j < record.filenames.first + record.filenames.count; ++j )
+        {
+            if ( references_[j] >= header_.strings_size )
+            {
+                return false;
+            }
+        }
+
+        for ( uint32_t j = record.settings_keys.first; j < record.settings_keys.first + record.settings_keys.count; ++j )
+        {
+            if ( references_[j] >= header_.strings_size )
+            {
+                return false;
+            }
+        }
+
+        for ( uint32_t j = record.implicit_dependencies.first; j < record.implicit_dependencies.first + record.implicit_dependencies.count; ++j )
+        {
+            if ( references_[j] >= header_.targets )
+            {
+                return false;
+            }
+        }
     }
+    return next_target == header_.targets;
 }
 
-void GraphReader::refer( std::vector<Target*>* values )
+/**
+// Check that a range falls within a section.
+//
+// @param range
+//  The range to check.
+//
+// @param size
+//  The number of elements in the section.
+//
+// @return
+//  True if the range is within the section otherwise false.
+*/
+bool GraphReader::valid( const GraphRange& range, uint32_t size ) const
 {
-    size_t length = 0;
-    istream_->read( reinterpret_cast<char*>(&length), sizeof(length) );
-    values->resize( length );
-    for ( vector<Target*>::iterator i = values->begin(); i != values->end(); ++i )
-    {
-        Target* target = nullptr;
-        istream_->read( reinterpret_cast<char*>(&target), sizeof(target) );
-        *i = target;
-    }
+    return uint64_t(range.first) + uint64_t(range.count) <= uint64_t(size);
 }
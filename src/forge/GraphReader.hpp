@@ -1,12 +1,12 @@
 #ifndef FORGE_GRAPHREADER_HPP_INCLUDED
 #define FORGE_GRAPHREADER_HPP_INCLUDED
 
-#include <map>
+#include "GraphFormat.hpp"
 #include <vector>
 #include <string>
 #include <istream>
 #include <memory>
-#include <ctime>
+#include <unordered_map>
 #include <stdint.h>
 
 namespace sweet
@@ -19,31 +19,47 @@ class ErrorPolicy;
 
 }
 
+namespace process
+{
+
+struct Usage;
+
+}
+
 namespace forge
 {
 
 class Target;
 
+/**
+// Read a Graph from a dependency graph file.
+*/
 class GraphReader
 {
-    std::istream* istream_;
-    error::ErrorPolicy* error_policy_;
-    std::map<const void*, void*> address_by_old_address_;
+    std::istream* istream_; ///< The stream to read the dependency graph from.
+    error::ErrorPolicy* error_policy_; ///< The ErrorPolicy to report invalid files to.
+    GraphHeader header_; ///< The header read from the dependency graph file.
+    std::vector<uint64_t> buffer_; ///< The target records, references, and strings sections read in a single read.
+    const GraphTargetRecord* records_; ///< The target records section in the buffer.
+    const uint32_t* references_; ///< The references section in the buffer.
+    const char* strings_; ///< The strings section in the buffer.
+    std::vector<Target*> targets_; ///< The Targets created for each target record.
+    std::unordered_map<uint64_t, std::shared_ptr<std::vector<Target*>>> references_by_range_; ///< The lists of Targets created for each range of references.
+    std::unordered_map<uint64_t, std::shared_ptr<std::vector<std::string>>> strings_by_range_; ///< The lists of strings created for each range of references by GraphReader::shared_strings().
 
 public:
-    GraphReader( std::istream* ostream, error::ErrorPolicy* error_policy );
-    void* find_address_by_old_address( const void* old_address ) const;
+    GraphReader( std::istream* istream, error::ErrorPolicy* error_policy );
     std::unique_ptr<Target> read( const std::string& filename );
-    void object_address( void* address );
-    void value( bool* value );
-    void value( int* value );
-    void value( uint64_t* value );
-    void value( std::time_t* value );
-    void value( std::string* value );
-    void value( char* value, size_t size );
-    void value( std::vector<std::string>* values );
-    void value( std::vector<Target*>* values );
-    void refer( std::vector<Target*>* references );
+    const char* string( uint32_t offset ) const;
+    void strings( const GraphRange& range, std::vector<std::string>* values ) const;
+    std::shared_ptr<std::vector<std::string>> shared_strings( const GraphRange& range );
+    void targets( const GraphRange& range, std::vector<Target*>* targets ) const;
+    std::shared_ptr<std::vector<Target*>> refer( const GraphRange& range );
+    void usage( const GraphRange& range, process::Usage* usage ) const;
+
+private:
+    bool valid() const;
+    bool valid( const GraphRange& range, uint32_t size ) const;
 };
 
 }
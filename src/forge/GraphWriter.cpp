@@ -5,95 +5,283 @@
 
 #include "GraphWriter.hpp"
 #include "Target.hpp"
+#include <process/Usage.hpp>
 #include <assert/assert.hpp>
+#include <algorithm>
+#include <functional>
+#include <string.h>
 
-using std::string;
 using std::vector;
+using std::make_pair;
+using std::unordered_map;
+using std::unordered_multimap;
 using namespace sweet::forge;
 
 GraphWriter::GraphWriter( std::ostream* ostream )
-: ostream_( ostream )
+: ostream_( ostream ),
+  targets_(),
+  index_by_target_(),
+  records_(),
+  references_(),
+  strings_(),
+  offset_by_string_(),
+  ranges_by_hash_()
 {
     SWEET_ASSERT( ostream_ );
 }
 
+/**
+// Write the Graph rooted at \e root_target.
+//
+// Targets are numbered in breadth-first order so that the children of each
+// Target are contiguous, each Target writes its record, and then the header
+// and the target records, references, and strings sections are written out
+// in one pass each.
+//
+// @param root_target
+//  The root Target of the Graph to write.
+*/
 void GraphWriter::write( Target* root_target )
 {
     SWEET_ASSERT( root_target );
-    const char FORMAT [] = "Sweet Build Graph";
-    value( &FORMAT[0], sizeof(FORMAT) );
-    const int VERSION = 32;
-    value( VERSION );
-    root_target->write( *this );
-}
 
-void GraphWriter::object_address( const void* address )
-{
-    ostream_->write( reinterpret_cast<const char*>(&address), sizeof(address) );
-}
+    targets_.clear();
+    index_by_target_.clear();
+    records_.clear();
+    references_.clear();
+    strings_.clear();
+    offset_by_string_.clear();
+    ranges_by_hash_.clear();
 
-void GraphWriter::value( bool value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    targets_.push_back( root_target );
+    for ( size_t i = 0; i < targets_.size(); ++i )
+    {
+        const vector<Target*>& targets = targets_[i]->targets();
+        targets_.insert( targets_.end(), targets.begin(), targets.end() );
+    }
 
-void GraphWriter::value( int value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
-}
+    index_by_target_.reserve( targets_.size() );
+    for ( size_t i = 0; i < targets_.size(); ++i )
+    {
+        index_by_target_.insert( make_pair(targets_[i], uint32_t(i)) );
+    }
 
-void GraphWriter::value( uint64_t value )
-{
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
+    // The empty string is always at offset zero.
+    string( std::string() );
+
+    records_.resize( targets_.size() );
+    for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
+    {
+        Target* target = *i;
+        SWEET_ASSERT( target );
+        target->write( *this );
+    }
+
+    const char FORMAT [] = "Sweet Build Graph";
+    GraphHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.format, FORMAT, sizeof(FORMAT) );
+    header.version = GRAPH_FORMAT_VERSION;
+    header.targets = uint32_t(records_.size());
+    header.references = uint32_t(references_.size());
+    header.strings_size = uint32_t(strings_.size());
+
+    ostream_->write( reinterpret_cast<const char*>(&header), sizeof(header) );
+    ostream_->write( reinterpret_cast<const char*>(records_.data()), records_.size() * sizeof(GraphTargetRecord) );
+    ostream_->write( reinterpret_cast<const char*>(references_.data()), references_.size() * sizeof(uint32_t) );
+    ostream_->write( strings_.data(), strings_.size() );
 }
 
-void GraphWriter::value( std::time_t value )
+/**
+// Get the record to write \e target into.
+//
+// @param target
+//  The Target to get the record for (assumed to be part of the Graph being
+//  written).
+//
+// @return
+//  The record for \e target.
+*/
+GraphTargetRecord* GraphWriter::record( const Target* target )
 {
-    ostream_->write( reinterpret_cast<const char*>(&value), sizeof(value) );
+    unordered_map<const Target*, uint32_t>::const_iterator i = index_by_target_.find( target );
+    SWEET_ASSERT( i != index_by_target_.end() );
+    GraphTargetRecord* record = &records_[i->second];
+    memset( record, 0, sizeof(*record) );
+    return record;
 }
 
-void GraphWriter::value( const std::string& value )
+/**
+// Add a string to the strings section.
+//
+// Identical strings are only written once.
+//
+// @param value
+//  The string to add.
+//
+// @return
+//  The offset of the null terminated string in the strings section.
+*/
+uint32_t GraphWriter::string( const std::string& value )
 {
-    size_t size = value.size();
-    ostream_->write( reinterpret_cast<const char*>(&size), sizeof(size) );
-    ostream_->write( reinterpret_cast<const char*>(value.c_str()), size );
+    unordered_map<std::string, uint32_t>::const_iterator i = offset_by_string_.find( value );
+    if ( i != offset_by_string_.end() )
+    {
+        return i->second;
+    }
+    uint32_t offset = uint32_t(strings_.size());
+    strings_.append( value.c_str(), value.size() + 1 );
+    offset_by_string_.insert( make_pair(value, offset) );
+    return offset;
 }
 
-void GraphWriter::value( const char* value, size_t size )
+/**
+// Add strings to the strings section and their offsets to the references
+// section.
+//
+// Identical lists of strings, e.g. the settings keys of objects built by the
+// same toolset, are only written once and share the same range.
+//
+// @param values
+//  The strings to add.
+//
+// @return
+//  The range of references that contain the offsets of the strings.
+*/
+GraphRange GraphWriter::strings( const std::vector<std::string>& values )
 {
-    ostream_->write( value, size );
+    GraphRange range = { uint32_t(references_.size()), uint32_t(values.size()) };
+    for ( vector<std::string>::const_iterator i = values.begin(); i != values.end(); ++i )
+    {
+        uint32_t offset = string( *i );
+        references_.push_back( offset );
+    }
+    return share( range );
 }
 
-void GraphWriter::value( const std::vector<std::string>& values )
+/**
+// Get the range of records that contain the children of a Target.
+//
+// @param targets
+//  The children of the Target being written.
+//
+// @return
+//  The range of records that the children are written to.
+*/
+GraphRange GraphWriter::targets( const std::vector<Target*>& targets )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
-    for ( vector<string>::const_iterator i = values.begin(); i != values.end(); ++i )
+    GraphRange range = { 0, uint32_t(targets.size()) };
+    if ( !targets.empty() )
     {
-        value( *i );
+        unordered_map<const Target*, uint32_t>::const_iterator i = index_by_target_.find( targets.front() );
+        SWEET_ASSERT( i != index_by_target_.end() );
+        range.first = i->second;
     }
+    return range;
 }
 
-void GraphWriter::value( const std::vector<Target*>& values )
+/**
+// Add references to Targets to the references section.
+//
+// References to Targets that aren't part of the Graph being written are
+// quietly dropped.  Identical lists of references, e.g. the implicit 
+// dependencies of objects that include the same headers, are only written
+// once and share the same range.
+//
+// @param values
+//  The Targets to refer to.
+//
+// @return
+//  The range of references that contain the indices of the Targets.
+*/
+GraphRange GraphWriter::refer( const std::vector<Target*>& values )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
+    GraphRange range = { uint32_t(references_.size()), 0 };
     for ( vector<Target*>::const_iterator i = values.begin(); i != values.end(); ++i )
     {
-        Target* target = *i;
-        SWEET_ASSERT( target );
-        target->write( *this );
+        unordered_map<const Target*, uint32_t>::const_iterator index = index_by_target_.find( *i );
+        if ( index != index_by_target_.end() )
+        {
+            references_.push_back( index->second );
+        }
     }
+    range.count = uint32_t(references_.size()) - range.first;
+    return share( range );
 }
 
-void GraphWriter::refer( const std::vector<Target*>& values )
+/**
+// Add the resources used by a Target's commands to the references section.
+//
+// Times are rounded to the nearest millisecond and peak memory to the 
+// nearest kilobyte so that each value fits in a 32-bit reference.  Values
+// too large to fit are clamped.
+//
+// @param usage
+//  The resources used.
+//
+// @return
+//  The range of GRAPH_USAGE_REFERENCES references that contain the values.
+*/
+GraphRange GraphWriter::usage( const process::Usage& usage )
 {
-    size_t length = values.size();
-    ostream_->write( reinterpret_cast<const char*>(&length), sizeof(length) );
-    for ( vector<Target*>::const_iterator i = values.begin(); i != values.end(); ++i )
+    struct Clamp
     {
-        Target* target = *i;
-        SWEET_ASSERT( target );
-        ostream_->write( reinterpret_cast<const char*>(&target), sizeof(target) );
+        static uint32_t value( int64_t value, int64_t unit )
+        {
+            int64_t rounded = (value + unit / 2) / unit;
+            return uint32_t( std::max(int64_t(0), std::min(rounded, int64_t(UINT32_MAX))) );
+        }
+    };
+
+    GraphRange range = { uint32_t(references_.size()), GRAPH_USAGE_REFERENCES };
+    references_.push_back( Clamp::value(usage.wall_time, 1000) );
+    references_.push_back( Clamp::value(usage.user_time, 1000) );
+    references_.push_back( Clamp::value(usage.system_time, 1000) );
+    references_.push_back( Clamp::value(usage.peak_memory, 1024) );
+    references_.push_back( Clamp::value(usage.input_blocks, 1) );
+    references_.push_back( Clamp::value(usage.output_blocks, 1) );
+    return share( range );
+}
+
+/**
+// Share a range of references just added to the end of the references 
+// section with an identical range written earlier.
+//
+// @param range
+//  The range of references to share (assumed to be at the end of the
+//  references section).
+//
+// @return
+//  The identical range written earlier, in which case \e range is removed
+//  from the references section, or \e range if there isn't one.
+*/
+GraphRange GraphWriter::share( const GraphRange& range )
+{
+    SWEET_ASSERT( range.first + range.count == references_.size() );
+    if ( range.count > 0 )
+    {
+        size_t hash = 0;
+        for ( vector<uint32_t>::const_iterator i = references_.begin() + range.first; i != references_.end(); ++i )
+        {
+            hash ^= std::hash<uint32_t>()( *i ) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        }
+
+        typedef unordered_multimap<size_t, GraphRange>::const_iterator iterator;
+        std::pair<iterator, iterator> ranges = ranges_by_hash_.equal_range( hash );
+        for ( iterator i = ranges.first; i != ranges.second; ++i )
+        {
+            const GraphRange& existing_range = i->second;
+            bool identical = 
+                existing_range.count == range.count &&
+                std::equal( references_.begin() + range.first, references_.end(), references_.begin() + existing_range.first )
+            ;
+            if ( identical )
+            {
+                references_.resize( range.first );
+                return existing_range;
+            }
+        }
+        ranges_by_hash_.insert( make_pair(hash, range) );
     }
+    return range;
 }
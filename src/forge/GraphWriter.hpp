@@ -1,38 +1,54 @@
 #ifndef FORGE_GRAPHWRITER_HPP_INCLUDED
 #define FORGE_GRAPHWRITER_HPP_INCLUDED
 
+#include "GraphFormat.hpp"
 #include <vector>
 #include <string>
 #include <ostream>
-#include <memory>
-#include <ctime>
+#include <unordered_map>
 #include <stdint.h>
 
 namespace sweet
 {
 
+namespace process
+{
+
+struct Usage;
+
+}
+
 namespace forge
 {
 
 class Target;
 
+/**
+// Write a Graph to a dependency graph file.
+*/
 class GraphWriter
 {
-    std::ostream* ostream_;
+    std::ostream* ostream_; ///< The stream to write the dependency graph to.
+    std::vector<Target*> targets_; ///< The Targets being written in breadth-first order.
+    std::unordered_map<const Target*, uint32_t> index_by_target_; ///< The record index of each Target being written.
+    std::vector<GraphTargetRecord> records_; ///< The target records section.
+    std::vector<uint32_t> references_; ///< The references section.
+    std::string strings_; ///< The strings section.
+    std::unordered_map<std::string, uint32_t> offset_by_string_; ///< The offset of each string in the strings section.
+    std::unordered_multimap<size_t, GraphRange> ranges_by_hash_; ///< The ranges of references written by GraphWriter::strings() and GraphWriter::refer() by hash of their contents.
 
 public:
     GraphWriter( std::ostream* ostream );
     void write( Target* root_target );
-    void object_address( const void* address );
-    void value( bool value );
-    void value( int value );
-    void value( uint64_t value );
-    void value( std::time_t value );
-    void value( const std::string& value );
-    void value( const char* value, size_t size );
-    void value( const std::vector<std::string>& values );
-    void value( const std::vector<Target*>& values );
-    void refer( const std::vector<Target*>& references );
+    GraphTargetRecord* record( const Target* target );
+    uint32_t string( const std::string& value );
+    GraphRange strings( const std::vector<std::string>& values );
+    GraphRange targets( const std::vector<Target*>& targets );
+    GraphRange refer( const std::vector<Target*>& references );
+    GraphRange usage( const process::Usage& usage );
+
+private:
+    GraphRange share( const GraphRange& range );
 };
 
 }
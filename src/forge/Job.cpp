@@ -6,17 +6,32 @@
 #include "Job.hpp"
 #include "Target.hpp"
 #include <assert/assert.hpp>
+#include <algorithm>
+#include <string.h>
 
+using std::find;
+using std::string;
+using std::vector;
 using namespace sweet;
 using namespace sweet::forge;
 
 Job::Job( Target* target, int height )
 : target_( target ),
   height_( height ),
-  state_( JOB_WAITING )
+  state_( JOB_WAITING ),
+  fingerprint_( 0 ),
+  commands_( 0 ),
+  replaying_( false ),
+  processes_( 0 ),
+  usage_(),
+  expected_time_( 0 ),
+  implicit_dependencies_(),
+  filenames_()
 {
     SWEET_ASSERT( target_ );
     SWEET_ASSERT( height_ >= 0 );
+    const process::Usage* usage = target_->usage();
+    expected_time_ = target_->built() ? (usage ? usage->wall_time : 0) : -1;
 }
 
 Target* Job::target() const
@@ -53,3 +68,157 @@ void Job::set_state( JobState state )
     SWEET_ASSERT( state >= JOB_WAITING && state <= JOB_COMPLETE );
     state_ = state;
 }
+
+/**
+// Prepare to replay the commands from the previous build of this Job's 
+// Target.
+//
+// Resets the digest of, and the resources used by, the commands executed 
+// by this Job and, if the Target can replay its previous commands (see 
+// Target::replayable()), records the implicit dependencies and filenames 
+// that executing those commands produced last time so that they can be 
+// restored when they're replayed.
+*/
+void Job::begin_replay()
+{
+    SWEET_ASSERT( target_ );
+    fingerprint_ = 0;
+    commands_ = 0;
+    processes_ = 0;
+    memset( &usage_, 0, sizeof(usage_) );
+    replaying_ = target_->replayable();
+    implicit_dependencies_.clear();
+    filenames_.clear();
+    if ( replaying_ )
+    {
+        implicit_dependencies_ = target_->implicit_dependencies();
+        filenames_ = target_->filenames();
+    }
+    target_->set_replayed( false );
+}
+
+/**
+// Add a command to the digest of the commands executed by this Job and 
+// decide whether or not it can be replayed instead of executed.
+//
+// A command is replayed when it is the first and only command that this 
+// Job's Target executed last time, it is identical to that command, and the
+// Target's prototype builds it with a single command.  The
+// command's output is then left as it is and the implicit dependencies and 
+// filenames recorded before this Job was visited are restored in case its
+// build function cleared them expecting the command to rediscover them.
+//
+// @param fingerprint
+//  The digest of the command, command line, environment, and working
+//  directory of the command.
+//
+// @return
+//  True if the command should be replayed rather than executed otherwise
+//  false.
+*/
+bool Job::replay( uint64_t fingerprint )
+{
+    SWEET_ASSERT( target_ );
+
+    const uint64_t FNV_PRIME = 0x100000001b3ull;
+    fingerprint_ = (fingerprint_ ^ fingerprint) * FNV_PRIME;
+    ++commands_;
+    replaying_ = replaying_ && commands_ == 1 && Job::fingerprint() == target_->fingerprint();
+    if ( replaying_ )
+    {
+        for ( vector<Target*>::const_iterator i = implicit_dependencies_.begin(); i != implicit_dependencies_.end(); ++i )
+        {
+            target_->add_implicit_dependency( *i );
+        }
+        const vector<string>& filenames = target_->filenames();
+        for ( vector<string>::const_iterator i = filenames_.begin(); i != filenames_.end(); ++i )
+        {
+            if ( find(filenames.begin(), filenames.end(), *i) == filenames.end() )
+            {
+                target_->add_filename( *i );
+            }
+        }
+    }
+    return replaying_;
+}
+
+/**
+// Get the digest of the commands executed by this Job.
+//
+// @return
+//  The digest of the commands executed or 0 if no commands were executed.
+*/
+uint64_t Job::fingerprint() const
+{
+    const uint64_t FNV_PRIME = 0x100000001b3ull;
+    return commands_ > 0 ? (fingerprint_ ^ uint64_t(commands_)) * FNV_PRIME : 0;
+}
+
+/**
+// Did this Job replay every command that it executed?
+//
+// @return
+//  True if this Job executed at least one command and replayed all of them
+//  otherwise false.
+*/
+bool Job::replayed() const
+{
+    return commands_ > 0 && replaying_;
+}
+
+/**
+// Add the resources used by a process executed by this Job.
+//
+// Times and block input and output are summed and peak memory is the 
+// largest peak of any one process.
+//
+// @param usage
+//  The resources used by the process.
+*/
+void Job::add_usage( const process::Usage& usage )
+{
+    ++processes_;
+    usage_.wall_time += usage.wall_time;
+    usage_.user_time += usage.user_time;
+    usage_.system_time += usage.system_time;
+    usage_.peak_memory = std::max( usage_.peak_memory, usage.peak_memory );
+    usage_.input_blocks += usage.input_blocks;
+    usage_.output_blocks += usage.output_blocks;
+}
+
+/**
+// Get the number of processes executed, rather than replayed, by this Job.
+//
+// @return
+//  The number of processes executed.
+*/
+int Job::processes() const
+{
+    return processes_;
+}
+
+/**
+// Get the total resources used by the processes executed by this Job.
+//
+// @return
+//  The resources used.
+*/
+const process::Usage& Job::usage() const
+{
+    return usage_;
+}
+
+/**
+// Get the wall time that this Job's Target took to build last time.
+//
+// The time is captured when this Job is created so that it isn't replaced
+// by the resources used by this Job once it finishes.
+//
+// @return
+//  The wall time in microseconds, 0 if the Target executed no commands, or
+//  -1 if the Target hasn't been built before.
+*/
+int64_t Job::expected_time() const
+{
+    return expected_time_;
+}
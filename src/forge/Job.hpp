@@ -1,7 +1,10 @@
 #ifndef FORGE_JOB_HPP_INCLUDED
 #define FORGE_JOB_HPP_INCLUDED
 
+#include <process/Usage.hpp>
 #include <string>
+#include <vector>
+#include <stdint.h>
 
 namespace sweet
 {
@@ -30,6 +33,14 @@ class Job
     Target* target_; ///< The Target that this Job is for.
     int height_; ///< The height of this Job in its Graph.
     JobState state_; ///< The JobState of this Job.
+    uint64_t fingerprint_; ///< The running digest of the commands executed so far by this Job.
+    int commands_; ///< The number of commands executed so far by this Job.
+    bool replaying_; ///< Whether or not every command executed so far by this Job has been replayed.
+    int processes_; ///< The number of processes executed, rather than replayed, so far by this Job.
+    process::Usage usage_; ///< The total resources used by the processes executed so far by this Job.
+    int64_t expected_time_; ///< The wall time in microseconds that this Job's Target took to build last time or -1 if it hasn't been built before.
+    std::vector<Target*> implicit_dependencies_; ///< The implicit dependencies of this Job's Target before it was visited, restored when its commands are replayed.
+    std::vector<std::string> filenames_; ///< The filenames of this Job's Target before it was visited, restored when its commands are replayed.
 
     public:
         Job( Target* target, int height );
@@ -41,6 +52,14 @@ class Job
         bool operator<( const Job& job ) const;
 
         void set_state( JobState state );        
+        void begin_replay();
+        bool replay( uint64_t fingerprint );
+        uint64_t fingerprint() const;
+        bool replayed() const;
+        void add_usage( const process::Usage& usage );
+        int processes() const;
+        const process::Usage& usage() const;
+        int64_t expected_time() const;
 };
 
 }
@@ -0,0 +1,177 @@
+//
+// Phases.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Phases.hpp"
+#include "System.hpp"
+#include <assert/assert.hpp>
+
+using std::string;
+using std::vector;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// Constructor.
+//
+// @param phases
+//  The Phases to record the phase with.
+//
+// @param name
+//  The name of the phase (assumed to be a string literal).
+*/
+Phases::Scope::Scope( Phases* phases, const char* name )
+: phases_( phases ),
+  name_( name )
+{
+    SWEET_ASSERT( phases_ );
+    SWEET_ASSERT( name_ );
+    phases_->begin( name_ );
+}
+
+/**
+// Destructor.
+//
+// Ends the phase begun at construction.
+*/
+Phases::Scope::~Scope()
+{
+    phases_->end( name_ );
+}
+
+/**
+// Constructor.
+//
+// @param system
+//  The System that provides the current time (assumed not null).
+*/
+Phases::Phases( const System* system )
+: system_( system ),
+  phases_(),
+  counters_()
+{
+    SWEET_ASSERT( system_ );
+}
+
+/**
+// Get the phases recorded since this Phases was created or last cleared.
+//
+// @return
+//  The phases in the order that they were first begun.
+*/
+const std::vector<Phases::Phase>& Phases::phases() const
+{
+    return phases_;
+}
+
+/**
+// Get the counters recorded since this Phases was created or last cleared.
+//
+// @return
+//  The counters in the order that they were first added to.
+*/
+const std::vector<Phases::Counter>& Phases::counters() const
+{
+    return counters_;
+}
+
+/**
+// Discard all phases and counters.
+*/
+void Phases::clear()
+{
+    phases_.clear();
+    counters_.clear();
+}
+
+/**
+// Begin timing a phase.
+//
+// @param name
+//  The name of the phase to begin.
+*/
+void Phases::begin( const std::string& name )
+{
+    Phase* phase = find_phase( name );
+    if ( !phase )
+    {
+        Phase new_phase = { name, 0.0, 0, 0, 0.0 };
+        phases_.push_back( new_phase );
+        phase = &phases_.back();
+    }
+    if ( phase->depth == 0 )
+    {
+        phase->begin = system_->ticks();
+    }
+    ++phase->depth;
+}
+
+/**
+// End timing a phase.
+//
+// @param name
+//  The name of the phase to end.
+//
+// @return
+//  True if the phase was active and has been ended or false if the phase 
+//  wasn't active.
+*/
+bool Phases::end( const std::string& name )
+{
+    Phase* phase = find_phase( name );
+    if ( !phase || phase->depth <= 0 )
+    {
+        return false;
+    }
+    --phase->depth;
+    if ( phase->depth == 0 )
+    {
+        phase->milliseconds += system_->ticks() - phase->begin;
+        ++phase->count;
+    }
+    return true;
+}
+
+/**
+// Add to a counter.
+//
+// @param name
+//  The name of the counter to add to.
+//
+// @param amount
+//  The amount to add to the counter.
+*/
+void Phases::count( const std::string& name, int64_t amount )
+{
+    for ( vector<Counter>::iterator i = counters_.begin(); i != counters_.end(); ++i )
+    {
+        if ( i->name == name )
+        {
+            i->total += amount;
+            return;
+        }
+    }
+    Counter counter = { name, amount };
+    counters_.push_back( counter );
+}
+
+/**
+// Find a phase by name.
+//
+// There are only ever a handful of phases so a linear search is fine.
+//
+// @return
+//  The phase named \e name or null if there is no such phase.
+*/
+Phases::Phase* Phases::find_phase( const std::string& name )
+{
+    for ( vector<Phase>::iterator i = phases_.begin(); i != phases_.end(); ++i )
+    {
+        if ( i->name == name )
+        {
+            return &(*i);
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,85 @@
+#ifndef FORGE_PHASES_HPP_INCLUDED
+#define FORGE_PHASES_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class System;
+
+/**
+// Accumulate the wall-clock time spent in named phases of a build and the 
+// totals of named counters so that they can be reported as a breakdown 
+// when the build finishes.
+//
+// Phases may nest and may be begun again while they are already active.  
+// Only the outermost begin and end of a phase are timed so that recursive 
+// phases aren't counted twice.  Times are inclusive of any phases nested 
+// within them.
+*/
+class Phases
+{
+public:
+    /**
+    // A phase and the time spent in it.
+    */
+    struct Phase
+    {
+        std::string name; ///< The name of the phase.
+        double milliseconds; ///< The total time spent in the phase.
+        int count; ///< The number of times that the phase has completed.
+        int depth; ///< The number of times that the phase is currently active.
+        double begin; ///< The time that the phase last became active.
+    };
+
+    /**
+    // A counter and its total.
+    */
+    struct Counter
+    {
+        std::string name; ///< The name of the counter.
+        int64_t total; ///< The total of the amounts added to the counter.
+    };
+
+    /**
+    // Time a phase from construction to destruction of this object.
+    */
+    class Scope
+    {
+        Phases* phases_; ///< The Phases to record the phase with.
+        const char* name_; ///< The name of the phase (assumed to be a string literal).
+
+    public:
+        Scope( Phases* phases, const char* name );
+        ~Scope();
+    };
+
+private:
+    const System* system_; ///< The System that provides the current time.
+    std::vector<Phase> phases_; ///< The phases in the order that they were first begun.
+    std::vector<Counter> counters_; ///< The counters in the order that they were first added to.
+
+public:
+    Phases( const System* system );
+    const std::vector<Phase>& phases() const;
+    const std::vector<Counter>& counters() const;
+    void clear();
+    void begin( const std::string& name );
+    bool end( const std::string& name );
+    void count( const std::string& name, int64_t amount );
+
+private:
+    Phase* find_phase( const std::string& name );
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,316 @@
+//
+// Profiler.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Profiler.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <lua.hpp>
+
+using std::string;
+using std::vector;
+using std::pair;
+using std::unordered_map;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// The address used as the key of the Profiler in the Lua registry.
+*/
+static const char PROFILER_KEY = 0;
+
+/**
+// The name that samples taken while no buildfile is loading are attributed
+// to.
+*/
+static const char* NO_BUILDFILE = "(no buildfile)";
+
+/**
+// Constructor.
+*/
+Profiler::Profiler()
+: enabled_( false ),
+  filename_(),
+  interval_( 0 ),
+  samples_( 0 ),
+  functions_(),
+  buildfiles_(),
+  stacks_()
+{
+}
+
+/**
+// Is profiling enabled?
+//
+// @return
+//  True if samples are being taken otherwise false.
+*/
+bool Profiler::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Get the name of the file that folded stacks are written to.
+//
+// @return
+//  The filename or an empty string if profiling hasn't been started.
+*/
+const std::string& Profiler::filename() const
+{
+    return filename_;
+}
+
+/**
+// Get the number of samples taken since profiling was started.
+//
+// @return
+//  The number of samples.
+*/
+int64_t Profiler::samples() const
+{
+    return samples_;
+}
+
+/**
+// Get the samples taken in each function.
+//
+// @return
+//  The functions sampled sorted by the number of samples taken at the top
+//  of the stack in descending order.
+*/
+std::vector<Profiler::Function> Profiler::functions() const
+{
+    vector<Function> functions;
+    functions.reserve( functions_.size() );
+    for ( unordered_map<string, Function>::const_iterator i = functions_.begin(); i != functions_.end(); ++i )
+    {
+        functions.push_back( i->second );
+    }
+    std::sort( functions.begin(), functions.end(), []( const Function& lhs, const Function& rhs ) {
+        return lhs.self != rhs.self ? lhs.self > rhs.self : lhs.name < rhs.name;
+    } );
+    return functions;
+}
+
+/**
+// Get the samples taken while loading each buildfile.
+//
+// @return
+//  The path to each buildfile and the number of samples taken while it was
+//  loading sorted by the number of samples in descending order.
+*/
+std::vector<std::pair<std::string, int64_t>> Profiler::buildfiles() const
+{
+    vector<pair<string, int64_t>> buildfiles( buildfiles_.begin(), buildfiles_.end() );
+    std::sort( buildfiles.begin(), buildfiles.end(), []( const pair<string, int64_t>& lhs, const pair<string, int64_t>& rhs ) {
+        return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+    } );
+    return buildfiles;
+}
+
+/**
+// Start taking samples.
+//
+// Samples taken since profiling was last started are discarded.  Only Lua
+// coroutines passed to `install()` after profiling is started are sampled.
+//
+// @param filename
+//  The name of the file to write folded stacks to (see Profiler::write()).
+//
+// @param interval
+//  The number of Lua VM instructions between samples.
+*/
+void Profiler::start( const std::string& filename, int interval )
+{
+    SWEET_ASSERT( interval > 0 );
+    filename_ = filename;
+    interval_ = std::max( interval, 1 );
+    samples_ = 0;
+    functions_.clear();
+    buildfiles_.clear();
+    stacks_.clear();
+    enabled_ = true;
+}
+
+/**
+// Install the count hook that takes samples on a Lua coroutine.
+//
+// Does nothing if profiling hasn't been started.
+//
+// @param lua_state
+//  The Lua coroutine to sample.
+*/
+void Profiler::install( lua_State* lua_state )
+{
+    SWEET_ASSERT( lua_state );
+    if ( enabled_ )
+    {
+        lua_pushlightuserdata( lua_state, this );
+        lua_rawsetp( lua_state, LUA_REGISTRYINDEX, &PROFILER_KEY );
+        lua_sethook( lua_state, &Profiler::hook, LUA_MASKCOUNT, interval_ );
+    }
+}
+
+/**
+// Write the samples taken since profiling was started to the file passed
+// to Profiler::start() as folded stacks.
+//
+// Each line is a stack from the outermost buildfile to the function at the
+// top of the stack separated by semicolons followed by a space and the
+// number of samples taken with that stack as read by `flamegraph.pl`,
+// speedscope, and similar tools.
+//
+// @return
+//  True if the folded stacks were written successfully otherwise false.
+*/
+bool Profiler::write() const
+{
+    if ( filename_.empty() )
+    {
+        return true;
+    }
+
+    FILE* file = fopen( filename_.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+
+    vector<pair<string, int64_t>> stacks( stacks_.begin(), stacks_.end() );
+    std::sort( stacks.begin(), stacks.end() );
+    for ( vector<pair<string, int64_t>>::const_iterator i = stacks.begin(); i != stacks.end(); ++i )
+    {
+        fprintf( file, "%s %" PRId64 "\n", i->first.c_str(), i->second );
+    }
+
+    bool successful = ferror( file ) == 0;
+    successful = fclose( file ) == 0 && successful;
+    return successful;
+}
+
+/**
+// Print a flat profile of the functions with the most samples taken at the
+// top of the stack and anywhere on the stack and of the buildfiles with
+// the most samples taken while they were loading.
+//
+// @param count
+//  The maximum number of functions and buildfiles to print in each list.
+*/
+void Profiler::print( int count ) const
+{
+    struct Printer
+    {
+        static double percent( int64_t samples, int64_t total )
+        {
+            return total > 0 ? 100.0 * double(samples) / double(total) : 0.0;
+        }
+    };
+
+    vector<Function> functions = Profiler::functions();
+    printf( "Self samples:\n" );
+    int printed = std::min( count, int(functions.size()) );
+    for ( int i = 0; i < printed && functions[i].self > 0; ++i )
+    {
+        const Function& function = functions[i];
+        printf( "%10" PRId64 " %5.1f%% %s\n", function.self, Printer::percent(function.self, samples_), function.name.c_str() );
+    }
+
+    std::stable_sort( functions.begin(), functions.end(), []( const Function& lhs, const Function& rhs ) {
+        return lhs.total > rhs.total;
+    } );
+    printf( "Total samples:\n" );
+    for ( int i = 0; i < printed; ++i )
+    {
+        const Function& function = functions[i];
+        printf( "%10" PRId64 " %5.1f%% %s\n", function.total, Printer::percent(function.total, samples_), function.name.c_str() );
+    }
+
+    vector<pair<string, int64_t>> buildfiles = Profiler::buildfiles();
+    printf( "Buildfiles:\n" );
+    printed = std::min( count, int(buildfiles.size()) );
+    for ( int i = 0; i < printed; ++i )
+    {
+        const pair<string, int64_t>& buildfile = buildfiles[i];
+        printf( "%10" PRId64 " %5.1f%% %s\n", buildfile.second, Printer::percent(buildfile.second, samples_), buildfile.first.c_str() );
+    }
+    printf( "%" PRId64 " samples taken every %d instructions\n", samples_, interval_ );
+}
+
+/**
+// Take a sample of the stack of \e lua_state.
+*/
+void Profiler::sample( lua_State* lua_state )
+{
+    SWEET_ASSERT( lua_state );
+
+    // Walk the stack from the top collecting the name and location of each
+    // function and the source of the outermost main chunk.
+    vector<string> frames;
+    string buildfile( NO_BUILDFILE );
+    lua_Debug debug;
+    for ( int level = 0; lua_getstack(lua_state, level, &debug); ++level )
+    {
+        lua_getinfo( lua_state, "Sn", &debug );
+        char frame [512];
+        if ( strcmp(debug.what, "main") == 0 )
+        {
+            snprintf( frame, sizeof(frame), "main chunk (%s)", debug.short_src );
+            buildfile = debug.source[0] == '@' ? debug.source + 1 : debug.short_src;
+        }
+        else if ( strcmp(debug.what, "C") == 0 )
+        {
+            snprintf( frame, sizeof(frame), "%s [C]", debug.name ? debug.name : "?" );
+        }
+        else
+        {
+            snprintf( frame, sizeof(frame), "%s (%s:%d)", debug.name ? debug.name : "?", debug.short_src, debug.linedefined );
+        }
+        frames.push_back( frame );
+    }
+
+    if ( frames.empty() )
+    {
+        return;
+    }
+
+    ++samples_;
+    buildfiles_[buildfile] += 1;
+
+    string stack( buildfile );
+    for ( vector<string>::const_reverse_iterator i = frames.rbegin(); i != frames.rend(); ++i )
+    {
+        stack += ";";
+        stack += *i;
+
+        // Count recursive functions once per sample in their totals.
+        if ( std::find(frames.crbegin(), i, *i) == i )
+        {
+            Function& function = functions_[*i];
+            function.name = *i;
+            function.total += 1;
+        }
+    }
+    functions_[frames.front()].self += 1;
+    stacks_[stack] += 1;
+}
+
+/**
+// The Lua count hook that samples the stack of the coroutine that it is
+// called from.
+*/
+void Profiler::hook( lua_State* lua_state, lua_Debug* /*debug*/ )
+{
+    SWEET_ASSERT( lua_state );
+    lua_rawgetp( lua_state, LUA_REGISTRYINDEX, &PROFILER_KEY );
+    Profiler* profiler = (Profiler*) lua_touserdata( lua_state, -1 );
+    lua_pop( lua_state, 1 );
+    if ( profiler && profiler->enabled_ )
+    {
+        profiler->sample( lua_state );
+    }
+}
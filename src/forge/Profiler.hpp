@@ -0,0 +1,76 @@
+#ifndef FORGE_PROFILER_HPP_INCLUDED
+#define FORGE_PROFILER_HPP_INCLUDED
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+struct lua_State;
+struct lua_Debug;
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// Sample the Lua call stacks of buildfiles, prototype functions, and
+// toolset helpers every fixed number of Lua VM instructions.
+//
+// Profiling is disabled until `start()` is called after which the count hook
+// is installed on each Lua coroutine passed to `install()`.  Samples are
+// aggregated by function, by the buildfile being loaded when they were
+// taken, and by whole stack so that they can be printed as a flat profile
+// and written out as folded stacks for flame graph tools.
+//
+// A sample is attributed to the buildfile or root build script whose main
+// chunk is outermost on the sampled stack.  Samples taken while no
+// buildfile is loading (e.g. in postorder visits) are attributed to
+// "(no buildfile)".
+*/
+class Profiler
+{
+public:
+    /**
+    // The samples taken in a function.
+    */
+    struct Function
+    {
+        std::string name; ///< The name and location of the function.
+        int64_t self; ///< The number of samples taken with the function at the top of the stack.
+        int64_t total; ///< The number of samples taken with the function anywhere on the stack.
+    };
+
+private:
+    bool enabled_; ///< True when samples are being taken.
+    std::string filename_; ///< The file to write folded stacks to.
+    int interval_; ///< The number of Lua VM instructions between samples.
+    int64_t samples_; ///< The number of samples taken since profiling started.
+    std::unordered_map<std::string, Function> functions_; ///< The samples taken in each function by name.
+    std::unordered_map<std::string, int64_t> buildfiles_; ///< The number of samples taken while loading each buildfile.
+    std::unordered_map<std::string, int64_t> stacks_; ///< The number of samples taken with each folded stack.
+
+public:
+    Profiler();
+    bool enabled() const;
+    const std::string& filename() const;
+    int64_t samples() const;
+    std::vector<Function> functions() const;
+    std::vector<std::pair<std::string, int64_t>> buildfiles() const;
+    void start( const std::string& filename, int interval );
+    void install( lua_State* lua_state );
+    bool write() const;
+    void print( int count ) const;
+
+private:
+    void sample( lua_State* lua_state );
+    static void hook( lua_State* lua_state, lua_Debug* debug );
+};
+
+}
+
+}
+
+#endif
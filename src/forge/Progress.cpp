@@ -0,0 +1,214 @@
+//
+// Progress.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Progress.hpp"
+#include "System.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <stdio.h>
+
+using namespace sweet;
+using namespace sweet::forge;
+
+static const double INTERACTIVE_INTERVAL = 200.0; ///< The minimum milliseconds between redraws on a terminal.
+static const double PLAIN_INTERVAL = 10000.0; ///< The minimum milliseconds between plain lines.
+
+/**
+// Constructor.
+//
+// @param system
+//  The System that provides the current time (assumed not null).
+*/
+Progress::Progress( const System* system )
+: system_( system ),
+  enabled_( false ),
+  interactive_( false ),
+  total_( 0 ),
+  done_( 0 ),
+  expected_( 0 ),
+  expected_done_( 0 ),
+  average_( 0 ),
+  started_( 0.0 ),
+  printed_( 0.0 ),
+  width_( 0 )
+{
+    SWEET_ASSERT( system_ );
+}
+
+/**
+// Is progress reported?
+//
+// @return
+//  True if progress is reported otherwise false.
+*/
+bool Progress::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Enable or disable reporting progress.
+//
+// @param enabled
+//  True to report progress or false to stop reporting it.
+//
+// @param interactive
+//  True to redraw a single line in place as on a terminal or false to
+//  write periodic plain lines.
+*/
+void Progress::set_enabled( bool enabled, bool interactive )
+{
+    clear();
+    enabled_ = enabled;
+    interactive_ = interactive;
+}
+
+/**
+// Start reporting the progress of a traversal.
+//
+// @param total
+//  The number of outdated jobs in the traversal.
+//
+// @param known
+//  The number of outdated jobs whose Targets have a previous build.
+//
+// @param expected
+//  The total wall time in microseconds of the previous builds of the
+//  Targets of the \e known jobs.
+*/
+void Progress::start( int total, int known, int64_t expected )
+{
+    SWEET_ASSERT( total >= 0 );
+    SWEET_ASSERT( known >= 0 && known <= total );
+    total_ = total;
+    done_ = 0;
+    average_ = known > 0 ? expected / known : 0;
+    expected_ = expected + average_ * (total - known);
+    expected_done_ = 0;
+    started_ = system_->ticks();
+    printed_ = started_;
+}
+
+/**
+// Record an outdated job being done.
+//
+// @param expected
+//  The wall time in microseconds of the previous build of the job's Target
+//  or -1 if it hasn't been built before.
+*/
+void Progress::finish_job( int64_t expected )
+{
+    ++done_;
+    expected_done_ += expected >= 0 ? expected : average_;
+}
+
+/**
+// Print progress if it is enabled and hasn't been printed recently.
+//
+// @param active
+//  The number of jobs currently being processed.
+*/
+void Progress::update( int active )
+{
+    if ( enabled_ && total_ > 0 )
+    {
+        double now = system_->ticks();
+        if ( now - printed_ >= (interactive_ ? INTERACTIVE_INTERVAL : PLAIN_INTERVAL) )
+        {
+            printed_ = now;
+            print( active );
+        }
+    }
+}
+
+/**
+// Erase the progress line from the terminal so that other output can be
+// written in its place.
+//
+// The line is redrawn by the next call to Progress::update() that is due.
+*/
+void Progress::clear()
+{
+    if ( width_ > 0 )
+    {
+        printf( "\r%*s\r", width_, "" );
+        fflush( stdout );
+        width_ = 0;
+    }
+}
+
+/**
+// Finish reporting the progress of a traversal.
+*/
+void Progress::finish()
+{
+    clear();
+    total_ = 0;
+}
+
+/**
+// Estimate the time remaining in the current traversal.
+//
+// @return
+//  The estimated number of milliseconds remaining or a negative number if
+//  no outdated job has been done yet to base an estimate on.
+*/
+double Progress::remaining() const
+{
+    double elapsed = system_->ticks() - started_;
+    if ( expected_done_ > 0 )
+    {
+        return std::max( 0.0, elapsed * double(expected_ - expected_done_) / double(expected_done_) );
+    }
+    else if ( done_ > 0 )
+    {
+        return elapsed * double(total_ - done_) / double(done_);
+    }
+    return -1.0;
+}
+
+/**
+// Print the progress line.
+//
+// @param active
+//  The number of jobs currently being processed.
+*/
+void Progress::print( int active )
+{
+    char eta [32];
+    double remaining = Progress::remaining();
+    if ( remaining >= 0.0 )
+    {
+        int seconds = int(remaining / 1000.0 + 0.5);
+        if ( seconds >= 3600 )
+        {
+            snprintf( eta, sizeof(eta), "%dh%02dm", seconds / 3600, (seconds / 60) % 60 );
+        }
+        else
+        {
+            snprintf( eta, sizeof(eta), "%dm%02ds", seconds / 60, seconds % 60 );
+        }
+    }
+    else
+    {
+        snprintf( eta, sizeof(eta), "?" );
+    }
+
+    int percent = total_ > 0 ? int(100.0 * double(done_) / double(total_)) : 100;
+    if ( interactive_ )
+    {
+        int width = printf( "\rforge: [%d/%d] %d%% %d active, ETA %s", done_, total_, percent, active, eta ) - 1;
+        if ( width < width_ )
+        {
+            printf( "%*s", width_ - width, "" );
+        }
+        width_ = std::max( width, width_ );
+    }
+    else
+    {
+        printf( "forge: progress %d/%d (%d%%) %d active, ETA %s\n", done_, total_, percent, active, eta );
+    }
+    fflush( stdout );
+}
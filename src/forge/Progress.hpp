@@ -0,0 +1,66 @@
+#ifndef FORGE_PROGRESS_HPP_INCLUDED
+#define FORGE_PROGRESS_HPP_INCLUDED
+
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class System;
+
+/**
+// Report the progress of postorder traversals as the number of outdated
+// jobs done out of the total, the number of jobs active, and an estimate
+// of the time remaining.
+//
+// The estimate is derived from the wall time that each outdated Target's
+// commands took the last time that it was built, as stored in the
+// dependency graph, scaled by the ratio of the time elapsed so far to the
+// historical time of the jobs done so far.  Scaling accounts for parallel
+// execution and for differences between the previous build and this one.
+// Jobs for Targets without a previous build are assumed to take the
+// average time of those with one.  When no Target has a previous build the
+// estimate falls back to the average time elapsed per job done so far.
+//
+// On a terminal a single line is redrawn in place at most five times a
+// second and erased before any other output is written (see 
+// Progress::clear()).  Otherwise a plain line is written at most every ten
+// seconds so that logs stay readable.
+*/
+class Progress
+{
+    const System* system_; ///< The System that provides the current time.
+    bool enabled_; ///< True when progress is reported.
+    bool interactive_; ///< True when stdout is a terminal and the progress line is redrawn in place.
+    int total_; ///< The number of outdated jobs in the current traversal.
+    int done_; ///< The number of outdated jobs done in the current traversal.
+    int64_t expected_; ///< The historical wall time in microseconds of all outdated jobs in the current traversal.
+    int64_t expected_done_; ///< The historical wall time in microseconds of the outdated jobs done so far.
+    int64_t average_; ///< The historical wall time in microseconds assumed for jobs without a previous build.
+    double started_; ///< The time that the current traversal started.
+    double printed_; ///< The time that progress was last printed.
+    int width_; ///< The width of the progress line currently shown on the terminal or 0 if none is shown.
+
+public:
+    Progress( const System* system );
+    bool enabled() const;
+    void set_enabled( bool enabled, bool interactive );
+    void start( int total, int known, int64_t expected );
+    void finish_job( int64_t expected );
+    void update( int active );
+    void clear();
+    void finish();
+    double remaining() const;
+
+private:
+    void print( int active );
+};
+
+}
+
+}
+
+#endif
@@ -13,13 +13,21 @@
 #include "Reader.hpp"
 #include "Filter.hpp"
 #include "Arguments.hpp"
+#include "BytecodeCache.hpp"
+#include "Tracer.hpp"
+#include "Phases.hpp"
+#include "Profiler.hpp"
+#include "Progress.hpp"
 #include <process/Environment.hpp>
+#include <process/Usage.hpp>
+#include <forge/forge_lua/LuaSystem.hpp>
 #include <luaxx/luaxx.hpp>
 #include <error/ErrorPolicy.hpp>
 #include <list>
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <lua.hpp>
 
 using std::sort;
@@ -32,6 +40,8 @@ using namespace sweet::lua;
 using namespace sweet::luaxx;
 using namespace sweet::forge;
 
+static const int RESULTS_TIMEOUT = 200; ///< The maximum milliseconds to wait for results before reporting progress.
+
 Scheduler::Scheduler( Forge* forge )
 : forge_( forge ),
   active_contexts_(),
@@ -87,6 +97,8 @@ int Scheduler::buildfile( const boost::filesystem::path& path )
     Target* working_directory = buildfile->parent();
     SWEET_ASSERT( forge_->graph()->target(path.parent_path().generic_string()) == working_directory );
 
+    Tracer::Span span( forge_->tracer(), "buildfile", buildfile );
+    forge_->phases()->count( "buildfiles", 1 );
     Context* calling_context = active_contexts_.back();
     Context* context = allocate_context( working_directory );
     context->set_current_buildfile( buildfile );
@@ -120,8 +132,17 @@ void Scheduler::postorder_visit( int function, Job* job )
 {
     SWEET_ASSERT( job );
 
+    forge_->phases()->count( "jobs", 1 );
+    if ( !job->target()->outdated() )
+    {
+        forge_->phases()->count( "skipped", 1 );
+    }
+
     if ( job->target()->buildable() )
     {
+        Tracer::Span span( forge_->tracer(), "lua", job->target() );
+        Phases::Scope phase( forge_->phases(), "lua" );
+        job->begin_replay();
         Context* context = allocate_context( job->working_directory(), job );
         process_begin( context );
 
@@ -147,14 +168,26 @@ void Scheduler::postorder_visit( int function, Job* job )
     }    
 }
 
-void Scheduler::execute_finished( int exit_code, Context* context, process::Environment* environment )
+void Scheduler::execute_finished( int exit_code, const process::Usage& usage, Context* context, process::Environment* environment )
 {
     SWEET_ASSERT( context );
 
+    // Replayed commands finish with all zero usage and aren't counted 
+    // towards the resources used by their Job.
+    Job* job = context->job();
+    if ( job && usage.wall_time > 0 )
+    {
+        job->add_usage( usage );
+    }
+    forge_->phases()->count( "process_ms", usage.wall_time / 1000 );
+
+    Tracer::Span span( forge_->tracer(), "lua", job ? job->target() : context->working_directory() );
+    Phases::Scope phase( forge_->phases(), "lua" );
     process_begin( context );
     lua_State* lua_state = context->lua_state();
     lua_pushinteger( lua_state, exit_code );
-    resume( lua_state, 1 );
+    LuaSystem::push_usage( lua_state, usage );
+    resume( lua_state, 2 );
     process_end( context );
 
     // The environment is deleted here for symmetry with its construction in 
@@ -190,6 +223,9 @@ void Scheduler::output( const std::string& output, Filter* filter, Arguments* ar
     SWEET_ASSERT( forge_ );
     if ( filter )
     {
+        Tracer::Span span( forge_->tracer(), "filter", "filter", working_directory );
+        Phases::Scope phase( forge_->phases(), "filter" );
+        forge_->phases()->count( "filter_lines", 1 );
         Context* context = allocate_context( working_directory );
         process_begin( context );
         lua_State* lua_state = context->lua_state();
@@ -235,11 +271,11 @@ void Scheduler::push_errorf( const char* format, ... )
     results_condition_.notify_all();
 }
 
-void Scheduler::push_execute_finished( int exit_code, Context* context, process::Environment* environment )
+void Scheduler::push_execute_finished( int exit_code, const process::Usage& usage, Context* context, process::Environment* environment )
 {
     std::unique_lock<std::mutex> lock( results_mutex_ );
     --execute_jobs_;
-    results_.push_back( std::bind(&Scheduler::execute_finished, this, exit_code, context, environment) );
+    results_.push_back( std::bind(&Scheduler::execute_finished, this, exit_code, usage, context, environment) );
     results_condition_.notify_all();
 }
 
@@ -251,9 +287,29 @@ void Scheduler::push_read_finished( Filter* filter, Arguments* arguments )
     results_condition_.notify_all();
 }
 
-void Scheduler::execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
+void Scheduler::execute( const std::string& command, const std::string& command_line, uint64_t fingerprint, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context )
 {
     SWEET_ASSERT( !command.empty() );
+    SWEET_ASSERT( context );
+
+    // Replay commands that are identical to the command that the Target 
+    // being built executed last time by finishing them straight away with
+    // a successful exit code rather than executing them again.
+    Job* job = context->job();
+    if ( job && job->replay(fingerprint) )
+    {
+        forge_->phases()->count( "replayed", 1 );
+        delete dependencies_filter;
+        delete stdout_filter;
+        delete stderr_filter;
+        delete arguments;
+        process::Usage usage = { 0, 0, 0, 0, 0, 0 };
+        std::unique_lock<std::mutex> lock( results_mutex_ );
+        results_.push_back( std::bind(&Scheduler::execute_finished, this, 0, usage, context, environment) );
+        return;
+    }
+
+    forge_->phases()->count( "executed", 1 );
     std::unique_lock<std::mutex> lock( results_mutex_ );
     forge_->executor()->execute( command, command_line, environment, dependencies_filter, stdout_filter, stderr_filter, arguments, context );
     ++execute_jobs_;
@@ -300,11 +356,13 @@ int Scheduler::postorder( Target* target, int function )
         Forge* forge_;
         list<Job> jobs_;
         int failures_;
+        int processing_;
         
         Postorder( Forge* forge )
         : forge_( forge ),
           jobs_(),
-          failures_( 0 )
+          failures_( 0 ),
+          processing_( 0 )
         {
             SWEET_ASSERT( forge_ );
             forge_->graph()->begin_traversal();
@@ -312,25 +370,58 @@ int Scheduler::postorder( Target* target, int function )
         
         ~Postorder()
         {
+            forge_->progress()->finish();
             forge_->graph()->end_traversal();
         }
+
+        void start_progress()
+        {
+            int total = 0;
+            int known = 0;
+            int64_t expected = 0;
+            for ( list<Job>::const_iterator job = jobs_.begin(); job != jobs_.end(); ++job )
+            {
+                if ( job->target()->outdated() )
+                {
+                    ++total;
+                    if ( job->expected_time() >= 0 )
+                    {
+                        ++known;
+                        expected += job->expected_time();
+                    }
+                }
+            }
+            forge_->progress()->start( total, known, expected );
+        }
     
         void remove_complete_jobs()
         {
+            Progress* progress = forge_->progress();
+            processing_ = 0;
             list<Job>::iterator job = jobs_.begin();
             while ( job != jobs_.end() )
             {
                 if ( job->state() == JOB_COMPLETE )
                 {
+                    if ( job->target()->outdated() )
+                    {
+                        progress->finish_job( job->expected_time() );
+                    }
                     job = jobs_.erase( job );
                 }
                 else
                 {
+                    processing_ += job->state() == JOB_PROCESSING ? 1 : 0;
                     ++job;
                 }
             }
         }
 
+        int processing() const
+        {
+            return processing_;
+        }
+
         Job* pull_job()
         {
             int height = INT_MAX;
@@ -411,11 +502,14 @@ int Scheduler::postorder( Target* target, int function )
         return 0;
     }
     
+    Tracer::Span span( forge_->tracer(), "postorder", target ? target : graph->root_target() );
+    Phases::Scope phase( forge_->phases(), "postorder" );
     Postorder postorder( forge_ );
     postorder.visit( target ? target : graph->root_target() );
     failures_ = postorder.failures();
     if ( failures_ == 0 )
     {
+        postorder.start_progress();
         postorder.remove_complete_jobs();
         while ( !postorder.empty() )
         {
@@ -428,6 +522,7 @@ int Scheduler::postorder( Target* target, int function )
                 job = postorder.pull_job();
             }
             dispatch_results();
+            forge_->progress()->update( postorder.processing() );
         }
         wait();
     }
@@ -446,6 +541,7 @@ Context* Scheduler::allocate_context( Target* working_directory, Job* job )
     Context* context = new Context( forge_ );
     context->reset_directory_to_target( working_directory );
     context->set_job( job );
+    forge_->profiler()->install( context->lua_state() );
     return context;
 }
 
@@ -457,6 +553,18 @@ void Scheduler::free_context( Context* context )
     if ( job )
     {
         job->set_state( JOB_COMPLETE );
+        Target* target = job->target();
+        if ( target->outdated() )
+        {
+            target->set_fingerprint( job->fingerprint() );
+            target->set_replayed( job->replayed() );
+        }
+        if ( job->processes() > 0 )
+        {
+            target->set_usage( job->usage() );
+        }
+        target->share_implicit_dependencies();
+        forge_->graph()->append_to_journal( target );
     }
 
     delete context;
@@ -470,7 +578,12 @@ void Scheduler::destroy_context( Context* context )
     if ( job )
     {
         job->set_state( JOB_COMPLETE );
-        job->target()->set_successful( false );
+        Target* target = job->target();
+        target->set_fingerprint( 0 );
+        target->set_replayed( false );
+        target->share_implicit_dependencies();
+        forge_->graph()->append_to_journal( target );
+        target->set_successful( false );
     }
 
     delete context;
@@ -481,9 +594,11 @@ bool Scheduler::dispatch_results()
     std::unique_lock<std::mutex> lock( results_mutex_ );
     if ( results_.empty() )
     {
+        // Wait with a timeout so that progress is still reported while 
+        // long running commands execute.
         if ( execute_jobs_ > 0 || read_jobs_ > 0 )
         {
-            results_condition_.wait( lock );            
+            results_condition_.wait_for( lock, std::chrono::milliseconds(RESULTS_TIMEOUT) );
         }
     }
 
@@ -539,7 +654,7 @@ void Scheduler::dofile( lua_State* lua_state, const char* filename )
 {
     SWEET_ASSERT( lua_state );
     SWEET_ASSERT( filename );
-    int result = luaL_loadfile( lua_state, filename );
+    int result = forge_->bytecode_cache()->load( lua_state, filename );
     switch ( result )
     {
         case LUA_OK:
@@ -17,6 +17,7 @@ namespace process
 {
 
 class Environment;
+struct Usage;
 
 }
 
@@ -57,7 +58,7 @@ class Scheduler
         int buildfile( const boost::filesystem::path& path );
         void call( const boost::filesystem::path& path, const std::string& function );
         void postorder_visit( int function, Job* job );
-        void execute_finished( int exit_code, Context* context, process::Environment* environment );
+        void execute_finished( int exit_code, const process::Usage& usage, Context* context, process::Environment* environment );
         void read_finished( Filter* filter, Arguments* arguments );
         void buildfile_finished( Context* context, bool success );
         void output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory );
@@ -65,10 +66,10 @@ class Scheduler
 
         void push_output( const std::string& output, Filter* filter, Arguments* arguments, Target* working_directory );
         void push_errorf( const char* format, ... );
-        void push_execute_finished( int exit_code, Context* context, process::Environment* environment );
+        void push_execute_finished( int exit_code, const process::Usage& usage, Context* context, process::Environment* environment );
         void push_read_finished( Filter* filter, Arguments* arguments );
 
-        void execute( const std::string& command, const std::string& command_line, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
+        void execute( const std::string& command, const std::string& command_line, uint64_t fingerprint, process::Environment* environment, Filter* dependencies_filter, Filter* stdout_filter, Filter* stderr_filter, Arguments* arguments, Context* context );
         void read( intptr_t fd_or_handle, Filter* filter, Arguments* arguments, Target* working_directory );
         void wait();
         
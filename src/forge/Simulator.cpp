@@ -0,0 +1,426 @@
+//
+// Simulator.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Simulator.hpp"
+#include "Target.hpp"
+#include <process/Usage.hpp>
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <limits.h>
+#include <stdio.h>
+
+using std::vector;
+using std::priority_queue;
+using std::unordered_map;
+using std::unordered_set;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// Constructor.
+*/
+Simulator::Simulator()
+: nodes_(),
+  work_( 0 ),
+  critical_path_( 0 ),
+  jobs_( 0 )
+{
+}
+
+/**
+// Load the Targets reachable from \e target and their recorded durations.
+//
+// Targets are visited through all of their dependencies in the same order
+// that Scheduler::postorder() visits them.  Dependencies that would form a
+// cycle are ignored.
+//
+// @param target
+//  The goal to simulate building (assumed not null).
+*/
+void Simulator::load( Target* target )
+{
+    struct Loader
+    {
+        vector<Node>* nodes_;
+        unordered_map<Target*, int> indices_;
+        unordered_set<Target*> visiting_;
+
+        Loader( vector<Node>* nodes )
+        : nodes_( nodes ),
+          indices_(),
+          visiting_()
+        {
+        }
+
+        int visit( Target* target )
+        {
+            SWEET_ASSERT( target );
+            unordered_map<Target*, int>::const_iterator found = indices_.find( target );
+            if ( found != indices_.end() )
+            {
+                return found->second;
+            }
+
+            visiting_.insert( target );
+            vector<int> dependencies;
+            int height = 0;
+            int i = 0;
+            Target* dependency = target->any_dependency( i );
+            while ( dependency )
+            {
+                if ( visiting_.find(dependency) == visiting_.end() )
+                {
+                    int index = visit( dependency );
+                    dependencies.push_back( index );
+                    height = std::max( height, (*nodes_)[index].height + 1 );
+                }
+                ++i;
+                dependency = target->any_dependency( i );
+            }
+            visiting_.erase( target );
+
+            std::sort( dependencies.begin(), dependencies.end() );
+            dependencies.erase( std::unique(dependencies.begin(), dependencies.end()), dependencies.end() );
+
+            bool job = target->referenced_by_script() && target->working_directory();
+            const process::Usage* usage = target->usage();
+            int index = int(nodes_->size());
+            Node node;
+            node.target = target;
+            node.duration = job && usage ? usage->wall_time : 0;
+            node.height = job ? height : -1;
+            node.dependencies = int(dependencies.size());
+            node.critical_path = 0;
+            nodes_->push_back( node );
+            for ( vector<int>::const_iterator i = dependencies.begin(); i != dependencies.end(); ++i )
+            {
+                (*nodes_)[*i].dependents.push_back( index );
+            }
+            indices_.insert( std::make_pair(target, index) );
+            return index;
+        }
+    };
+
+    SWEET_ASSERT( target );
+    nodes_.clear();
+    Loader loader( &nodes_ );
+    loader.visit( target );
+
+    // Dependents always follow their dependencies in postorder so critical
+    // paths are calculated in one pass in reverse.
+    work_ = 0;
+    critical_path_ = 0;
+    jobs_ = 0;
+    for ( vector<Node>::reverse_iterator i = nodes_.rbegin(); i != nodes_.rend(); ++i )
+    {
+        Node& node = *i;
+        int64_t longest_dependent = 0;
+        for ( vector<int>::const_iterator j = node.dependents.begin(); j != node.dependents.end(); ++j )
+        {
+            longest_dependent = std::max( longest_dependent, nodes_[*j].critical_path );
+        }
+        node.critical_path = node.duration + longest_dependent;
+        critical_path_ = std::max( critical_path_, node.critical_path );
+        work_ += node.duration;
+        jobs_ += node.height >= 0 ? 1 : 0;
+    }
+}
+
+/**
+// Get the number of Targets that are visited as jobs.
+*/
+int Simulator::jobs() const
+{
+    return jobs_;
+}
+
+/**
+// Get the total recorded wall time of all jobs in microseconds.
+*/
+int64_t Simulator::work() const
+{
+    return work_;
+}
+
+/**
+// Get the longest path of recorded time through the graph in microseconds.
+//
+// No policy can finish sooner than this however many processors it has.
+*/
+int64_t Simulator::critical_path() const
+{
+    return critical_path_;
+}
+
+/**
+// Simulate building the loaded graph.
+//
+// @param policy
+//  The policy to choose the next job to run with.
+//
+// @param processors
+//  The number of jobs that can run at the same time.
+//
+// @return
+//  The simulated time taken to build the graph in microseconds.
+*/
+int64_t Simulator::simulate( SchedulingPolicy policy, int processors ) const
+{
+    SWEET_ASSERT( processors > 0 );
+
+    // A job that is ready to run.  Jobs with higher priority are run first
+    // and jobs with the same priority run in the order that they became
+    // ready.
+    struct Ready
+    {
+        int64_t priority;
+        int64_t sequence;
+        int node;
+
+        bool operator<( const Ready& ready ) const
+        {
+            return priority != ready.priority ? priority < ready.priority : sequence > ready.sequence;
+        }
+    };
+
+    // A job that is running and the time that it finishes.
+    struct Running
+    {
+        int64_t finish;
+        int node;
+
+        bool operator>( const Running& running ) const
+        {
+            return finish > running.finish;
+        }
+    };
+
+    struct Simulation
+    {
+        const vector<Node>& nodes_;
+        SchedulingPolicy policy_;
+        vector<int> dependencies_;
+        vector<bool> pulled_;
+        vector<bool> done_;
+        vector<int> finished_;
+        vector<int> waves_;
+        size_t first_wave_;
+        priority_queue<Ready> ready_;
+        int64_t sequence_;
+
+        Simulation( const vector<Node>& nodes, SchedulingPolicy policy )
+        : nodes_( nodes ),
+          policy_( policy ),
+          dependencies_(),
+          pulled_( nodes.size(), false ),
+          done_( nodes.size(), false ),
+          finished_(),
+          waves_(),
+          first_wave_( 0 ),
+          ready_(),
+          sequence_( 0 )
+        {
+            for ( size_t i = 0; i < nodes_.size(); ++i )
+            {
+                dependencies_.push_back( nodes_[i].dependencies );
+                if ( nodes_[i].height >= 0 )
+                {
+                    waves_.push_back( int(i) );
+                }
+            }
+        }
+
+        void release( int node )
+        {
+            if ( nodes_[node].duration > 0 )
+            {
+                int64_t priority = 0;
+                if ( policy_ == SCHEDULE_CRITICAL_PATH )
+                {
+                    priority = nodes_[node].critical_path;
+                }
+                else if ( policy_ == SCHEDULE_FAN_OUT )
+                {
+                    priority = int64_t(nodes_[node].dependents.size());
+                }
+                Ready ready = { priority, sequence_++, node };
+                ready_.push( ready );
+            }
+            else
+            {
+                finished_.push_back( node );
+            }
+        }
+
+        // Mark finished jobs done releasing dependents whose dependencies
+        // are all done.  Jobs that take no time finish straight away.
+        void finish()
+        {
+            while ( !finished_.empty() )
+            {
+                int node = finished_.back();
+                finished_.pop_back();
+                done_[node] = true;
+                if ( policy_ != SCHEDULE_WAVES )
+                {
+                    const vector<int>& dependents = nodes_[node].dependents;
+                    for ( vector<int>::const_iterator i = dependents.begin(); i != dependents.end(); ++i )
+                    {
+                        if ( --dependencies_[*i] == 0 )
+                        {
+                            release( *i );
+                        }
+                    }
+                }
+            }
+        }
+
+        // Pull every job that Scheduler::postorder() would pull; a waiting
+        // job is pulled when no earlier job that is still outstanding has a
+        // lower height.  Pulling a job that takes no time finishes it
+        // straight away and so doesn't hold back the jobs after it.
+        void pull()
+        {
+            while ( first_wave_ < waves_.size() && done_[waves_[first_wave_]] )
+            {
+                ++first_wave_;
+            }
+
+            int height = INT_MAX;
+            for ( size_t i = first_wave_; i < waves_.size(); ++i )
+            {
+                int node = waves_[i];
+                if ( !done_[node] )
+                {
+                    int node_height = nodes_[node].height;
+                    if ( !pulled_[node] && node_height <= height )
+                    {
+                        pulled_[node] = true;
+                        release( node );
+                        if ( nodes_[node].duration <= 0 )
+                        {
+                            continue;
+                        }
+                    }
+                    height = std::min( height, node_height );
+                }
+            }
+        }
+    };
+
+    Simulation simulation( nodes_, policy );
+    if ( policy == SCHEDULE_WAVES )
+    {
+        simulation.pull();
+        simulation.finish();
+    }
+    else
+    {
+        for ( size_t i = 0; i < nodes_.size(); ++i )
+        {
+            if ( nodes_[i].dependencies == 0 )
+            {
+                simulation.release( int(i) );
+            }
+        }
+        simulation.finish();
+    }
+
+    int64_t time = 0;
+    priority_queue<Running, vector<Running>, std::greater<Running>> running;
+    while ( true )
+    {
+        while ( int(running.size()) < processors && !simulation.ready_.empty() )
+        {
+            const Ready& ready = simulation.ready_.top();
+            Running job = { time + nodes_[ready.node].duration, ready.node };
+            running.push( job );
+            simulation.ready_.pop();
+        }
+
+        if ( running.empty() )
+        {
+            break;
+        }
+
+        time = running.top().finish;
+        while ( !running.empty() && running.top().finish == time )
+        {
+            simulation.finished_.push_back( running.top().node );
+            running.pop();
+        }
+        simulation.finish();
+        if ( policy == SCHEDULE_WAVES )
+        {
+            simulation.pull();
+            simulation.finish();
+        }
+    }
+    return time;
+}
+
+/**
+// Print the simulated time, utilisation, and speedup of each policy at
+// each level of parallelism.
+//
+// Utilisation is the share of the available processor time spent running
+// jobs.  The bound is the shortest time that any policy could take; the
+// longer of the critical path and the work divided evenly between the
+// processors.
+//
+// @param processors
+//  The numbers of processors to simulate.
+*/
+void Simulator::print( const std::vector<int>& processors ) const
+{
+    printf( "%d jobs with %.1fs of recorded work and a %.1fs critical path\n", jobs_, double(work_) / 1000000.0, double(critical_path_) / 1000000.0 );
+    printf( "%-14s %5s %12s %12s %8s\n", "Policy", "-j", "Makespan", "Utilisation", "Speedup" );
+    for ( vector<int>::const_iterator i = processors.begin(); i != processors.end(); ++i )
+    {
+        int count = std::max( *i, 1 );
+        for ( int policy = 0; policy <= SCHEDULE_POLICY_COUNT; ++policy )
+        {
+            int64_t makespan = 0;
+            const char* name = "bound";
+            if ( policy < SCHEDULE_POLICY_COUNT )
+            {
+                makespan = simulate( SchedulingPolicy(policy), count );
+                name = policy_name( SchedulingPolicy(policy) );
+            }
+            else
+            {
+                makespan = std::max( critical_path_, (work_ + count - 1) / count );
+            }
+            double utilisation = makespan > 0 ? 100.0 * double(work_) / (double(makespan) * double(count)) : 0.0;
+            double speedup = makespan > 0 ? double(work_) / double(makespan) : 0.0;
+            printf( "%-14s %5d %11.1fs %11.1f%% %7.2fx\n", name, count, double(makespan) / 1000000.0, utilisation, speedup );
+        }
+    }
+}
+
+/**
+// Get the name of a scheduling policy.
+*/
+const char* Simulator::policy_name( SchedulingPolicy policy )
+{
+    switch ( policy )
+    {
+        case SCHEDULE_WAVES:
+            return "waves";
+        case SCHEDULE_DEPENDENCIES:
+            return "dependencies";
+        case SCHEDULE_CRITICAL_PATH:
+            return "critical_path";
+        case SCHEDULE_FAN_OUT:
+            return "fan_out";
+        default:
+            SWEET_ASSERT( false );
+            return "";
+    }
+}
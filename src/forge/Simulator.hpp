@@ -0,0 +1,78 @@
+#ifndef FORGE_SIMULATOR_HPP_INCLUDED
+#define FORGE_SIMULATOR_HPP_INCLUDED
+
+#include <vector>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Target;
+
+/**
+// The policies that the Simulator can schedule jobs with.
+*/
+enum SchedulingPolicy
+{
+    SCHEDULE_WAVES, ///< Pull jobs as Scheduler::postorder() does and run their commands first in first out.
+    SCHEDULE_DEPENDENCIES, ///< Run jobs first in first out as soon as all of their dependencies are done.
+    SCHEDULE_CRITICAL_PATH, ///< Run the ready job with the longest path of recorded time to the goal first.
+    SCHEDULE_FAN_OUT, ///< Run the ready job with the most dependents first.
+    SCHEDULE_POLICY_COUNT ///< The number of scheduling policies.
+};
+
+/**
+// Replay a previous build of a dependency graph under different scheduling
+// policies and levels of parallelism without executing any commands.
+//
+// Each job takes the wall time recorded for its Target's commands the last
+// time that it was built and occupies one of the simulated processors while
+// it runs.  Jobs for Targets without recorded commands, and Targets that
+// aren't visited as jobs, finish as soon as they're able to start.  The
+// time spent in Lua visits and scanning dependencies isn't simulated.
+//
+// The waves policy models the current scheduler in which a job can only be
+// pulled once no earlier job in postorder with a lower height is still
+// outstanding and pulled jobs queue their commands for the Executor in the
+// order that they were pulled.  The other policies release jobs as soon as
+// all of their dependencies have finished.
+*/
+class Simulator
+{
+    /**
+    // A Target in the simulated graph.
+    */
+    struct Node
+    {
+        Target* target; ///< The Target.
+        int64_t duration; ///< The recorded wall time of the Target's commands in microseconds.
+        int height; ///< The height of the Target's job as calculated by Scheduler::postorder() or -1 if it isn't a job.
+        int dependencies; ///< The number of distinct Targets that the Target depends on.
+        int64_t critical_path; ///< The longest path of recorded time from the Target to the goal in microseconds.
+        std::vector<int> dependents; ///< The indices of the Targets that depend on the Target.
+    };
+
+    std::vector<Node> nodes_; ///< The Targets reachable from the goal in postorder.
+    int64_t work_; ///< The total recorded wall time of all jobs in microseconds.
+    int64_t critical_path_; ///< The longest path of recorded time through the graph in microseconds.
+    int jobs_; ///< The number of Targets visited as jobs.
+
+public:
+    Simulator();
+    void load( Target* target );
+    int jobs() const;
+    int64_t work() const;
+    int64_t critical_path() const;
+    int64_t simulate( SchedulingPolicy policy, int processors ) const;
+    void print( const std::vector<int>& processors ) const;
+    static const char* policy_name( SchedulingPolicy policy );
+};
+
+}
+
+}
+
+#endif
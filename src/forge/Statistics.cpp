@@ -0,0 +1,314 @@
+//
+// Statistics.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Statistics.hpp"
+#include "Forge.hpp"
+#include "Graph.hpp"
+#include "Target.hpp"
+#include "System.hpp"
+#include <assert/assert.hpp>
+#include <unordered_set>
+#include <inttypes.h>
+#include <stdio.h>
+#include <lua.hpp>
+
+using std::string;
+using std::vector;
+using std::unordered_set;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// Constructor.
+*/
+Statistics::Statistics()
+: targets( 0 ),
+  explicit_edges( 0 ),
+  implicit_edges( 0 ),
+  ordering_edges( 0 ),
+  filenames( 0 ),
+  target_bytes( 0 ),
+  string_bytes( 0 ),
+  lua_bytes( 0 ),
+  exists_calls( 0 ),
+  last_write_time_calls( 0 ),
+  jobs( 0 ),
+  skipped( 0 ),
+  executed( 0 ),
+  replayed( 0 ),
+  filter_lines( 0 ),
+  load_bytes( 0 ),
+  save_bytes( 0 ),
+  bind(),
+  postorder(),
+  load(),
+  save(),
+  elapsed( 0.0 ),
+  phases(),
+  counters()
+{
+    Timing none = { 0.0, 0 };
+    bind = none;
+    postorder = none;
+    load = none;
+    save = none;
+}
+
+/**
+// Collect statistics from a Forge.
+//
+// @param forge
+//  The Forge to collect statistics from (assumed not null).
+*/
+void Statistics::collect( Forge* forge )
+{
+    struct Collector
+    {
+        Statistics* statistics_;
+        unordered_set<const vector<Target*>*> implicit_dependencies_;
+
+        Collector( Statistics* statistics )
+        : statistics_( statistics ),
+          implicit_dependencies_()
+        {
+        }
+
+        // Estimate the heap memory used by a string assuming that strings
+        // with capacity smaller than the string object itself are stored
+        // in place.
+        static int64_t string_bytes( const string& value )
+        {
+            return value.capacity() >= sizeof(string) ? int64_t(value.capacity() + 1) : 0;
+        }
+
+        void collect( const Target* target )
+        {
+            SWEET_ASSERT( target );
+            Statistics* statistics = statistics_;
+            ++statistics->targets;
+            statistics->target_bytes += sizeof(Target);
+            statistics->string_bytes += string_bytes( target->id() );
+
+            int explicit_edges = 0;
+            while ( target->explicit_dependency(explicit_edges) )
+            {
+                ++explicit_edges;
+            }
+            int ordering_edges = 0;
+            while ( target->ordering_dependency(ordering_edges) )
+            {
+                ++ordering_edges;
+            }
+            statistics->explicit_edges += explicit_edges;
+            statistics->ordering_edges += ordering_edges;
+            statistics->target_bytes += (explicit_edges + ordering_edges) * sizeof(Target*);
+
+            // Implicit dependencies may be shared between Targets so their
+            // memory is only counted the first time that they're seen.
+            const vector<Target*>& implicit_dependencies = target->implicit_dependencies();
+            statistics->implicit_edges += implicit_dependencies.size();
+            if ( implicit_dependencies_.insert(&implicit_dependencies).second )
+            {
+                statistics->target_bytes += implicit_dependencies.capacity() * sizeof(Target*);
+            }
+
+            const vector<string>& filenames = target->filenames();
+            statistics->filenames += filenames.size();
+            statistics->target_bytes += filenames.capacity() * sizeof(string);
+            for ( vector<string>::const_iterator i = filenames.begin(); i != filenames.end(); ++i )
+            {
+                statistics->string_bytes += string_bytes( *i );
+            }
+
+            const vector<Target*>& targets = target->targets();
+            statistics->target_bytes += targets.capacity() * sizeof(Target*);
+            for ( vector<Target*>::const_iterator i = targets.begin(); i != targets.end(); ++i )
+            {
+                collect( *i );
+            }
+        }
+    };
+
+    SWEET_ASSERT( forge );
+    *this = Statistics();
+
+    Collector collector( this );
+    collector.collect( forge->graph()->root_target() );
+
+    lua_State* lua_state = forge->lua_state();
+    lua_bytes = int64_t(lua_gc(lua_state, LUA_GCCOUNT, 0)) * 1024 + lua_gc( lua_state, LUA_GCCOUNTB, 0 );
+
+    const System* system = forge->system();
+    exists_calls = system->exists_calls();
+    last_write_time_calls = system->last_write_time_calls();
+    elapsed = system->ticks();
+
+    phases = forge->phases()->phases();
+    counters = forge->phases()->counters();
+    for ( vector<Phases::Phase>::const_iterator i = phases.begin(); i != phases.end(); ++i )
+    {
+        Timing timing = { i->milliseconds, i->count };
+        if ( i->name == "bind" )
+        {
+            bind = timing;
+        }
+        else if ( i->name == "postorder" )
+        {
+            postorder = timing;
+        }
+        else if ( i->name == "load_binary" )
+        {
+            load = timing;
+        }
+        else if ( i->name == "save_binary" )
+        {
+            save = timing;
+        }
+    }
+    for ( vector<Phases::Counter>::const_iterator i = counters.begin(); i != counters.end(); ++i )
+    {
+        if ( i->name == "jobs" )
+        {
+            jobs = i->total;
+        }
+        else if ( i->name == "skipped" )
+        {
+            skipped = i->total;
+        }
+        else if ( i->name == "executed" )
+        {
+            executed = i->total;
+        }
+        else if ( i->name == "replayed" )
+        {
+            replayed = i->total;
+        }
+        else if ( i->name == "filter_lines" )
+        {
+            filter_lines = i->total;
+        }
+        else if ( i->name == "load_bytes" )
+        {
+            load_bytes = i->total;
+        }
+        else if ( i->name == "save_bytes" )
+        {
+            save_bytes = i->total;
+        }
+    }
+}
+
+/**
+// Print a summary of these statistics.
+*/
+void Statistics::print() const
+{
+    printf( "forge: stats graph    targets=%" PRId64 " edges=%" PRId64 " (explicit=%" PRId64 " implicit=%" PRId64 " ordering=%" PRId64 ") filenames=%" PRId64 "\n",
+        targets, explicit_edges + implicit_edges + ordering_edges, explicit_edges, implicit_edges, ordering_edges, filenames
+    );
+    printf( "forge: stats memory   targets=%" PRId64 "KB strings=%" PRId64 "KB lua=%" PRId64 "KB\n",
+        (target_bytes + 1023) / 1024, (string_bytes + 1023) / 1024, (lua_bytes + 1023) / 1024
+    );
+    printf( "forge: stats system   exists=%" PRId64 " last_write_time=%" PRId64 "\n",
+        exists_calls, last_write_time_calls
+    );
+    printf( "forge: stats time     bind=%.1fms (%d) postorder=%.1fms (%d) elapsed=%.1fms\n",
+        bind.milliseconds, bind.count, postorder.milliseconds, postorder.count, elapsed
+    );
+    printf( "forge: stats jobs     visited=%" PRId64 " skipped=%" PRId64 " executed=%" PRId64 " replayed=%" PRId64 " filter_lines=%" PRId64 "\n",
+        jobs, skipped, executed, replayed, filter_lines
+    );
+    printf( "forge: stats file     load=%" PRId64 "KB %.1fms save=%" PRId64 "KB %.1fms\n",
+        (load_bytes + 1023) / 1024, load.milliseconds, (save_bytes + 1023) / 1024, save.milliseconds
+    );
+}
+
+/**
+// Write these statistics to a file as a JSON object.
+//
+// Values are written in bytes and milliseconds.  Every phase and counter is
+// also written under "phases" and "counters" keyed by name.
+//
+// @param filename
+//  The name of the file to write to.
+//
+// @return
+//  True if the statistics were written successfully otherwise false.
+*/
+bool Statistics::write( const std::string& filename ) const
+{
+    struct Json
+    {
+        static void write_string( FILE* file, const std::string& value )
+        {
+            fputc( '"', file );
+            for ( string::const_iterator i = value.begin(); i != value.end(); ++i )
+            {
+                unsigned char character = static_cast<unsigned char>( *i );
+                if ( character == '"' || character == '\\' )
+                {
+                    fputc( '\\', file );
+                    fputc( character, file );
+                }
+                else if ( character < 0x20 )
+                {
+                    fprintf( file, "\\u%04x", character );
+                }
+                else
+                {
+                    fputc( character, file );
+                }
+            }
+            fputc( '"', file );
+        }
+    };
+
+    FILE* file = fopen( filename.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+
+    fprintf( file, "{\n" );
+    fprintf( file, "  \"graph\": {\"targets\": %" PRId64 ", \"explicit_edges\": %" PRId64 ", \"implicit_edges\": %" PRId64 ", \"ordering_edges\": %" PRId64 ", \"filenames\": %" PRId64 "},\n",
+        targets, explicit_edges, implicit_edges, ordering_edges, filenames
+    );
+    fprintf( file, "  \"memory\": {\"target_bytes\": %" PRId64 ", \"string_bytes\": %" PRId64 ", \"lua_bytes\": %" PRId64 "},\n",
+        target_bytes, string_bytes, lua_bytes
+    );
+    fprintf( file, "  \"system\": {\"exists_calls\": %" PRId64 ", \"last_write_time_calls\": %" PRId64 "},\n",
+        exists_calls, last_write_time_calls
+    );
+    fprintf( file, "  \"jobs\": {\"visited\": %" PRId64 ", \"skipped\": %" PRId64 ", \"executed\": %" PRId64 ", \"replayed\": %" PRId64 ", \"filter_lines\": %" PRId64 "},\n",
+        jobs, skipped, executed, replayed, filter_lines
+    );
+    fprintf( file, "  \"graph_file\": {\"load_bytes\": %" PRId64 ", \"load_milliseconds\": %.3f, \"save_bytes\": %" PRId64 ", \"save_milliseconds\": %.3f},\n",
+        load_bytes, load.milliseconds, save_bytes, save.milliseconds
+    );
+    fprintf( file, "  \"elapsed_milliseconds\": %.3f,\n", elapsed );
+
+    fprintf( file, "  \"phases\": {" );
+    for ( vector<Phases::Phase>::const_iterator i = phases.begin(); i != phases.end(); ++i )
+    {
+        fprintf( file, i != phases.begin() ? ",\n    " : "\n    " );
+        Json::write_string( file, i->name );
+        fprintf( file, ": {\"milliseconds\": %.3f, \"count\": %d}", i->milliseconds, i->count );
+    }
+    fprintf( file, "\n  },\n" );
+
+    fprintf( file, "  \"counters\": {" );
+    for ( vector<Phases::Counter>::const_iterator i = counters.begin(); i != counters.end(); ++i )
+    {
+        fprintf( file, i != counters.begin() ? ",\n    " : "\n    " );
+        Json::write_string( file, i->name );
+        fprintf( file, ": %" PRId64, i->total );
+    }
+    fprintf( file, "\n  }\n" );
+    fprintf( file, "}\n" );
+
+    bool successful = ferror( file ) == 0;
+    successful = fclose( file ) == 0 && successful;
+    return successful;
+}
@@ -0,0 +1,77 @@
+#ifndef FORGE_STATISTICS_HPP_INCLUDED
+#define FORGE_STATISTICS_HPP_INCLUDED
+
+#include "Phases.hpp"
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Forge;
+
+/**
+// A snapshot of the size of the dependency graph, the memory that it and
+// the Lua virtual machine use, and the work done by the build so far.
+//
+// Statistics are collected from the Graph, the System, the Lua virtual
+// machine, and the phases and counters recorded in Phases when `collect()`
+// is called.  Every phase and counter is kept so that those added by build
+// scripts are written out too.  Statistics can then be printed as a summary
+// and written out as JSON so that regressions can be tracked from build to
+// build.
+//
+// Memory used by Targets is an estimate from the sizes of Targets and their
+// vectors and strings.  Heap allocator overhead isn't included.
+*/
+struct Statistics
+{
+    /**
+    // The time spent in a phase and the number of times it completed.
+    */
+    struct Timing
+    {
+        double milliseconds; ///< The total time spent in the phase.
+        int count; ///< The number of times that the phase completed.
+    };
+
+    int64_t targets; ///< The number of Targets in the Graph.
+    int64_t explicit_edges; ///< The number of explicit dependencies between Targets.
+    int64_t implicit_edges; ///< The number of implicit dependencies between Targets.
+    int64_t ordering_edges; ///< The number of ordering dependencies between Targets.
+    int64_t filenames; ///< The number of filenames that Targets are bound to.
+    int64_t target_bytes; ///< The estimated memory used by Targets and their dependency lists.
+    int64_t string_bytes; ///< The estimated memory used by the identifiers and filenames of Targets.
+    int64_t lua_bytes; ///< The memory used by the Lua virtual machine.
+    int64_t exists_calls; ///< The number of file system existence checks.
+    int64_t last_write_time_calls; ///< The number of file system last write time checks.
+    int64_t jobs; ///< The number of Targets visited in postorder traversals.
+    int64_t skipped; ///< The number of Targets visited that weren't outdated.
+    int64_t executed; ///< The number of commands executed.
+    int64_t replayed; ///< The number of commands replayed from previous builds.
+    int64_t filter_lines; ///< The number of lines of output passed to output filters.
+    int64_t load_bytes; ///< The number of bytes read loading the dependency graph.
+    int64_t save_bytes; ///< The number of bytes written saving the dependency graph.
+    Timing bind; ///< The time spent binding Targets to files and dependencies.
+    Timing postorder; ///< The time spent in postorder traversals.
+    Timing load; ///< The time spent loading the dependency graph.
+    Timing save; ///< The time spent saving the dependency graph.
+    double elapsed; ///< The time elapsed since the build started.
+    std::vector<Phases::Phase> phases; ///< The phases recorded in the build.
+    std::vector<Phases::Counter> counters; ///< The counters recorded in the build.
+
+    Statistics();
+    void collect( Forge* forge );
+    void print() const;
+    bool write( const std::string& filename ) const;
+};
+
+}
+
+}
+
+#endif
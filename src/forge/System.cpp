@@ -16,6 +16,7 @@
 #include <sys/sysctl.h>
 #elif defined(BUILD_OS_LINUX)
 #include <unistd.h>
+#include <time.h>
 #include <linux/limits.h>
 #include <sys/sysinfo.h>
 #endif
@@ -24,13 +25,41 @@ using std::string;
 using namespace sweet;
 using namespace sweet::forge;
 
+/**
+// Get the time from a monotonic, high resolution clock.
+//
+// The clock measures elapsed wall-clock time that isn't affected by changes
+// to the system time.  Process CPU time (as returned by `clock()`) isn't 
+// used because it doesn't advance while forge waits on child processes.
+//
+// @return
+//  The time in milliseconds since an arbitrary, fixed point.
+*/
+static double monotonic_milliseconds()
+{
+#if defined(BUILD_OS_WINDOWS)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    ::QueryPerformanceFrequency( &frequency );
+    ::QueryPerformanceCounter( &counter );
+    return double(counter.QuadPart) * 1000.0 / double(frequency.QuadPart);
+#elif defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
+    struct timespec time;
+    clock_gettime( CLOCK_MONOTONIC, &time );
+    return double(time.tv_sec) * 1000.0 + double(time.tv_nsec) / 1000000.0;
+#else
+#error "monotonic_milliseconds() is not implemented for this platform"
+#endif
+}
+
 /**
 // Constructor.
 */
 System::System()
-: initial_tick_count_( 0.0f )
+: initial_tick_count_( monotonic_milliseconds() ),
+  exists_calls_( 0 ),
+  last_write_time_calls_( 0 )
 {
-    initial_tick_count_ = ticks();
 }
 
 /**
@@ -44,6 +73,7 @@ System::System()
 */
 bool System::exists( const std::string& path ) const
 {
+    ++exists_calls_;
     return boost::filesystem::exists( path );
 }
 
@@ -100,6 +130,7 @@ bool System::is_regular( const std::string& path ) const
 */
 std::time_t System::last_write_time( const std::string& path ) const
 {
+    ++last_write_time_calls_;
     return boost::filesystem::last_write_time( path );
 }
 
@@ -350,18 +381,38 @@ void System::sleep( float milliseconds ) const
 /**
 // Get the number of milliseconds elapsed since the start of the system.
 //
+// The elapsed time is wall-clock time from a monotonic clock and includes
+// time spent waiting for child processes to finish.
+//
 // @return
 //  The number of milliseconds elapsed since the system was started.
 */
-float System::ticks() const
+double System::ticks() const
 {    
-#if defined(BUILD_OS_WINDOWS)
-    return static_cast<float>( ::GetTickCount() ) - initial_tick_count_;
-#elif defined(BUILD_OS_MACOS)
-    return static_cast<float>( (clock() - initial_tick_count_) * 1000 / CLOCKS_PER_SEC );
-#elif defined(BUILD_OS_LINUX)
-    return static_cast<float>( (clock() - initial_tick_count_) * 1000 / CLOCKS_PER_SEC );
-#else
-#error "System::ticks() is not implemented for this platform"
-#endif
+    return monotonic_milliseconds() - initial_tick_count_;
+}
+
+/**
+// Get the number of calls made to System::exists().
+//
+// Calls are counted so that the number of file system checks made when
+// binding can be reported (see Statistics).
+//
+// @return
+//  The number of calls made since this System was created.
+*/
+int64_t System::exists_calls() const
+{
+    return exists_calls_;
+}
+
+/**
+// Get the number of calls made to System::last_write_time().
+//
+// @return
+//  The number of calls made since this System was created.
+*/
+int64_t System::last_write_time_calls() const
+{
+    return last_write_time_calls_;
 }
@@ -5,6 +5,7 @@
 #include <boost/filesystem/convenience.hpp>
 #include <string>
 #include <ctime>
+#include <stdint.h>
 
 namespace sweet
 {
@@ -17,7 +18,9 @@ namespace forge
 */
 class System
 {
-    float initial_tick_count_; ///< The tick count when this System object was created.
+    double initial_tick_count_; ///< The tick count when this System object was created.
+    mutable int64_t exists_calls_; ///< The number of calls made to System::exists().
+    mutable int64_t last_write_time_calls_; ///< The number of calls made to System::last_write_time().
 
     public:
         System();
@@ -39,7 +42,9 @@ class System
         const char* getenv( const char* name ) const;
         int number_of_logical_processors() const;
         void sleep( float milliseconds ) const;
-        float ticks() const;
+        double ticks() const;
+        int64_t exists_calls() const;
+        int64_t last_write_time_calls() const;
 };
 
 }
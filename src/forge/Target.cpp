@@ -8,10 +8,15 @@
 #include "Graph.hpp"
 #include "GraphWriter.hpp"
 #include "GraphReader.hpp"
+#include "GraphJournal.hpp"
 #include "Forge.hpp"
 #include "System.hpp"
+#include <process/Usage.hpp>
 #include <assert/assert.hpp>
 #include <algorithm>
+#include <limits>
+#include <memory>
+#include <string.h>
 
 using std::min;
 using std::max;
@@ -20,6 +25,7 @@ using std::remove;
 using std::vector;
 using std::string;
 using std::time_t;
+using std::make_shared;
 using namespace sweet;
 using namespace sweet::forge;
 
@@ -36,6 +42,9 @@ Target::Target()
   last_write_time_( 0 ),
   hash_( 0 ),
   pending_hash_( 0 ),
+  settings_keys_(),
+  fingerprint_( 0 ),
+  usage_(),
   outdated_( false ),
   changed_( false ),
   bound_to_file_( false ),
@@ -43,11 +52,16 @@ Target::Target()
   referenced_by_script_( false ),
   cleanable_( false ),
   built_( false ),
+  modified_( false ),
+  replayed_( false ),
+  outdated_reason_( OUTDATED_NONE ),
+  outdated_dependency_( NULL ),
   working_directory_( NULL ),
   parent_( NULL ),
   targets_(),
   dependencies_(),
   implicit_dependencies_(),
+  implicit_dependencies_shared_( false ),
   ordering_dependencies_(),
   filenames_(),
   visiting_( false ),
@@ -77,6 +91,9 @@ Target::Target( const std::string& id, Graph* graph )
   last_write_time_( 0 ),
   hash_( 0 ),
   pending_hash_( 0 ),
+  settings_keys_(),
+  fingerprint_( 0 ),
+  usage_(),
   outdated_( false ),
   changed_( false ),
   bound_to_file_( false ),
@@ -84,11 +101,16 @@ Target::Target( const std::string& id, Graph* graph )
   referenced_by_script_( false ),
   cleanable_( false ),
   built_( false ),
+  modified_( true ),
+  replayed_( false ),
+  outdated_reason_( OUTDATED_NONE ),
+  outdated_dependency_( NULL ),
   working_directory_( NULL ),
   parent_( NULL ),
   targets_(),
   dependencies_(),
   implicit_dependencies_(),
+  implicit_dependencies_shared_( false ),
   ordering_dependencies_(),
   filenames_(),
   visiting_( false ),
@@ -127,6 +149,11 @@ void Target::recover( Graph* graph )
     SWEET_ASSERT( graph_ == NULL || graph_ == graph );
 
     graph_ = graph;
+    share_implicit_dependencies();
+    if ( settings_keys_ )
+    {
+        settings_keys_ = graph_->intern_settings_keys( settings_keys_ );
+    }
 
     for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
     {
@@ -334,17 +361,31 @@ void Target::bind_to_file()
             }
 
             changed_ = last_write_time_ != earliest_last_write_time;
+            modified_ = modified_ || changed_ || hash_ != pending_hash_;
             timestamp_ = latest_last_write_time;
             last_write_time_ = earliest_last_write_time;
             outdated_ = outdated || hash_ != pending_hash_;
+            outdated_reason_ = 
+                outdated ? OUTDATED_MISSING_FILE : 
+                hash_ != pending_hash_ ? (hash_ == 0 ? OUTDATED_NOT_BUILT : OUTDATED_SETTINGS_CHANGED) : 
+                OUTDATED_NONE
+            ;
+            outdated_dependency_ = NULL;
             hash_ = pending_hash_;
         }
         else
         {
             changed_ = last_write_time_ != 0;
+            modified_ = modified_ || changed_ || hash_ != pending_hash_;
             timestamp_ = 0;
             last_write_time_ = 0;
             outdated_ = !built_ || hash_ != pending_hash_;
+            outdated_reason_ = 
+                !built_ ? OUTDATED_NOT_BUILT : 
+                hash_ != pending_hash_ ? (hash_ == 0 ? OUTDATED_NOT_BUILT : OUTDATED_SETTINGS_CHANGED) : 
+                OUTDATED_NONE
+            ;
+            outdated_dependency_ = NULL;
             hash_ = pending_hash_;
         }
         
@@ -359,6 +400,11 @@ void Target::bind_to_file()
 // files that it is bound to or the latest timestamp of any of its 
 // dependencies.  Set this Target to be outdated if any of its dependencies 
 // have a timestamp that is later than its last write time.
+//
+// The first reason found for this Target being outdated is kept along with
+// the dependency responsible, if any, so that it can be explained later 
+// (see Graph::print_explanation()).  A newer dependency is the one with the
+// latest timestamp.
 */
 void Target::bind_to_dependencies()
 {
@@ -366,24 +412,41 @@ void Target::bind_to_dependencies()
     {
         time_t timestamp = timestamp_;
         bool outdated = outdated_;
+        Target* newest_dependency = NULL;
 
         int i = 0;
         Target* target = binding_dependency( i );
         while ( target )
         {
+            if ( !outdated && target->outdated() )
+            {
+                outdated_reason_ = OUTDATED_DEPENDENCY_OUTDATED;
+                outdated_dependency_ = target;
+            }
             outdated = outdated || target->outdated();
             timestamp = std::max( timestamp, target->timestamp() );
+            if ( !newest_dependency || target->timestamp() > newest_dependency->timestamp() )
+            {
+                newest_dependency = target;
+            }
             ++i;
             target = binding_dependency( i );
         }
 
-        if ( !filenames_.empty() )
+        if ( !filenames_.empty() && !outdated )
         {
-            outdated = 
-                outdated || 
-                timestamp > last_write_time() ||
-                (cleanable_ && !built_)
-            ;
+            if ( timestamp > last_write_time() )
+            {
+                outdated = true;
+                outdated_reason_ = OUTDATED_DEPENDENCY_NEWER;
+                outdated_dependency_ = newest_dependency && newest_dependency->timestamp() > last_write_time() ? newest_dependency : NULL;
+            }
+            else if ( cleanable_ && !built_ )
+            {
+                outdated = true;
+                outdated_reason_ = OUTDATED_NOT_BUILT;
+                outdated_dependency_ = NULL;
+            }
         }
 
         set_timestamp( timestamp );
@@ -403,6 +466,176 @@ void Target::set_hash( uint64_t hash )
     pending_hash_ = hash;
 }
 
+/**
+// Set the names of the settings read when this Target was built.
+//
+// The hash of just those settings replaces the hash of all of this Target's
+// settings so that changing settings that building this Target didn't read
+// doesn't make it outdated.  This Target is considered modified if either
+// the settings keys or the hash change.
+//
+// @param settings_keys
+//  The interned names of the settings read (see 
+//  Graph::intern_settings_keys()) or null to hash all settings.
+//
+// @param hash
+//  The hash of the settings named by \e settings_keys or of all settings if
+//  \e settings_keys is null.
+*/
+void Target::set_settings_keys( const std::shared_ptr<std::vector<std::string>>& settings_keys, uint64_t hash )
+{
+    modified_ = modified_ || settings_keys_ != settings_keys || hash_ != hash;
+    settings_keys_ = settings_keys;
+    hash_ = hash;
+    pending_hash_ = hash;
+}
+
+/**
+// Get the names of the settings read when this Target was last built.
+//
+// @return
+//  The names of the settings or null if this Target's hash covers all of
+//  its settings.
+*/
+const std::vector<std::string>* Target::settings_keys() const
+{
+    return settings_keys_.get();
+}
+
+/**
+// Set the digest of the commands executed when this Target was built.
+//
+// @param fingerprint
+//  The digest of the command, command line, environment, and working 
+//  directory of each command executed (see Job::replay()) or 0 if no 
+//  commands were executed.
+*/
+void Target::set_fingerprint( uint64_t fingerprint )
+{
+    modified_ = modified_ || fingerprint_ != fingerprint;
+    fingerprint_ = fingerprint;
+}
+
+/**
+// Get the digest of the commands executed when this Target was last built.
+//
+// @return
+//  The digest or 0 if building this Target last time didn't execute any
+//  commands.
+*/
+uint64_t Target::fingerprint() const
+{
+    return fingerprint_;
+}
+
+/**
+// Set whether or not this Target replayed all of the commands from its 
+// previous build rather than executing them.
+//
+// @param replayed
+//  True if every command was replayed otherwise false.
+*/
+void Target::set_replayed( bool replayed )
+{
+    replayed_ = replayed;
+}
+
+/**
+// Did this Target replay all of the commands from its previous build in the
+// current or most recent traversal?
+//
+// @return
+//  True if this Target's files were left as they were by its previous build
+//  otherwise false.
+*/
+bool Target::replayed() const
+{
+    return replayed_;
+}
+
+/**
+// Set the resources used by the commands executed when this Target was 
+// built.
+//
+// @param usage
+//  The resources used by the commands executed (see Job::add_usage()).
+*/
+void Target::set_usage( const process::Usage& usage )
+{
+    if ( !usage_ )
+    {
+        usage_.reset( new process::Usage(usage) );
+        modified_ = true;
+    }
+    else if ( memcmp(usage_.get(), &usage, sizeof(usage)) != 0 )
+    {
+        *usage_ = usage;
+        modified_ = true;
+    }
+}
+
+/**
+// Get the resources used by the commands executed when this Target was 
+// last built.
+//
+// @return
+//  The resources used or null if building this Target hasn't executed any
+//  commands.
+*/
+const process::Usage* Target::usage() const
+{
+    return usage_.get();
+}
+
+/**
+// Can this Target replay the commands from its previous build rather than
+// executing them again?
+//
+// Replaying a command that is identical to the one executed last time skips
+// executing it and leaves this Target's files as they are.  This is only 
+// safe when this Target is outdated just because its settings hash changed
+// or because dependencies that replayed their own commands were outdated. 
+// It must also have been built successfully last time, be bound to files 
+// that exist, and be newer than all of its binding dependencies.  Its
+// TargetPrototype must build it with a single command (see 
+// TargetPrototype::single_command()) so that replaying the first command 
+// never skips work that later commands depend on.
+//
+// @return
+//  True if this Target can replay the commands from its previous build 
+//  otherwise false.
+*/
+bool Target::replayable() const
+{
+    if ( !outdated_ || !built_ || fingerprint_ == 0 || filenames_.empty() )
+    {
+        return false;
+    }
+
+    if ( !prototype_ || !prototype_->single_command() )
+    {
+        return false;
+    }
+
+    if ( last_write_time_ == 0 || timestamp_ > last_write_time_ )
+    {
+        return false;
+    }
+
+    int i = 0;
+    Target* target = binding_dependency( i );
+    while ( target )
+    {
+        if ( target->outdated() && !target->replayed() )
+        {
+            return false;
+        }
+        ++i;
+        target = binding_dependency( i );
+    }
+    return true;
+}
+
 /**
 // Set whether or not this Target is referenced by a scripting object.
 //
@@ -462,6 +695,7 @@ bool Target::cleanable() const
 */
 void Target::set_built( bool built )
 {
+    modified_ = modified_ || built_ != built;
     built_ = built;
 }
 
@@ -476,6 +710,31 @@ bool Target::built() const
     return built_;
 }
 
+/**
+// Set whether or not the persistent state of this Target has changed since
+// it was last loaded, saved, or journaled.
+//
+// @param modified
+//  True to mark this Target as modified or false to mark it as matching its
+//  most recently saved or journaled state.
+*/
+void Target::set_modified( bool modified )
+{
+    modified_ = modified;
+}
+
+/**
+// Has the persistent state of this Target changed since it was last loaded,
+// saved, or journaled?
+//
+// @return
+//  True if this Target needs to be saved or journaled otherwise false.
+*/
+bool Target::modified() const
+{
+    return modified_;
+}
+
 /**
 // Set the timestamp for this Target.
 //
@@ -546,6 +805,30 @@ bool Target::outdated() const
     return outdated_;
 }
 
+/**
+// Get the first reason found for this Target being outdated when it was 
+// last bound.
+//
+// @return
+//  The OutdatedReason or OUTDATED_NONE if this Target wasn't outdated.
+*/
+OutdatedReason Target::outdated_reason() const
+{
+    return outdated_ ? outdated_reason_ : OUTDATED_NONE;
+}
+
+/**
+// Get the dependency that made this Target outdated when it was last bound.
+//
+// @return
+//  The dependency that is outdated or newer than this Target or null if 
+//  this Target wasn't made outdated by a dependency.
+*/
+Target* Target::outdated_dependency() const
+{
+    return outdated_ ? outdated_dependency_ : NULL;
+}
+
 /**
 // Is this Target's last write time changed since it was last bound?
 //
@@ -579,6 +862,7 @@ bool Target::bound_to_file() const
 void Target::add_filename( const std::string& filename )
 {
     filenames_.push_back( filename );
+    modified_ = true;
 }
 
 /**
@@ -600,8 +884,13 @@ void Target::set_filename( const std::string& filename, int index )
     if ( index >= int(filenames_.size()) )
     {
         filenames_.insert( filenames_.end(), index - filenames_.size() + 1, string() );
+        modified_ = true;
+    }
+    if ( filenames_[index] != filename )
+    {
+        filenames_[index] = filename;
+        modified_ = true;
     }
-    filenames_[index] = filename;
 }
 
 /**
@@ -611,7 +900,11 @@ void Target::clear_filenames( int start, int finish )
 {
     vector<string>::iterator begin = filenames_.begin() + max( start, 0 );
     vector<string>::iterator end = filenames_.begin() + min( finish, int(filenames_.size()) );
-    filenames_.erase( begin, end );
+    if ( begin < end )
+    {
+        filenames_.erase( begin, end );
+        modified_ = true;
+    }
 }
 
 /**
@@ -754,6 +1047,24 @@ void Target::destroy_anonymous_targets()
     targets_.erase( remove(targets_.begin(), targets_.end(), (Target*) NULL), targets_.end() );
 }
 
+/**
+// Destroy any targets that are direct children of this target and that 
+// haven't been visited in the current pass.
+*/
+void Target::destroy_unvisited_targets()
+{
+    for ( vector<Target*>::iterator i = targets_.begin(); i != targets_.end(); ++i )
+    {
+        Target* target = *i;
+        if ( !target->visited() )
+        {
+            delete target;
+            *i = NULL;
+        }
+    }
+    targets_.erase( remove(targets_.begin(), targets_.end(), (Target*) NULL), targets_.end() );
+}
+
 /**
 // Find a Target by id.
 //
@@ -857,8 +1168,9 @@ void Target::add_implicit_dependency( Target* target )
     if ( able_to_add_implicit_dependency )
     {
         remove_dependency( target );
-        implicit_dependencies_.push_back( target );
+        unshared_implicit_dependencies().push_back( target );
         bound_to_dependencies_ = false;
+        modified_ = true;
     }
 }
 
@@ -877,11 +1189,10 @@ void Target::remove_implicit_dependency( Target* target )
     if ( target && target != this )
     {
         SWEET_ASSERT( target->graph() == graph() );
-        vector<Target*>::iterator i = find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target );
-        if ( i != implicit_dependencies_.end() )
+        if ( erase_implicit_dependency(target) )
         {
-            implicit_dependencies_.erase( i );
             bound_to_dependencies_ = false;
+            modified_ = true;
         }
     }
 }
@@ -894,10 +1205,52 @@ void Target::remove_implicit_dependency( Target* target )
 */
 void Target::clear_implicit_dependencies()
 {
-    implicit_dependencies_.clear();
+    modified_ = modified_ || !implicit_dependencies().empty();
+    implicit_dependencies_.reset();
+    implicit_dependencies_shared_ = false;
     bound_to_dependencies_ = false;
 }
 
+/**
+// Share this Target's implicit dependencies with any other Targets that 
+// have identical implicit dependencies.
+//
+// Objects built from the same library or directory usually have identical
+// implicit dependencies on the same headers.  Interning the list through 
+// the Graph (see Graph::intern_implicit_dependencies()) keeps only one copy
+// of each distinct list in memory.  The shared list is copied again the 
+// next time that this Target's implicit dependencies are changed.
+*/
+void Target::share_implicit_dependencies()
+{
+    SWEET_ASSERT( graph_ );
+    if ( implicit_dependencies_ )
+    {
+        if ( !implicit_dependencies_->empty() )
+        {
+            implicit_dependencies_ = graph_->intern_implicit_dependencies( implicit_dependencies_ );
+            implicit_dependencies_shared_ = true;
+        }
+        else
+        {
+            implicit_dependencies_.reset();
+            implicit_dependencies_shared_ = false;
+        }
+    }
+}
+
+/**
+// Get this Target's implicit dependencies.
+//
+// @return
+//  The implicit dependencies.
+*/
+const std::vector<Target*>& Target::implicit_dependencies() const
+{
+    static const vector<Target*> NO_IMPLICIT_DEPENDENCIES;
+    return implicit_dependencies_ ? *implicit_dependencies_ : NO_IMPLICIT_DEPENDENCIES;
+}
+
 /**
 // Add an ordering dependency to this Target.
 //
@@ -955,11 +1308,10 @@ void Target::remove_dependency( Target* target )
         }
         else 
         {
-            i = find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target );
-            if ( i != implicit_dependencies_.end() )
+            if ( erase_implicit_dependency(target) )
             {
-                implicit_dependencies_.erase( i );
                 bound_to_dependencies_ = false;
+                modified_ = true;
             }
             else 
             {
@@ -998,7 +1350,8 @@ bool Target::is_explicit_dependency( Target* target ) const
 */
 bool Target::is_implicit_dependency( Target* target ) const
 {
-    return find( implicit_dependencies_.begin(), implicit_dependencies_.end(), target ) != implicit_dependencies_.end();
+    const vector<Target*>& implicit_dependencies = Target::implicit_dependencies();
+    return find( implicit_dependencies.begin(), implicit_dependencies.end(), target ) != implicit_dependencies.end();
 }
 
 /**
@@ -1067,9 +1420,10 @@ Target* Target::explicit_dependency( int n ) const
 Target* Target::implicit_dependency( int n ) const
 {
     SWEET_ASSERT( n >= 0 );
-    if ( n >= 0 && n < int(implicit_dependencies_.size()) )
+    const vector<Target*>& implicit_dependencies = Target::implicit_dependencies();
+    if ( n >= 0 && n < int(implicit_dependencies.size()) )
     {
-        return implicit_dependencies_[n];
+        return implicit_dependencies[n];
     }
     return NULL;
 }
@@ -1120,9 +1474,10 @@ Target* Target::binding_dependency( int n ) const
     }
 
     n -= int(dependencies_.size());
-    if ( n >= 0 && n < int(implicit_dependencies_.size()) )
+    const vector<Target*>& implicit_dependencies = Target::implicit_dependencies();
+    if ( n >= 0 && n < int(implicit_dependencies.size()) )
     {
-        return implicit_dependencies_[n];
+        return implicit_dependencies[n];
     }
 
     return NULL;
@@ -1161,12 +1516,13 @@ Target* Target::any_dependency( int n ) const
     }
 
     n -= int(dependencies_.size());
-    if ( n >= 0 && n < int(implicit_dependencies_.size()) )
+    const vector<Target*>& implicit_dependencies = Target::implicit_dependencies();
+    if ( n >= 0 && n < int(implicit_dependencies.size()) )
     {
-        return implicit_dependencies_[n];
+        return implicit_dependencies[n];
     }
 
-    n -= int(implicit_dependencies_.size());
+    n -= int(implicit_dependencies.size());
     if ( n >= 0 && n < int(ordering_dependencies_.size()) )
     {
         return ordering_dependencies_[n];
@@ -1431,14 +1787,24 @@ int Target::next_anonymous_index()
 */
 void Target::write( GraphWriter& writer )
 {
-    writer.object_address( this );
-    writer.value( id_ );
-    writer.value( last_write_time_ );
-    writer.value( hash_ );
-    writer.value( built_ );
-    writer.value( filenames_ );
-    writer.value( targets_ );
-    writer.refer( implicit_dependencies_ );    
+    GraphTargetRecord* record = writer.record( this );
+    record->id = writer.string( id_ );
+    record->last_write_time = int64_t(last_write_time_);
+    record->hash = hash_;
+    record->fingerprint = fingerprint_;
+    record->flags = (built_ ? GRAPH_TARGET_BUILT : 0) | (settings_keys_ ? GRAPH_TARGET_SETTINGS_KEYS : 0);
+    record->targets = writer.targets( targets_ );
+    record->filenames = writer.strings( filenames_ );
+    record->implicit_dependencies = writer.refer( implicit_dependencies() );
+    if ( settings_keys_ )
+    {
+        record->settings_keys = writer.strings( *settings_keys_ );
+    }
+    if ( usage_ )
+    {
+        record->usage = writer.usage( *usage_ );
+    }
+    modified_ = false;
 }
 
 /**
@@ -1446,41 +1812,178 @@ void Target::write( GraphWriter& writer )
 //
 // @param reader 
 //  The GraphReader to deserialize this Target from.
+//
+// @param record
+//  The target record to read this Target from.
+*/
+void Target::read( GraphReader& reader, const GraphTargetRecord& record )
+{
+    id_ = reader.string( record.id );
+    last_write_time_ = time_t(record.last_write_time);
+    hash_ = record.hash;
+    fingerprint_ = record.fingerprint;
+    built_ = (record.flags & GRAPH_TARGET_BUILT) != 0;
+    reader.targets( record.targets, &targets_ );
+    reader.strings( record.filenames, &filenames_ );
+    implicit_dependencies_ = reader.refer( record.implicit_dependencies );
+    implicit_dependencies_shared_ = true;
+    if ( record.flags & GRAPH_TARGET_SETTINGS_KEYS )
+    {
+        settings_keys_ = reader.shared_strings( record.settings_keys );
+    }
+    if ( record.usage.count > 0 )
+    {
+        usage_.reset( new process::Usage );
+        reader.usage( record.usage, usage_.get() );
+    }
+    modified_ = false;
+}
+
+/**
+// Write this Target to an entry in \e journal.
+//
+// @param journal
+//  The GraphJournal to append this Target's persistent state to.
 */
-void Target::read( GraphReader& reader )
+void Target::write( GraphJournal& journal )
 {
-    reader.object_address( this );
-    reader.value( &id_ );
-    reader.value( &last_write_time_ );
-    reader.value( &hash_ );
-    reader.value( &built_ );
-    reader.value( &filenames_ );
-    reader.value( &targets_ );
-    reader.refer( &implicit_dependencies_ );    
+    journal.value( last_write_time_ );
+    journal.value( hash_ );
+    journal.value( built_ );
+    journal.value( filenames_ );
+    journal.refer( implicit_dependencies() );
+    journal.value( settings_keys_ != nullptr );
+    journal.value( settings_keys_ ? *settings_keys_ : vector<string>() );
+    journal.value( fingerprint_ );
+    journal.value( usage_ != nullptr );
+    if ( usage_ )
+    {
+        journal.value( uint64_t(usage_->wall_time) );
+        journal.value( uint64_t(usage_->user_time) );
+        journal.value( uint64_t(usage_->system_time) );
+        journal.value( uint64_t(usage_->peak_memory) );
+        journal.value( uint64_t(usage_->input_blocks) );
+        journal.value( uint64_t(usage_->output_blocks) );
+    }
+    modified_ = false;
 }
 
 /**
-// Resolve this Target's implicit dependencies to their new addresses.
+// Read this Target from an entry in \e journal.
 //
-// Recursively updates the addresses of this Target and its ancestors implicit
-// dependencies from their old addresses when the Graph was written out to 
-// their new addresses now that the Graph has been read back in.
+// This Target is only updated if the whole entry is valid.
 //
-// @param reader
-//  The GraphReader just read in the Graph.
+// @param journal
+//  The GraphJournal to replay this Target's persistent state from.
+//
+// @return
+//  True if the entry was valid and applied otherwise false.
+*/
+bool Target::read( GraphJournal& journal )
+{
+    time_t last_write_time = 0;
+    uint64_t hash = 0;
+    bool built = false;
+    vector<string> filenames;
+    vector<Target*> implicit_dependencies;
+    bool has_settings_keys = false;
+    vector<string> settings_keys;
+    uint64_t fingerprint = 0;
+    bool has_usage = false;
+    uint64_t usage [6] = { 0, 0, 0, 0, 0, 0 };
+    bool valid = 
+        journal.value( &last_write_time ) &&
+        journal.value( &hash ) &&
+        journal.value( &built ) &&
+        journal.value( &filenames ) &&
+        journal.refer( &implicit_dependencies ) &&
+        journal.value( &has_settings_keys ) &&
+        journal.value( &settings_keys ) &&
+        journal.value( &fingerprint ) &&
+        journal.value( &has_usage ) && 
+        (!has_usage || (
+            journal.value( &usage[0] ) &&
+            journal.value( &usage[1] ) &&
+            journal.value( &usage[2] ) &&
+            journal.value( &usage[3] ) &&
+            journal.value( &usage[4] ) &&
+            journal.value( &usage[5] )
+        ))
+    ;
+    if ( valid )
+    {
+        last_write_time_ = last_write_time;
+        hash_ = hash;
+        built_ = built;
+        filenames_.swap( filenames );
+        implicit_dependencies.erase( remove(implicit_dependencies.begin(), implicit_dependencies.end(), this), implicit_dependencies.end() );
+        implicit_dependencies_.reset();
+        implicit_dependencies_shared_ = false;
+        if ( !implicit_dependencies.empty() )
+        {
+            implicit_dependencies_ = make_shared<vector<Target*>>( std::move(implicit_dependencies) );
+        }
+        settings_keys_.reset();
+        if ( has_settings_keys )
+        {
+            settings_keys_ = make_shared<vector<string>>( std::move(settings_keys) );
+        }
+        fingerprint_ = fingerprint;
+        usage_.reset();
+        if ( has_usage )
+        {
+            process::Usage values = { int64_t(usage[0]), int64_t(usage[1]), int64_t(usage[2]), int64_t(usage[3]), int64_t(usage[4]), int64_t(usage[5]) };
+            usage_.reset( new process::Usage(values) );
+        }
+        bound_to_dependencies_ = false;
+        modified_ = false;
+    }
+    return valid;
+}
+
+/**
+// Get this Target's implicit dependencies so that they can be changed.
+//
+// Shared implicit dependencies are copied first so that changes made to 
+// this Target's implicit dependencies don't affect other Targets.
+//
+// @return
+//  The implicit dependencies.
 */
-void Target::resolve( const GraphReader& reader )
+std::vector<Target*>& Target::unshared_implicit_dependencies()
 {
-    for ( vector<Target*>::iterator i = implicit_dependencies_.begin(); i != implicit_dependencies_.end(); ++i )
+    if ( !implicit_dependencies_ )
+    {
+        implicit_dependencies_ = make_shared<vector<Target*>>();
+    }
+    else if ( implicit_dependencies_shared_ )
     {
-        *i = reinterpret_cast<Target*>( reader.find_address_by_old_address(*i) );
+        implicit_dependencies_ = make_shared<vector<Target*>>( *implicit_dependencies_ );
     }
-    implicit_dependencies_.erase( remove(implicit_dependencies_.begin(), implicit_dependencies_.end(), nullptr), implicit_dependencies_.end() );
+    implicit_dependencies_shared_ = false;
+    return *implicit_dependencies_;
+}
 
-    for ( vector<Target*>::const_iterator i = targets_.begin(); i != targets_.end(); ++i )
+/**
+// Erase \e target from this Target's implicit dependencies.
+//
+// @param target
+//  The Target to erase.
+//
+// @return
+//  True if \e target was an implicit dependency and has been erased 
+//  otherwise false.
+*/
+bool Target::erase_implicit_dependency( Target* target )
+{
+    const vector<Target*>& implicit_dependencies = Target::implicit_dependencies();
+    vector<Target*>::const_iterator i = find( implicit_dependencies.begin(), implicit_dependencies.end(), target );
+    if ( i != implicit_dependencies.end() )
     {
-        Target* target = *i;
-        SWEET_ASSERT( target );
-        target->resolve( reader );
+        ptrdiff_t index = i - implicit_dependencies.begin();
+        vector<Target*>& unshared_implicit_dependencies = Target::unshared_implicit_dependencies();
+        unshared_implicit_dependencies.erase( unshared_implicit_dependencies.begin() + index );
+        return true;
     }
+    return false;
 }
@@ -4,20 +4,44 @@
 #include <ctime>
 #include <string>
 #include <vector>
+#include <memory>
 #include <stdint.h>
 
 namespace sweet
 {
 
+namespace process
+{
+
+struct Usage;
+
+}
+
 namespace forge
 {
 
 class GraphWriter;
 class GraphReader;
+class GraphJournal;
+struct GraphTargetRecord;
 class TargetPrototype;
 class Graph;
 class Forge;
 
+/**
+// The first reason found for a Target being outdated when it was last 
+// bound.
+*/
+enum OutdatedReason
+{
+    OUTDATED_NONE, ///< The Target isn't outdated.
+    OUTDATED_MISSING_FILE, ///< A file that the Target is bound to doesn't exist.
+    OUTDATED_NOT_BUILT, ///< The Target hasn't been built before.
+    OUTDATED_SETTINGS_CHANGED, ///< The hash of the settings read to build the Target has changed.
+    OUTDATED_DEPENDENCY_OUTDATED, ///< A dependency of the Target is outdated.
+    OUTDATED_DEPENDENCY_NEWER ///< A dependency of the Target is newer than the files that it is bound to.
+};
+
 /**
 // A Target.
 */
@@ -32,6 +56,9 @@ class Target
     std::time_t last_write_time_; ///< The last write time of the file that this Target is bound to.
     uint64_t hash_; ///< The hash for this Target the last time that it was built.
     uint64_t pending_hash_; ///< The hash for this Target when it was created in the current run.
+    std::shared_ptr<std::vector<std::string>> settings_keys_; ///< The names of the settings read when this Target was last built or null if its hash covers all of its settings (shared with other Targets).
+    uint64_t fingerprint_; ///< The digest of the commands executed the last time that this Target was built or 0 if it executed none.
+    std::unique_ptr<process::Usage> usage_; ///< The resources used by the commands executed the last time that this Target was built or null if it executed none.
     bool outdated_; ///< Whether or not this Target is out of date.
     bool changed_; ///< Whether or not this Target's timestamp has changed since the last time it was bound to a file.
     bool bound_to_file_; ///< Whether or not this Target is bound to a file.
@@ -39,11 +66,16 @@ class Target
     bool referenced_by_script_; ///< Whether or not this Target is referenced by a scripting object.  
     bool cleanable_; ///< Whether or not this Target is able to be cleaned.
     bool built_; ///< Whether or not this Target has had `Target::clear_implicit_dependencies()` called on it.
+    bool modified_; ///< Whether or not the persistent state of this Target has changed since it was last loaded, saved, or journaled.
+    bool replayed_; ///< Whether or not this Target replayed all of the commands from its previous build in the current or most recent traversal.
+    OutdatedReason outdated_reason_; ///< The first reason found for this Target being outdated when it was last bound.
+    Target* outdated_dependency_; ///< The dependency that made this Target outdated or null if a dependency didn't.
     Target* working_directory_; ///< The Target that relative paths expressed when this Target is visited are relative to.
     Target* parent_; ///< The parent of this Target in the Target namespace or null if this Target has no parent.
     std::vector<Target*> targets_; ///< The children of this Target in the Target namespace.
     std::vector<Target*> dependencies_; ///< The Targets that this Target depends on.
-    std::vector<Target*> implicit_dependencies_; ///< The Targets that this Target implicitly depends on.
+    std::shared_ptr<std::vector<Target*>> implicit_dependencies_; ///< The Targets that this Target implicitly depends on or null if there are none (possibly shared with other Targets).
+    bool implicit_dependencies_shared_; ///< Whether or not the implicit dependencies of this Target are shared and must be copied before they are changed.
     std::vector<Target*> ordering_dependencies_; ///< The Targets that must build before this Target is built.
     std::vector<std::string> filenames_; ///< The filenames of this Target.
     bool visiting_; ///< Whether or not this Target is in the process of being visited.
@@ -73,6 +105,15 @@ class Target
         void bind_to_dependencies();
         void bind_to_hash();
         void set_hash( uint64_t hash );
+        void set_settings_keys( const std::shared_ptr<std::vector<std::string>>& settings_keys, uint64_t hash );
+        const std::vector<std::string>* settings_keys() const;
+        void set_fingerprint( uint64_t fingerprint );
+        uint64_t fingerprint() const;
+        void set_replayed( bool replayed );
+        bool replayed() const;
+        void set_usage( const process::Usage& usage );
+        const process::Usage* usage() const;
+        bool replayable() const;
 
         void set_referenced_by_script( bool referenced_by_script );
         bool referenced_by_script() const;
@@ -83,12 +124,17 @@ class Target
         void set_built( bool built );
         bool built() const;
 
+        void set_modified( bool modified );
+        bool modified() const;
+
         void set_timestamp( std::time_t timestamp );
         std::time_t timestamp() const;
         std::time_t last_write_time() const;
 
         void set_outdated( bool outdated );
         bool outdated() const;
+        OutdatedReason outdated_reason() const;
+        Target* outdated_dependency() const;
         bool changed() const;
         bool bound_to_file() const;
 
@@ -107,6 +153,7 @@ class Target
 
         void add_target( Target* target, Target* this_target );
         void destroy_anonymous_targets();
+        void destroy_unvisited_targets();
         Target* find_target_by_id( const std::string& id ) const;
         const std::vector<Target*>& targets() const;
 
@@ -115,6 +162,8 @@ class Target
         void add_implicit_dependency( Target* target );
         void remove_implicit_dependency( Target* target );
         void clear_implicit_dependencies();
+        void share_implicit_dependencies();
+        const std::vector<Target*>& implicit_dependencies() const;
         void add_ordering_dependency( Target* target );
         void clear_ordering_dependencies();
         void remove_dependency( Target* target );
@@ -147,9 +196,14 @@ class Target
         int next_anonymous_index();
 
         void write( GraphWriter& writer );
-        void read( GraphReader& reader );
-        void resolve( const GraphReader& reader );
+        void read( GraphReader& reader, const GraphTargetRecord& record );
+        void write( GraphJournal& journal );
+        bool read( GraphJournal& journal );
         template <class Archive> void persist( Archive& archive );
+
+    private:
+        std::vector<Target*>& unshared_implicit_dependencies();
+        bool erase_implicit_dependency( Target* target );
 };
 
 }
@@ -20,7 +20,8 @@ using namespace sweet::forge;
 */
 TargetPrototype::TargetPrototype( const std::string& id, Forge* forge )
 : id_( id ),
-  forge_( forge )  
+  forge_( forge ),
+  single_command_( false )
 {
     SWEET_ASSERT( forge_ );
 }
@@ -43,3 +44,34 @@ const std::string& TargetPrototype::id() const
 {
     return id_;
 }
+
+/**
+// Set whether or not building Targets of this TargetPrototype executes at
+// most one command.
+//
+// Only Targets whose TargetPrototype builds them with a single command can
+// replay that command rather than execute it (see Target::replayable()).
+// Replay is decided as each command is issued so a build that executes more
+// commands than it did last time would otherwise skip its first command and
+// run the rest against stale output.
+//
+// @param single_command
+//  True if building Targets of this TargetPrototype executes at most one
+//  command otherwise false.
+*/
+void TargetPrototype::set_single_command( bool single_command )
+{
+    single_command_ = single_command;
+}
+
+/**
+// Does building Targets of this TargetPrototype execute at most one command?
+//
+// @return
+//  True if building Targets of this TargetPrototype executes at most one
+//  command otherwise false.
+*/
+bool TargetPrototype::single_command() const
+{
+    return single_command_;
+}
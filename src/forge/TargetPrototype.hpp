@@ -18,11 +18,14 @@ class TargetPrototype
 {
     std::string id_; ///< The identifier for this TargetPrototype.
     Forge* forge_; ///< The Forge that this TargetPrototype is part of.
+    bool single_command_; ///< True if building Targets of this TargetPrototype executes at most one command.
 
     public:
         TargetPrototype( const std::string& id, Forge* forge );
         ~TargetPrototype();
         const std::string& id() const;
+        void set_single_command( bool single_command );
+        bool single_command() const;
 };
 
 }
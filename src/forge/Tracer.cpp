@@ -0,0 +1,323 @@
+//
+// Tracer.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "Tracer.hpp"
+#include "Target.hpp"
+#include <assert/assert.hpp>
+#include <inttypes.h>
+#include <stdio.h>
+
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using namespace sweet;
+using namespace sweet::forge;
+
+/**
+// Constructor.
+//
+// @param tracer
+//  The Tracer to record the span with (may be null).
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param name
+//  The name of the span.
+//
+// @param detail
+//  Detail to show with the span or empty for none.
+*/
+Tracer::Span::Span( Tracer* tracer, const char* category, const std::string& name, const std::string& detail )
+: tracer_( tracer && tracer->enabled() ? tracer : nullptr ),
+  category_( category ),
+  name_(),
+  detail_(),
+  begin_( 0 )
+{
+    if ( tracer_ )
+    {
+        name_ = name;
+        detail_ = detail;
+        begin_ = tracer_->now();
+    }
+}
+
+/**
+// Constructor for a span named for a Target.
+//
+// @param tracer
+//  The Tracer to record the span with (may be null).
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param target
+//  The Target whose path names the span.
+*/
+Tracer::Span::Span( Tracer* tracer, const char* category, const Target* target )
+: tracer_( tracer && tracer->enabled() ? tracer : nullptr ),
+  category_( category ),
+  name_(),
+  detail_(),
+  begin_( 0 )
+{
+    SWEET_ASSERT( target );
+    if ( tracer_ )
+    {
+        name_ = target->path();
+        begin_ = tracer_->now();
+    }
+}
+
+/**
+// Constructor for a span detailed with a Target.
+//
+// @param tracer
+//  The Tracer to record the span with (may be null).
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param name
+//  The name of the span.
+//
+// @param target
+//  The Target whose path is shown with the span.
+*/
+Tracer::Span::Span( Tracer* tracer, const char* category, const char* name, const Target* target )
+: tracer_( tracer && tracer->enabled() ? tracer : nullptr ),
+  category_( category ),
+  name_(),
+  detail_(),
+  begin_( 0 )
+{
+    SWEET_ASSERT( name );
+    SWEET_ASSERT( target );
+    if ( tracer_ )
+    {
+        name_ = name;
+        detail_ = target->path();
+        begin_ = tracer_->now();
+    }
+}
+
+/**
+// Destructor.
+//
+// Records the span with the Tracer passed at construction if tracing was
+// enabled then.
+*/
+Tracer::Span::~Span()
+{
+    if ( tracer_ )
+    {
+        tracer_->span( category_, name_, detail_, begin_, tracer_->now() );
+    }
+}
+
+/**
+// Constructor.
+*/
+Tracer::Tracer()
+: enabled_( false ),
+  filename_(),
+  origin_( steady_clock::now() ),
+  mutex_(),
+  events_(),
+  threads_()
+{
+}
+
+/**
+// Is tracing enabled?
+//
+// @return
+//  True if spans are being recorded otherwise false.
+*/
+bool Tracer::enabled() const
+{
+    return enabled_;
+}
+
+/**
+// Get the name of the file that the trace is written to.
+//
+// @return
+//  The filename or an empty string if tracing hasn't been started.
+*/
+const std::string& Tracer::filename() const
+{
+    return filename_;
+}
+
+/**
+// Start recording spans.
+//
+// Spans recorded since tracing was last started are discarded and times are
+// measured from now.  The calling thread is the first track in the trace.
+//
+// @param filename
+//  The name of the file to write the trace to (see Tracer::write()).
+*/
+void Tracer::start( const std::string& filename )
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    filename_ = filename;
+    origin_ = steady_clock::now();
+    events_.clear();
+    threads_.clear();
+    threads_.push_back( std::this_thread::get_id() );
+    enabled_ = true;
+}
+
+/**
+// Get the current time.
+//
+// @return
+//  The time in microseconds since tracing was started.
+*/
+int64_t Tracer::now() const
+{
+    return duration_cast<microseconds>( steady_clock::now() - origin_ ).count();
+}
+
+/**
+// Record a span on the calling thread's track.
+//
+// @param category
+//  The category of the span (assumed to be a string literal).
+//
+// @param name
+//  The name of the span.
+//
+// @param detail
+//  Detail to show with the span or empty for none.
+//
+// @param begin
+//  The time that the span began (see Tracer::now()).
+//
+// @param end
+//  The time that the span ended (see Tracer::now()).
+*/
+void Tracer::span( const char* category, const std::string& name, const std::string& detail, int64_t begin, int64_t end )
+{
+    SWEET_ASSERT( category );
+    SWEET_ASSERT( begin <= end );
+    if ( enabled_ )
+    {
+        std::unique_lock<std::mutex> lock( mutex_ );
+        Event event = { category, name, detail, thread_index(), begin, end };
+        events_.push_back( event );
+    }
+}
+
+/**
+// Write the spans recorded since tracing was started to the file passed to
+// Tracer::start().
+//
+// Spans are written as complete ("X") events with a thread name metadata
+// event for each track.  Recording continues after writing so that a later
+// call writes the whole trace again.
+//
+// @return
+//  True if the trace was written successfully otherwise false.
+*/
+bool Tracer::write()
+{
+    std::unique_lock<std::mutex> lock( mutex_ );
+    if ( filename_.empty() )
+    {
+        return true;
+    }
+
+    FILE* file = fopen( filename_.c_str(), "wb" );
+    if ( !file )
+    {
+        return false;
+    }
+
+    fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file );
+    for ( size_t thread = 0; thread < threads_.size(); ++thread )
+    {
+        char name [32];
+        snprintf( name, sizeof(name), thread == 0 ? "main" : "worker %d", int(thread) );
+        fprintf( file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", int(thread), name );
+    }
+
+    for ( vector<Event>::const_iterator i = events_.begin(); i != events_.end(); ++i )
+    {
+        const Event& event = *i;
+        fputs( "{\"name\":", file );
+        write_string( file, event.name );
+        fprintf( file,
+            ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%" PRId64 ",\"dur\":%" PRId64,
+            event.category, event.thread, event.begin, event.end - event.begin
+        );
+        if ( !event.detail.empty() )
+        {
+            fputs( ",\"args\":{\"detail\":", file );
+            write_string( file, event.detail );
+            fputs( "}", file );
+        }
+        fputs( "},\n", file );
+    }
+
+    // Close with a zero length event so that every other event can be
+    // followed by a comma.
+    fprintf( file, "{\"name\":\"end\",\"cat\":\"forge\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%" PRId64 "}\n]}\n", now() );
+    bool successful = ferror( file ) == 0;
+    successful = fclose( file ) == 0 && successful;
+    return successful;
+}
+
+/**
+// Get the index of the calling thread's track adding a new track the
+// first time that a thread records a span.
+//
+// Assumes that the caller holds the lock on the mutex.
+*/
+int Tracer::thread_index()
+{
+    std::thread::id id = std::this_thread::get_id();
+    for ( size_t i = 0; i < threads_.size(); ++i )
+    {
+        if ( threads_[i] == id )
+        {
+            return int(i);
+        }
+    }
+    threads_.push_back( id );
+    return int(threads_.size()) - 1;
+}
+
+/**
+// Write \e value to \e file as a quoted and escaped JSON string.
+*/
+void Tracer::write_string( FILE* file, const std::string& value )
+{
+    SWEET_ASSERT( file );
+    fputc( '"', file );
+    for ( string::const_iterator i = value.begin(); i != value.end(); ++i )
+    {
+        unsigned char character = static_cast<unsigned char>( *i );
+        if ( character == '"' || character == '\\' )
+        {
+            fputc( '\\', file );
+            fputc( character, file );
+        }
+        else if ( character < 0x20 )
+        {
+            fprintf( file, "\\u%04x", character );
+        }
+        else
+        {
+            fputc( character, file );
+        }
+    }
+    fputc( '"', file );
+}
@@ -0,0 +1,91 @@
+#ifndef FORGE_TRACER_HPP_INCLUDED
+#define FORGE_TRACER_HPP_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+class Target;
+
+/**
+// Record spans of time spent in each phase of a build and write them to a
+// file in the Trace Event Format read by Chrome's about:tracing and
+// Perfetto.
+//
+// Tracing is disabled until `start()` is called.  Spans may be recorded
+// from any thread and each thread is shown on its own track in the order
+// that it first records a span.  The thread that starts tracing is always
+// the first track.
+*/
+class Tracer
+{
+    struct Event
+    {
+        const char* category; ///< The category of the span (assumed to be a string literal).
+        std::string name; ///< The name of the span.
+        std::string detail; ///< Detail shown with the span or empty for none.
+        int thread; ///< The index of the track of the thread that recorded the span.
+        int64_t begin; ///< The time that the span began in microseconds since tracing started.
+        int64_t end; ///< The time that the span ended in microseconds since tracing started.
+    };
+
+    std::atomic<bool> enabled_; ///< True when spans are being recorded.
+    std::string filename_; ///< The file to write the trace to.
+    std::chrono::steady_clock::time_point origin_; ///< The time that tracing started.
+    std::mutex mutex_; ///< The mutex that ensures exclusive access to events and threads.
+    std::vector<Event> events_; ///< The spans recorded since tracing started.
+    std::vector<std::thread::id> threads_; ///< The threads that have recorded spans indexed by track.
+
+public:
+    /**
+    // Record a span from construction to destruction of this object if
+    // tracing is enabled when it is constructed.
+    //
+    // Spans named for or detailed with a Target only look up its path when
+    // tracing is enabled so that untraced builds don't build and cache the
+    // paths of every Target visited.
+    */
+    class Span
+    {
+        Tracer* tracer_; ///< The Tracer to record with or null if tracing was disabled.
+        const char* category_; ///< The category of the span.
+        std::string name_; ///< The name of the span.
+        std::string detail_; ///< Detail shown with the span.
+        int64_t begin_; ///< The time that the span began.
+
+    public:
+        Span( Tracer* tracer, const char* category, const std::string& name, const std::string& detail = std::string() );
+        Span( Tracer* tracer, const char* category, const Target* target );
+        Span( Tracer* tracer, const char* category, const char* name, const Target* target );
+        ~Span();
+    };
+
+    Tracer();
+    bool enabled() const;
+    const std::string& filename() const;
+    void start( const std::string& filename );
+    int64_t now() const;
+    void span( const char* category, const std::string& name, const std::string& detail, int64_t begin, int64_t end );
+    bool write();
+
+private:
+    int thread_index();
+    static void write_string( FILE* file, const std::string& value );
+};
+
+}
+
+}
+
+#endif
@@ -38,6 +38,7 @@ Application::Application( int argc, char** argv )
     std::string directory = boost::filesystem::initial_path<boost::filesystem::path>().generic_string();
     std::string root_directory;
     std::string filename = "forge.lua";
+    std::string bytecode_cache_directory;
     bool stack_trace_enabled = false;    
     std::vector<std::string> assignments_and_commands;
 
@@ -48,6 +49,7 @@ Application::Application( int argc, char** argv )
         ( "version", "v", "Print the version and exit", &version )
         ( "root", "r", "Set the root directory", &root_directory )
         ( "file", "f", "Set the name of the root build script", &filename )
+        ( "bytecode", "b", "Set the directory to cache compiled scripts in", &bytecode_cache_directory )
         ( "stack-trace", "s", "Enable stack traces in error messages", &stack_trace_enabled )
         ( &assignments_and_commands )
     ;
@@ -95,12 +97,18 @@ Application::Application( int argc, char** argv )
         error_policy.error( root_directory.empty(), "The file '%s' could not be found to identify the root directory", filename.c_str() );
     }
 
+    if ( bytecode_cache_directory.empty() && !root_directory.empty() )
+    {
+        bytecode_cache_directory = root_directory + "/.forge.bytecode";
+    }
+
     vector<string>::const_iterator command = commands.begin(); 
     while ( error_policy.errors() == 0 && command != commands.end() )
     {
         Forge forge( directory, error_policy, this );
         forge.set_stack_trace_enabled( stack_trace_enabled );
         forge.set_root_directory( root_directory );
+        forge.set_bytecode_cache_directory( bytecode_cache_directory );
         forge.assign_global_variables( assignments );
         forge.execute( filename, *command );
         ++command;
@@ -0,0 +1,261 @@
+//
+// Benchmark.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <assert/assert.hpp>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using namespace sweet::forge;
+
+static Benchmark* benchmarks_ = nullptr;
+static std::atomic<long long> allocated_( 0 );
+
+/**
+// The size of the header that records the size of each allocation; large 
+// enough to keep the memory returned suitably aligned for any type.
+*/
+static const size_t HEADER_SIZE = sizeof(std::max_align_t) > sizeof(size_t) ? sizeof(std::max_align_t) : sizeof(size_t);
+
+/**
+// Allocate \e size bytes and count them as allocated.
+//
+// @return
+//  The allocated memory or null if the allocation failed.
+*/
+static void* counted_allocate( size_t size )
+{
+    unsigned char* header = (unsigned char*) malloc( HEADER_SIZE + size );
+    if ( !header )
+    {
+        return nullptr;
+    }
+    *(size_t*) header = size;
+    allocated_ += (long long) size;
+    return header + HEADER_SIZE;
+}
+
+/**
+// Free memory allocated by counted_allocate() and count it as freed.
+*/
+static void counted_free( void* pointer )
+{
+    if ( pointer )
+    {
+        unsigned char* header = (unsigned char*) pointer - HEADER_SIZE;
+        allocated_ -= (long long) *(size_t*) header;
+        free( header );
+    }
+}
+
+// Replace the global allocation functions so that Benchmarks are able to
+// measure the memory retained by the operations that they time.
+void* operator new( size_t size )
+{
+    void* pointer = counted_allocate( size );
+    if ( !pointer )
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[]( size_t size )
+{
+    return operator new( size );
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+    return counted_allocate( size );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+    return counted_allocate( size );
+}
+
+void operator delete( void* pointer ) noexcept
+{
+    counted_free( pointer );
+}
+
+void operator delete[]( void* pointer ) noexcept
+{
+    counted_free( pointer );
+}
+
+void operator delete( void* pointer, const std::nothrow_t& ) noexcept
+{
+    counted_free( pointer );
+}
+
+void operator delete[]( void* pointer, const std::nothrow_t& ) noexcept
+{
+    counted_free( pointer );
+}
+
+/**
+// Constructor.
+//
+// @param name
+//  The name of the Benchmark (assumed to be a string literal).
+//
+// @param function
+//  The function to call to run the Benchmark.
+*/
+Benchmark::Benchmark( const char* name, void (*function)(Benchmark& benchmark) )
+: name_( name ),
+  function_( function ),
+  next_( nullptr ),
+  start_(),
+  elapsed_( steady_clock::duration::zero() ),
+  operations_( 0 ),
+  bytes_( 0 ),
+  details_()
+{
+    SWEET_ASSERT( name_ );
+    SWEET_ASSERT( function_ );
+
+    // Append to the list of Benchmarks so that Benchmarks run in the order
+    // that they're defined in within each file.
+    Benchmark** next = &benchmarks_;
+    while ( *next )
+    {
+        next = &(*next)->next_;
+    }
+    *next = this;
+}
+
+/**
+// Get the name of this Benchmark.
+//
+// @return
+//  The name.
+*/
+const char* Benchmark::name() const
+{
+    return name_;
+}
+
+/**
+// Start timing operations.
+*/
+void Benchmark::start()
+{
+    start_ = steady_clock::now();
+}
+
+/**
+// Stop timing operations.
+//
+// @param operations
+//  The number of operations performed since timing was started.
+*/
+void Benchmark::stop( long long operations )
+{
+    elapsed_ += steady_clock::now() - start_;
+    operations_ += operations;
+}
+
+/**
+// Report memory retained by the operations timed.
+//
+// @param bytes
+//  The number of bytes retained, usually the difference between the values
+//  returned from Benchmark::allocated() before and after the operations.
+*/
+void Benchmark::retain( long long bytes )
+{
+    bytes_ += bytes;
+}
+
+/**
+// Report a line of detail, e.g. a breakdown of the time per operation, to
+// be printed after the time and memory per operation.
+//
+// @param format
+//  The printf-style format string.
+*/
+void Benchmark::detail( const char* format, ... )
+{
+    char line [1024];
+    va_list args;
+    va_start( args, format );
+    vsnprintf( line, sizeof(line), format, args );
+    va_end( args );
+    line[sizeof(line) - 1] = 0;
+    details_ += "    ";
+    details_ += line;
+    details_ += "\n";
+}
+
+/**
+// Run this Benchmark and report the average time and memory retained per
+// operation.
+*/
+void Benchmark::run()
+{
+    elapsed_ = steady_clock::duration::zero();
+    operations_ = 0;
+    bytes_ = 0;
+    details_.clear();
+    function_( *this );
+
+    double elapsed = double(duration_cast<nanoseconds>(elapsed_).count());
+    double per_operation = operations_ > 0 ? elapsed / double(operations_) : 0.0;
+    double bytes_per_operation = operations_ > 0 ? double(bytes_) / double(operations_) : 0.0;
+    printf( "%-48s %12lld ops %12.1f ns/op %10.3f s", name_, operations_, per_operation, elapsed / 1e9 );
+    if ( bytes_ != 0 )
+    {
+        printf( " %10.1f B/op", bytes_per_operation );
+    }
+    printf( "\n%s", details_.c_str() );
+    fflush( stdout );
+}
+
+/**
+// Run all Benchmarks.
+//
+// @param filter
+//  Only Benchmarks whose names contain this string are run (null to run all
+//  Benchmarks).
+//
+// @return
+//  The number of Benchmarks run.
+*/
+int Benchmark::run_all( const char* filter )
+{
+    int benchmarks = 0;
+    for ( Benchmark* benchmark = benchmarks_; benchmark; benchmark = benchmark->next_ )
+    {
+        if ( !filter || strstr(benchmark->name(), filter) )
+        {
+            benchmark->run();
+            ++benchmarks;
+        }
+    }
+    return benchmarks;
+}
+
+/**
+// Get the number of bytes currently allocated with `operator new`.
+//
+// @return
+//  The number of bytes allocated and not yet freed.
+*/
+long long Benchmark::allocated()
+{
+    return allocated_;
+}
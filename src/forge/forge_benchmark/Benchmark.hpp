@@ -0,0 +1,62 @@
+#ifndef BENCHMARK_HPP_INCLUDED
+#define BENCHMARK_HPP_INCLUDED
+
+#include <chrono>
+#include <string>
+
+namespace sweet
+{
+
+namespace forge
+{
+
+/**
+// A named benchmark that times a number of repetitions of an operation and
+// reports the average time taken per operation.
+//
+// Benchmarks are defined with the BENCHMARK() macro and register themselves
+// with a global list when they're constructed in the same way that tests
+// are with UnitTest++.
+*/
+class Benchmark
+{
+    const char* name_; ///< The name of this Benchmark.
+    void (*function_)( Benchmark& benchmark ); ///< The function that runs this Benchmark.
+    Benchmark* next_; ///< The next Benchmark in the list of all Benchmarks.
+    std::chrono::steady_clock::time_point start_; ///< The time that timing was last started.
+    std::chrono::steady_clock::duration elapsed_; ///< The total time elapsed while timing.
+    long long operations_; ///< The total number of operations timed.
+    long long bytes_; ///< The total number of bytes of memory retained by the operations timed.
+    std::string details_; ///< Lines of detail reported after the time and memory per operation.
+
+public:
+    Benchmark( const char* name, void (*function)(Benchmark& benchmark) );
+    const char* name() const;
+    void start();
+    void stop( long long operations );
+    void retain( long long bytes );
+    void detail( const char* format, ... );
+    void run();
+    static int run_all( const char* filter );
+    static long long allocated();
+};
+
+}
+
+}
+
+/**
+// Define a Benchmark named \e name.
+//
+// The body that follows is the function that runs the Benchmark.  It has a
+// Benchmark named `benchmark` in scope and brackets the operations it times
+// with calls to `benchmark.start()` and `benchmark.stop( operations )` and
+// optionally reports the memory that those operations retain with 
+// `benchmark.retain( bytes )` (see Benchmark::allocated()).
+*/
+#define BENCHMARK( name ) \
+    static void benchmark_##name( sweet::forge::Benchmark& benchmark ); \
+    static sweet::forge::Benchmark benchmark_##name##_instance( #name, &benchmark_##name ); \
+    static void benchmark_##name( sweet::forge::Benchmark& benchmark )
+
+#endif
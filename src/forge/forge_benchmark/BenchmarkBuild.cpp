@@ -0,0 +1,418 @@
+//
+// BenchmarkBuild.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <forge/Forge.hpp>
+#include <forge/ForgeEventSink.hpp>
+#include <forge/Phases.hpp>
+#include <error/ErrorPolicy.hpp>
+#include <assert/assert.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using std::string;
+using std::vector;
+using namespace boost::filesystem;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const int REPETITIONS = 3;
+
+/**
+// The shape of a synthetic project built with the GCC toolset and the
+// forge_fake_cc stand-in for the compiler, archiver, and linker.
+//
+// The project has `libraries` static libraries linked into one executable.
+// The `sources` sources are spread evenly across the libraries and each
+// library has one header per source.  Each source includes `includes` of
+// its library's headers and every header includes a header shared by the
+// whole project.
+//
+// The shape may be overridden by setting the environment variables
+// FORGE_BENCHMARK_LIBRARIES, FORGE_BENCHMARK_SOURCES, and
+// FORGE_BENCHMARK_INCLUDES.  The time that the stand-in takes for each
+// command is set with FORGE_FAKE_CC_MILLISECONDS and FORGE_FAKE_CC_SPIN
+// (see forge_fake_cc).
+*/
+struct ProjectShape
+{
+    int libraries; ///< The number of static libraries.
+    int sources; ///< The total number of sources.
+    int includes; ///< The number of headers included by each source.
+};
+
+/**
+// Get the value of the environment variable \e name as a positive integer.
+*/
+static int environment_integer( const char* name, int default_value )
+{
+    const char* value = getenv( name );
+    int integer = value ? atoi( value ) : 0;
+    return integer > 0 ? integer : default_value;
+}
+
+/**
+// Get the shape of the synthetic project to benchmark with.
+*/
+static ProjectShape project_shape()
+{
+    ProjectShape shape;
+    shape.libraries = environment_integer( "FORGE_BENCHMARK_LIBRARIES", 10 );
+    shape.sources = environment_integer( "FORGE_BENCHMARK_SOURCES", 200 );
+    shape.includes = environment_integer( "FORGE_BENCHMARK_INCLUDES", 4 );
+    return shape;
+}
+
+/**
+// Report errors from the builds being benchmarked to stderr and discard
+// all other output.
+*/
+class BenchmarkEventSink : public ForgeEventSink
+{
+public:
+    int errors_;
+
+    BenchmarkEventSink()
+    : errors_( 0 )
+    {
+    }
+
+    void forge_error( Forge* /*forge*/, const char* message ) override
+    {
+        SWEET_ASSERT( message );
+        fprintf( stderr, "%s\n", message );
+        ++errors_;
+    }
+};
+
+/**
+// A synthetic project generated into a directory and built with Forge
+// in-process so that the phases of each build can be reported.
+*/
+class SyntheticProject
+{
+    ProjectShape shape_;
+    path directory_;
+    path fake_cc_;
+    string package_path_;
+    double load_milliseconds_;
+    double lua_milliseconds_;
+    double filter_milliseconds_;
+    double save_milliseconds_;
+    double postorder_milliseconds_;
+    long long process_milliseconds_;
+    long long processes_;
+    int builds_;
+
+public:
+    SyntheticProject( const ProjectShape& shape )
+    : shape_( shape ),
+      directory_( initial_path<boost::filesystem::path>() / "forge_benchmark_build" ),
+      fake_cc_(),
+      package_path_(),
+      load_milliseconds_( 0.0 ),
+      lua_milliseconds_( 0.0 ),
+      filter_milliseconds_( 0.0 ),
+      save_milliseconds_( 0.0 ),
+      postorder_milliseconds_( 0.0 ),
+      process_milliseconds_( 0 ),
+      processes_( 0 ),
+      builds_( 0 )
+    {
+        error::ErrorPolicy error_policy;
+        ForgeEventSink event_sink;
+        Forge forge( directory_.parent_path().string(), error_policy, &event_sink );
+        fake_cc_ = forge.executable( "forge_fake_cc" );
+        package_path_ =
+            string( BENCHMARK_DIRECTORY "../lua/?.lua;" ) +
+            string( BENCHMARK_DIRECTORY "../lua/?/init.lua" )
+        ;
+        generate();
+    }
+
+    /**
+    // Build the project and accumulate the breakdown of the time taken.
+    //
+    // @return
+    //  The number of errors reported by the build.
+    */
+    int build()
+    {
+        error::ErrorPolicy error_policy;
+        BenchmarkEventSink event_sink;
+        Forge forge( directory_.string(), error_policy, &event_sink );
+        forge.set_root_directory( directory_.generic_string() );
+        forge.set_package_path( package_path_ );
+        forge.execute( "forge.lua", "build" );
+
+        const vector<Phases::Phase>& phases = forge.phases()->phases();
+        for ( vector<Phases::Phase>::const_iterator i = phases.begin(); i != phases.end(); ++i )
+        {
+            const Phases::Phase& phase = *i;
+            milliseconds( phase.name, "load", &load_milliseconds_, phase.milliseconds );
+            milliseconds( phase.name, "lua", &lua_milliseconds_, phase.milliseconds );
+            milliseconds( phase.name, "filter", &filter_milliseconds_, phase.milliseconds );
+            milliseconds( phase.name, "save_binary", &save_milliseconds_, phase.milliseconds );
+            milliseconds( phase.name, "postorder", &postorder_milliseconds_, phase.milliseconds );
+        }
+
+        const vector<Phases::Counter>& counters = forge.phases()->counters();
+        for ( vector<Phases::Counter>::const_iterator i = counters.begin(); i != counters.end(); ++i )
+        {
+            const Phases::Counter& counter = *i;
+            process_milliseconds_ += counter.name == "process_ms" ? counter.total : 0;
+            processes_ += counter.name == "executed" ? counter.total : 0;
+        }
+
+        ++builds_;
+        return event_sink.errors_ + error_policy.errors();
+    }
+
+    /**
+    // Build the project timing the build with \e benchmark.
+    */
+    void build( Benchmark& benchmark )
+    {
+        benchmark.start();
+        int errors = build();
+        benchmark.stop( 1 );
+        if ( errors > 0 )
+        {
+            fprintf( stderr, "forge_benchmark: Building '%s' failed\n", directory_.string().c_str() );
+        }
+    }
+
+    /**
+    // Set the last write time of the first header of the first library to
+    // a time later than any file written so far.
+    //
+    // Future times are used so that touched headers are always newer than
+    // the objects built from them no matter the resolution of file times.
+    */
+    void touch_header( int touches )
+    {
+        path header = directory_ / "library0" / "header0.hpp";
+        last_write_time( header, time(nullptr) + 60 * (touches + 1) );
+    }
+
+    /**
+    // Report the average time spent in each phase of the builds so far.
+    //
+    // The time spent outside of the Lua, filter, and process times is the
+    // overhead of loading and binding the graph and scheduling on the main
+    // thread.  Process time is summed over all processes so it exceeds the
+    // build time when processes run in parallel.
+    */
+    void report( Benchmark& benchmark ) const
+    {
+        double builds = double(std::max(builds_, 1));
+        benchmark.detail(
+            "per build: load %.1fms, lua %.1fms, filter %.1fms, save %.1fms, postorder %.1fms",
+            load_milliseconds_ / builds,
+            lua_milliseconds_ / builds,
+            filter_milliseconds_ / builds,
+            save_milliseconds_ / builds,
+            postorder_milliseconds_ / builds
+        );
+        benchmark.detail(
+            "%.1f processes per build using %.1fms",
+            double(processes_) / builds,
+            double(process_milliseconds_) / builds
+        );
+    }
+
+    /**
+    // Discard the breakdown of builds so far.
+    */
+    void reset()
+    {
+        load_milliseconds_ = 0.0;
+        lua_milliseconds_ = 0.0;
+        filter_milliseconds_ = 0.0;
+        save_milliseconds_ = 0.0;
+        postorder_milliseconds_ = 0.0;
+        process_milliseconds_ = 0;
+        processes_ = 0;
+        builds_ = 0;
+    }
+
+private:
+    static void milliseconds( const string& name, const char* phase, double* total, double milliseconds )
+    {
+        SWEET_ASSERT( total );
+        if ( name == phase )
+        {
+            *total += milliseconds;
+        }
+    }
+
+    /**
+    // Remove any previously generated project and its outputs and generate
+    // the buildfiles, sources, and headers again.
+    */
+    void generate()
+    {
+        remove_all( directory_ );
+        create_directories( directory_ / "include" );
+
+        write( directory_ / "include" / "common.hpp", "// common.hpp\n" );
+
+        string forge_lua =
+            "-- Generated by forge_benchmark.\n"
+            "local cc = require 'forge.cc' {\n"
+            "    identifier = 'cc_${platform}_${architecture}';\n"
+            "    platform = operating_system();\n"
+            "    bin = root( 'bin' );\n"
+            "    lib = root( 'lib' );\n"
+            "    obj = root( 'obj' );\n"
+            "    include_directories = { root('include') };\n"
+            "    library_directories = { root('lib') };\n"
+            "    architecture = 'x86_64';\n"
+            "    gcc = {\n"
+            "        gcc = '" + fake_cc_.generic_string() + "';\n"
+            "        gxx = '" + fake_cc_.generic_string() + "';\n"
+            "        ar = '" + fake_cc_.generic_string() + "';\n"
+            "        environment = {\n"
+            "            FORGE_FAKE_CC_MILLISECONDS = '" + environment_string("FORGE_FAKE_CC_MILLISECONDS", "10") + "';\n"
+            "            FORGE_FAKE_CC_SPIN = '" + environment_string("FORGE_FAKE_CC_SPIN", "0") + "';\n"
+            "        };\n"
+            "    };\n"
+            "};\n"
+        ;
+
+        string libraries;
+        string alls;
+        int libraries_count = std::max( shape_.libraries, 1 );
+        int sources_per_library = std::max( shape_.sources / libraries_count, 1 );
+        char buffer [256];
+        for ( int library = 0; library < libraries_count; ++library )
+        {
+            snprintf( buffer, sizeof(buffer), "library%d", library );
+            string name( buffer );
+            create_directories( directory_ / name );
+
+            string sources;
+            for ( int source = 0; source < sources_per_library; ++source )
+            {
+                snprintf( buffer, sizeof(buffer), "header%d.hpp", source );
+                write( directory_ / name / buffer, "#include \"common.hpp\"\n" );
+
+                string includes;
+                for ( int include = 0; include < shape_.includes; ++include )
+                {
+                    snprintf( buffer, sizeof(buffer), "#include \"header%d.hpp\"\n", (source + include) % sources_per_library );
+                    includes += buffer;
+                }
+                snprintf( buffer, sizeof(buffer), "source%d.cpp", source );
+                write( directory_ / name / buffer, includes );
+                sources += string( "                '" ) + buffer + "';\n";
+            }
+
+            write( directory_ / name / (name + ".forge"),
+                "for _, cc in toolsets('cc.*') do\n"
+                "    cc:all {\n"
+                "        cc:StaticLibrary '${lib}/" + name + "' {\n"
+                "            cc:Cxx '${obj}/%1' {\n" +
+                sources +
+                "            };\n"
+                "        };\n"
+                "    };\n"
+                "end\n"
+            );
+            forge_lua += "buildfile '" + name + "/" + name + ".forge';\n";
+            libraries += "            '${lib}/" + name + "';\n";
+            alls += "    '" + name + "/all';\n";
+        }
+
+        create_directories( directory_ / "executable" );
+        write( directory_ / "executable" / "main.cpp", "#include \"common.hpp\"\n" );
+        write( directory_ / "executable" / "executable.forge",
+            "for _, cc in toolsets('cc.*') do\n"
+            "    cc:all {\n"
+            "        cc:Executable '${bin}/executable' {\n" +
+            libraries +
+            "            cc:Cxx '${obj}/%1' {\n"
+            "                'main.cpp';\n"
+            "            };\n"
+            "        };\n"
+            "    };\n"
+            "end\n"
+        );
+        forge_lua += "buildfile 'executable/executable.forge';\n";
+        forge_lua += "cc:all {\n" + alls + "    'executable/all';\n};\n";
+        write( directory_ / "forge.lua", forge_lua );
+    }
+
+    static string environment_string( const char* name, const char* default_value )
+    {
+        const char* value = getenv( name );
+        return string( value ? value : default_value );
+    }
+
+    static void write( const path& filename, const string& content )
+    {
+        FILE* file = fopen( filename.string().c_str(), "wb" );
+        SWEET_ASSERT( file );
+        if ( file )
+        {
+            fwrite( content.c_str(), 1, content.size(), file );
+            fclose( file );
+        }
+    }
+};
+
+/**
+// Time building the whole project from scratch.
+*/
+BENCHMARK( build_full )
+{
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        SyntheticProject project( project_shape() );
+        project.build( benchmark );
+        if ( i == REPETITIONS - 1 )
+        {
+            project.report( benchmark );
+        }
+    }
+}
+
+/**
+// Time building the project when nothing has changed.
+*/
+BENCHMARK( build_noop )
+{
+    SyntheticProject project( project_shape() );
+    project.build();
+    project.reset();
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        project.build( benchmark );
+    }
+    project.report( benchmark );
+}
+
+/**
+// Time building the project after touching a single header.
+*/
+BENCHMARK( build_touch_header )
+{
+    SyntheticProject project( project_shape() );
+    project.build();
+    project.reset();
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        project.touch_header( i );
+        project.build( benchmark );
+    }
+    project.report( benchmark );
+}
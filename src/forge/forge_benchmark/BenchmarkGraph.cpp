@@ -0,0 +1,377 @@
+//
+// BenchmarkGraph.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <forge/Forge.hpp>
+#include <forge/ForgeEventSink.hpp>
+#include <forge/Graph.hpp>
+#include <forge/GraphReader.hpp>
+#include <forge/GraphWriter.hpp>
+#include <forge/Scheduler.hpp>
+#include <forge/Target.hpp>
+#include <error/ErrorPolicy.hpp>
+#include <assert/assert.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <lua.hpp>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using namespace boost::filesystem;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const int REPETITIONS = 5;
+
+/**
+// The shape of a synthetic dependency graph.
+//
+// Targets are arranged in `depth` levels of `width` targets each.  Targets
+// in the first level stand in for source files that each implicitly depend
+// on `headers` targets chosen from a pool of `width` headers.  Targets in
+// each later level stand in for objects, libraries, and executables that
+// each explicitly depend on `fan_in` targets from the level before.  A
+// single "all" target depends on every target in the last level.
+//
+// The shape may be overridden by setting the environment variables
+// FORGE_BENCHMARK_WIDTH, FORGE_BENCHMARK_DEPTH, FORGE_BENCHMARK_FAN_IN, and
+// FORGE_BENCHMARK_HEADERS.
+*/
+struct GraphShape
+{
+    int width; ///< The number of targets in each level.
+    int depth; ///< The number of levels.
+    int fan_in; ///< The number of explicit dependencies of each target after the first level.
+    int headers; ///< The number of implicit dependencies of each target in the first level.
+};
+
+/**
+// Get the value of the environment variable \e name as a positive integer.
+//
+// @return
+//  The value of the environment variable or \e default_value if it isn't set
+//  or isn't a positive integer.
+*/
+static int environment_integer( const char* name, int default_value )
+{
+    const char* value = getenv( name );
+    int integer = value ? atoi( value ) : 0;
+    return integer > 0 ? integer : default_value;
+}
+
+/**
+// Get the shape of the synthetic graphs to benchmark with.
+*/
+static GraphShape graph_shape()
+{
+    GraphShape shape;
+    shape.width = environment_integer( "FORGE_BENCHMARK_WIDTH", 1000 );
+    shape.depth = environment_integer( "FORGE_BENCHMARK_DEPTH", 8 );
+    shape.fan_in = environment_integer( "FORGE_BENCHMARK_FAN_IN", 4 );
+    shape.headers = environment_integer( "FORGE_BENCHMARK_HEADERS", 16 );
+    return shape;
+}
+
+/**
+// A synthetic dependency graph generated in a Forge's Graph.
+//
+// The identifiers of all of the targets are generated up front so that
+// timing adding them to the Graph doesn't include formatting them.  The
+// targets are bound to files that don't exist so that binding checks the
+// file system in the same way that a clean build does.
+*/
+class SyntheticGraph
+{
+    error::ErrorPolicy error_policy_;
+    ForgeEventSink event_sink_;
+    unique_ptr<Forge> forge_;
+    GraphShape shape_;
+    vector<string> ids_;
+    vector<Target*> targets_;
+    Target* all_;
+
+public:
+    SyntheticGraph( const GraphShape& shape )
+    : error_policy_(),
+      event_sink_(),
+      forge_(),
+      shape_( shape ),
+      ids_(),
+      targets_(),
+      all_( nullptr )
+    {
+        path path = initial_path<boost::filesystem::path>();
+        forge_.reset( new Forge(path.string(), error_policy_, &event_sink_) );
+        forge_->set_root_directory( path.generic_string() );
+
+        string directory = path.generic_string() + "/forge_benchmark";
+        char id [256];
+        for ( int i = 0; i < shape_.width; ++i )
+        {
+            snprintf( id, sizeof(id), "%s/include/header%d.hpp", directory.c_str(), i );
+            ids_.push_back( id );
+        }
+        for ( int level = 0; level < shape_.depth; ++level )
+        {
+            for ( int i = 0; i < shape_.width; ++i )
+            {
+                snprintf( id, sizeof(id), "%s/level%d/target%d", directory.c_str(), level, i );
+                ids_.push_back( id );
+            }
+        }
+        ids_.push_back( directory + "/all" );
+    }
+
+    Forge* forge() const
+    {
+        return forge_.get();
+    }
+
+    Graph* graph() const
+    {
+        return forge_->graph();
+    }
+
+    Target* all() const
+    {
+        return all_;
+    }
+
+    int targets() const
+    {
+        return int(ids_.size());
+    }
+
+    /**
+    // Add the targets to the Graph timing only the calls to
+    // Graph::add_or_find_target() if \e benchmark is not null.
+    */
+    void add_targets( Benchmark* benchmark )
+    {
+        targets_.clear();
+        targets_.reserve( ids_.size() );
+        if ( benchmark )
+        {
+            benchmark->start();
+        }
+        Graph* graph = forge_->graph();
+        for ( vector<string>::const_iterator i = ids_.begin(); i != ids_.end(); ++i )
+        {
+            targets_.push_back( graph->add_or_find_target(*i) );
+        }
+        if ( benchmark )
+        {
+            benchmark->stop( targets_.size() );
+        }
+    }
+
+    /**
+    // Bind the targets to files and add the dependencies between them.
+    */
+    void add_dependencies()
+    {
+        SWEET_ASSERT( targets_.size() == ids_.size() );
+        const int width = shape_.width;
+        for ( size_t i = 0; i < targets_.size() - 1; ++i )
+        {
+            targets_[i]->set_filename( ids_[i], 0 );
+        }
+
+        // Dependencies are chosen with a multiplicative hash of each
+        // target's index so that they're scattered across the level below
+        // but the same from run to run.
+        for ( int i = 0; i < width; ++i )
+        {
+            Target* source = targets_[width + i];
+            for ( int j = 0; j < shape_.headers; ++j )
+            {
+                source->add_implicit_dependency( targets_[(i * 2654435761u + j * 40503u) % width] );
+            }
+        }
+
+        for ( int level = 1; level < shape_.depth; ++level )
+        {
+            Target** dependencies = &targets_[level * width];
+            Target** targets = &targets_[(level + 1) * width];
+            for ( int i = 0; i < width; ++i )
+            {
+                for ( int j = 0; j < shape_.fan_in; ++j )
+                {
+                    targets[i]->add_explicit_dependency( dependencies[(i * 2654435761u + j * 40503u) % width] );
+                }
+            }
+        }
+
+        all_ = targets_.back();
+        Target** last_level = &targets_[shape_.depth * width];
+        for ( int i = 0; i < width; ++i )
+        {
+            all_->add_explicit_dependency( last_level[i] );
+        }
+    }
+
+    /**
+    // Generate the whole graph.
+    */
+    void generate()
+    {
+        add_targets( nullptr );
+        add_dependencies();
+    }
+};
+
+/**
+// Time adding targets to an empty graph and report the memory used by each
+// target once its dependencies are added.
+*/
+BENCHMARK( graph_add_or_find_target )
+{
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        SyntheticGraph graph( graph_shape() );
+        long long allocated = Benchmark::allocated();
+        graph.add_targets( &benchmark );
+        graph.add_dependencies();
+        benchmark.retain( Benchmark::allocated() - allocated );
+    }
+}
+
+/**
+// Time finding targets that already exist in the graph.
+*/
+BENCHMARK( graph_add_or_find_existing_target )
+{
+    SyntheticGraph graph( graph_shape() );
+    graph.generate();
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        graph.add_targets( &benchmark );
+    }
+}
+
+/**
+// Time binding every target in the graph to its file and dependencies.
+*/
+BENCHMARK( graph_bind )
+{
+    SyntheticGraph graph( graph_shape() );
+    graph.generate();
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        benchmark.start();
+        graph.graph()->bind( graph.all() );
+        benchmark.stop( graph.targets() );
+    }
+}
+
+/**
+// Time a postorder traversal of every target in the graph that visits each
+// target with a function that does nothing.
+*/
+BENCHMARK( scheduler_postorder_noop )
+{
+    SyntheticGraph graph( graph_shape() );
+    graph.generate();
+    graph.graph()->bind( graph.all() );
+
+    lua_State* lua_state = graph.forge()->lua_state();
+    luaL_dostring( lua_state, "return function() end" );
+    int function = luaL_ref( lua_state, LUA_REGISTRYINDEX );
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        benchmark.start();
+        graph.forge()->scheduler()->postorder( graph.all(), function );
+        benchmark.stop( graph.targets() );
+    }
+    luaL_unref( lua_state, LUA_REGISTRYINDEX, function );
+}
+
+/**
+// Time writing the graph to its binary format in memory and report the
+// size of the binary format per target.
+*/
+BENCHMARK( graph_writer_write )
+{
+    SyntheticGraph graph( graph_shape() );
+    graph.generate();
+    graph.graph()->bind( graph.all() );
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        std::ostringstream stream;
+        GraphWriter writer( &stream );
+        benchmark.start();
+        writer.write( graph.graph()->root_target() );
+        benchmark.stop( graph.targets() );
+        benchmark.retain( (long long) stream.tellp() );
+    }
+}
+
+/**
+// Time reading the graph from its binary format in memory and report the
+// memory used by each target read.
+*/
+BENCHMARK( graph_reader_read )
+{
+    SyntheticGraph graph( graph_shape() );
+    graph.generate();
+    graph.graph()->bind( graph.all() );
+    std::ostringstream ostream;
+    GraphWriter writer( &ostream );
+    writer.write( graph.graph()->root_target() );
+    string data = ostream.str();
+
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        std::istringstream istream( data );
+        GraphReader reader( &istream, &graph.forge()->error_policy() );
+        long long allocated = Benchmark::allocated();
+        benchmark.start();
+        unique_ptr<Target> root_target = reader.read( "forge_benchmark.graph" );
+        benchmark.stop( graph.targets() );
+        benchmark.retain( Benchmark::allocated() - allocated );
+        SWEET_ASSERT( root_target );
+    }
+}
+
+/**
+// Time clearing the dependencies of every target in the graph as is done
+// before buildfiles are reloaded.
+*/
+BENCHMARK( graph_clear )
+{
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        SyntheticGraph graph( graph_shape() );
+        graph.generate();
+        benchmark.start();
+        graph.graph()->clear();
+        benchmark.stop( graph.targets() );
+    }
+}
+
+/**
+// Time destroying every target in the graph.
+*/
+BENCHMARK( graph_destroy )
+{
+    for ( int i = 0; i < REPETITIONS; ++i )
+    {
+        SyntheticGraph graph( graph_shape() );
+        graph.generate();
+        unique_ptr<Graph> discarded( new Graph(graph.forge()) );
+        discarded->swap( *graph.graph() );
+        benchmark.start();
+        discarded.reset();
+        benchmark.stop( graph.targets() );
+    }
+}
@@ -0,0 +1,112 @@
+//
+// BenchmarkLuaTarget.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <forge/Forge.hpp>
+#include <forge/ForgeEventSink.hpp>
+#include <error/ErrorPolicy.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <stdio.h>
+
+using std::string;
+using namespace boost::filesystem;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const int METHOD_CALLS = 1000000;
+static const int TARGETS = 100000;
+
+/**
+// Settings similar to those of a C++ toolset; a table with nested tables 
+// that inherits from another table with nested tables.
+*/
+static const char* SETTINGS = 
+    "local defaults = { \n"
+    "    platform = 'linux'; architecture = 'x86_64'; variant = 'debug'; \n"
+    "    bin = '/bin'; lib = '/lib'; obj = '/obj'; \n"
+    "    debug = true; optimization = false; warning_level = 3; \n"
+    "    defines = { 'BUILD_OS_LINUX', 'BUILD_VARIANT_DEBUG', 'BUILD_VERSION=1' }; \n"
+    "    include_directories = { '/src', '/src/boost', '/src/lua/src' }; \n"
+    "    cc = { gcc = '/usr/bin/gcc'; gxx = '/usr/bin/g++'; ar = '/usr/bin/ar' }; \n"
+    "}; \n"
+    "forge.settings = setmetatable( { \n"
+    "    warning_level = 0; \n"
+    "    libraries = { 'pthread', 'dl' }; \n"
+    "}, {__index = defaults} ); \n"
+;
+
+/**
+// Create TARGETS targets from `forge` after running \e setup.
+*/
+static void create_targets( Benchmark& benchmark, const char* setup )
+{
+    error::ErrorPolicy error_policy;
+    ForgeEventSink event_sink;
+    path path = initial_path<boost::filesystem::path>();
+    Forge forge( path.string(), error_policy, &event_sink );
+    forge.set_root_directory( path.generic_string() );
+    forge.script( string(setup) );
+
+    char script [256];
+    snprintf( script, sizeof(script),
+        "for i = 1, %d do \n"
+        "    Target( forge, 'benchmark'..i ); \n"
+        "end \n",
+        TARGETS
+    );
+    benchmark.start();
+    forge.script( string(script) );
+    benchmark.stop( TARGETS );
+}
+
+/**
+// Time calls from Lua to methods on a Target that each convert the Target
+// back to its C++ object (see luaxx_to()).
+*/
+BENCHMARK( lua_target_method_dispatch )
+{
+    error::ErrorPolicy error_policy;
+    ForgeEventSink event_sink;
+    path path = initial_path<boost::filesystem::path>();
+    Forge forge( path.string(), error_policy, &event_sink );
+    forge.set_root_directory( path.generic_string() );
+    forge.script( 
+        "benchmark_target = Target( forge, 'benchmark.cpp' ); \n"
+        "benchmark_target:set_filename( benchmark_target:path() ); \n"
+    );
+
+    char script [256];
+    snprintf( script, sizeof(script),
+        "local target = benchmark_target; \n"
+        "for i = 1, %d do \n"
+        "    target:id(); \n"
+        "    target:filename(); \n"
+        "    target:dependency(); \n"
+        "end \n",
+        METHOD_CALLS
+    );
+    benchmark.start();
+    forge.script( string(script) );
+    benchmark.stop( 3 * METHOD_CALLS );
+}
+
+/**
+// Time creating targets without settings to hash.
+*/
+BENCHMARK( create_targets_without_settings )
+{
+    create_targets( benchmark, "forge.settings = nil;" );
+}
+
+/**
+// Time creating targets whose settings are hashed (see 
+// LuaSystem::hash_settings()).
+*/
+BENCHMARK( create_targets_with_settings )
+{
+    create_targets( benchmark, SETTINGS );
+}
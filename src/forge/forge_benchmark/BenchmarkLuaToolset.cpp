@@ -0,0 +1,60 @@
+//
+// BenchmarkLuaToolset.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <forge/Forge.hpp>
+#include <forge/ForgeEventSink.hpp>
+#include <error/ErrorPolicy.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <stdio.h>
+
+using std::string;
+using namespace boost::filesystem;
+using namespace sweet;
+using namespace sweet::forge;
+
+static const int INTERPOLATIONS = 100000;
+
+/**
+// Time interpolating templates like those used to create targets with the
+// C++ toolsets (see LuaToolset::interpolate()).
+*/
+BENCHMARK( toolset_interpolate )
+{
+    error::ErrorPolicy error_policy;
+    ForgeEventSink event_sink;
+    path path = initial_path<boost::filesystem::path>();
+    Forge forge( path.string(), error_policy, &event_sink );
+    forge.set_root_directory( path.generic_string() );
+    forge.script( 
+        "benchmark_toolset = setmetatable( { \n"
+        "    settings = { \n"
+        "        platform = 'linux'; architecture = 'x86_64'; variant = 'debug'; \n"
+        "        bin = '/bin'; lib = '/lib'; obj = '/obj/${variant}'; \n"
+        "    }; \n"
+        "}, {__index = Toolset} ); \n"
+        "benchmark_templates = { \n"
+        "    '${obj}/%1'; \n"
+        "    '${lib}/forge_${architecture}'; \n"
+        "    '${bin}/forge'; \n"
+        "    'main.cpp'; \n"
+        "}; \n"
+    );
+
+    char script [512];
+    snprintf( script, sizeof(script),
+        "local toolset = benchmark_toolset; \n"
+        "local templates = benchmark_templates; \n"
+        "for i = 1, %d do \n"
+        "    toolset:interpolate( templates[i %% #templates + 1] ); \n"
+        "end \n",
+        INTERPOLATIONS
+    );
+    benchmark.start();
+    forge.script( string(script) );
+    benchmark.stop( INTERPOLATIONS );
+}
@@ -0,0 +1,16 @@
+//
+// main.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "Benchmark.hpp"
+#include <stdlib.h>
+
+using namespace sweet::forge;
+
+int main( int argc, char** argv )
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    return Benchmark::run_all( filter ) > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
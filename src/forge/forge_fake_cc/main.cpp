@@ -0,0 +1,269 @@
+//
+// main.cpp
+// Copyright (c) Charles Baker.  All rights reserved.
+//
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(BUILD_OS_WINDOWS)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::set;
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+/**
+// A stand-in for the compiler, archiver, and linker used by the GCC toolset
+// so that builds can be benchmarked without the time spent in real tools.
+//
+// Invoked as `gcc` or `g++` the input files are read and, when compiling
+// with `-c`, so are the files that they `#include "..."` found relative to
+// the including file or in the directories passed with `-I` so that the
+// build hooks report them as implicit dependencies.  Invoked as `ar` the
+// second argument is the output and the remaining arguments are inputs.
+//
+// Files are read with `open()` rather than `fopen()` on POSIX systems as the
+// build hooks only intercept calls to `open()` and the C library opens files
+// for `fopen()` without calling it.
+//
+// Each invocation then sleeps, or burns CPU if FORGE_FAKE_CC_SPIN is set to
+// a non-zero value, for FORGE_FAKE_CC_MILLISECONDS milliseconds (default
+// 10) before writing the names of its inputs to its output file.
+*/
+class FakeCompiler
+{
+    vector<string> include_directories_;
+    vector<string> inputs_;
+    set<string> read_;
+    string output_;
+    bool compile_;
+
+public:
+    FakeCompiler()
+    : include_directories_(),
+      inputs_(),
+      read_(),
+      output_(),
+      compile_( false )
+    {
+    }
+
+    bool parse( int argc, char** argv )
+    {
+        const char* command = argc > 0 ? leaf( argv[0] ) : "";
+        if ( strcmp(command, "ar") == 0 )
+        {
+            if ( argc < 3 )
+            {
+                return false;
+            }
+            output_ = argv[2];
+            inputs_.assign( argv + 3, argv + argc );
+            return true;
+        }
+
+        for ( int i = 1; i < argc; ++i )
+        {
+            const char* argument = argv[i];
+            if ( strcmp(argument, "-o") == 0 && i + 1 < argc )
+            {
+                output_ = argv[++i];
+            }
+            else if ( strcmp(argument, "-c") == 0 )
+            {
+                compile_ = true;
+            }
+            else if ( strncmp(argument, "-I", 2) == 0 )
+            {
+                const char* directory = argument[2] ? argument + 2 : (i + 1 < argc ? argv[++i] : "");
+                include_directories_.push_back( directory );
+            }
+            else if ( strcmp(argument, "-MF") == 0 || strcmp(argument, "-MT") == 0 || strcmp(argument, "-x") == 0 || strcmp(argument, "-L") == 0 )
+            {
+                ++i;
+            }
+            else if ( argument[0] != '-' )
+            {
+                inputs_.push_back( argument );
+            }
+        }
+        return !output_.empty();
+    }
+
+    bool read_inputs()
+    {
+        for ( vector<string>::const_iterator i = inputs_.begin(); i != inputs_.end(); ++i )
+        {
+            if ( !read(*i) )
+            {
+                fprintf( stderr, "forge_fake_cc: Reading '%s' failed\n", i->c_str() );
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void work() const
+    {
+        const char* value = getenv( "FORGE_FAKE_CC_MILLISECONDS" );
+        int duration = value ? atoi( value ) : 10;
+        const char* spin = getenv( "FORGE_FAKE_CC_SPIN" );
+        if ( spin && atoi(spin) != 0 )
+        {
+            volatile unsigned int hash = 2166136261u;
+            steady_clock::time_point finish = steady_clock::now() + milliseconds( duration );
+            while ( steady_clock::now() < finish )
+            {
+                for ( int i = 0; i < 1024; ++i )
+                {
+                    hash = (hash ^ i) * 16777619u;
+                }
+            }
+        }
+        else if ( duration > 0 )
+        {
+            std::this_thread::sleep_for( milliseconds(duration) );
+        }
+    }
+
+    bool write_output() const
+    {
+        FILE* file = fopen( output_.c_str(), "wb" );
+        if ( !file )
+        {
+            fprintf( stderr, "forge_fake_cc: Opening '%s' to write failed\n", output_.c_str() );
+            return false;
+        }
+        for ( vector<string>::const_iterator i = inputs_.begin(); i != inputs_.end(); ++i )
+        {
+            fprintf( file, "%s\n", i->c_str() );
+        }
+        return fclose( file ) == 0;
+    }
+
+private:
+    bool read( const string& filename )
+    {
+        if ( read_.find(filename) != read_.end() )
+        {
+            return true;
+        }
+
+        string content;
+        if ( !read_file(filename, &content) )
+        {
+            return false;
+        }
+        read_.insert( filename );
+
+        vector<string> includes;
+        const char* INCLUDE = "#include \"";
+        string::size_type position = 0;
+        while ( compile_ && position < content.size() )
+        {
+            string::size_type end_of_line = content.find( '\n', position );
+            end_of_line = end_of_line != string::npos ? end_of_line : content.size();
+            if ( content.compare(position, strlen(INCLUDE), INCLUDE) == 0 )
+            {
+                string::size_type begin = position + strlen( INCLUDE );
+                string::size_type end = content.find( '"', begin );
+                if ( end != string::npos && end < end_of_line )
+                {
+                    includes.push_back( content.substr(begin, end - begin) );
+                }
+            }
+            position = end_of_line + 1;
+        }
+
+        string directory = branch( filename );
+        for ( vector<string>::const_iterator i = includes.begin(); i != includes.end(); ++i )
+        {
+            bool found = read( directory + *i );
+            for ( vector<string>::const_iterator j = include_directories_.begin(); j != include_directories_.end() && !found; ++j )
+            {
+                found = read( *j + "/" + *i );
+            }
+            if ( !found )
+            {
+                fprintf( stderr, "forge_fake_cc: Including '%s' from '%s' failed\n", i->c_str(), filename.c_str() );
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool read_file( const string& filename, string* content )
+    {
+        char buffer [4096];
+#if defined(BUILD_OS_WINDOWS)
+        int fd = _open( filename.c_str(), _O_RDONLY | _O_BINARY );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        int bytes = 0;
+        while ( (bytes = _read(fd, buffer, sizeof(buffer))) > 0 )
+        {
+            content->append( buffer, bytes );
+        }
+        _close( fd );
+#else
+        int fd = ::open( filename.c_str(), O_RDONLY );
+        if ( fd < 0 )
+        {
+            return false;
+        }
+        ssize_t bytes = 0;
+        while ( (bytes = ::read(fd, buffer, sizeof(buffer))) > 0 )
+        {
+            content->append( buffer, bytes );
+        }
+        ::close( fd );
+#endif
+        return bytes == 0;
+    }
+
+    static const char* leaf( const char* path )
+    {
+        const char* slash = strrchr( path, '/' );
+        return slash ? slash + 1 : path;
+    }
+
+    static string branch( const string& path )
+    {
+        string::size_type slash = path.rfind( '/' );
+        return slash != string::npos ? path.substr( 0, slash + 1 ) : string();
+    }
+};
+
+int main( int argc, char** argv )
+{
+    FakeCompiler fake_compiler;
+    if ( !fake_compiler.parse(argc, argv) )
+    {
+        fprintf( stderr, "Usage: gcc|g++ [-c] [-I directory] -o output input ...\n" );
+        fprintf( stderr, "       ar flags output input ...\n" );
+        return EXIT_FAILURE;
+    }
+
+    if ( !fake_compiler.read_inputs() )
+    {
+        return EXIT_FAILURE;
+    }
+
+    fake_compiler.work();
+    return fake_compiler.write_output() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
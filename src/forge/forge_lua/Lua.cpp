@@ -14,7 +14,9 @@
 #include "LuaToolset.hpp"
 #include "types.hpp"
 #include <forge/Forge.hpp>
+#include <forge/BytecodeCache.hpp>
 #include <luaxx/luaxx.hpp>
+#include <luaxx/LuaAllocator.hpp>
 #include <assert/assert.hpp>
 #include <string>
 
@@ -24,8 +26,42 @@ using namespace sweet;
 using namespace sweet::luaxx;
 using namespace sweet::forge;
 
+/**
+// Find and load a Lua module on `package.path` through the BytecodeCache.
+//
+// Replaces the standard Lua searcher for Lua modules so that modules are 
+// loaded from their cached bytecode while it is valid.
+*/
+static int search_lua_module( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* name = luaL_checkstring( lua_state, NAME );
+
+    lua_getglobal( lua_state, "package" );
+    lua_getfield( lua_state, -1, "searchpath" );
+    lua_pushvalue( lua_state, NAME );
+    lua_getfield( lua_state, -3, "path" );
+    lua_call( lua_state, 2, 2 );
+    const char* filename = lua_tostring( lua_state, -2 );
+    if ( !filename )
+    {
+        return 1;
+    }
+
+    int result = forge->bytecode_cache()->load( lua_state, filename );
+    if ( result != LUA_OK )
+    {
+        return luaL_error( lua_state, "error loading module '%s' from file '%s':\n\t%s", name, filename, lua_tostring(lua_state, -1) );
+    }
+    lua_pushstring( lua_state, filename );
+    return 2;
+}
+
 Lua::Lua( Forge* forge )
 : forge_( nullptr ),
+  lua_allocator_( nullptr ),
   lua_state_( nullptr ),
   lua_file_system_( nullptr ),
   lua_context_( nullptr ),
@@ -81,7 +117,8 @@ void Lua::create( Forge* forge )
     destroy();
 
     forge_ = forge;
-    lua_state_ = luaxx_newstate();
+    lua_allocator_ = new LuaAllocator;
+    lua_state_ = luaxx_newstate( lua_allocator_ );
     lua_file_system_ = new LuaFileSystem;
     lua_context_ = new LuaContext;
     lua_graph_ = new LuaGraph;
@@ -99,6 +136,15 @@ void Lua::create( Forge* forge )
     lua_toolset_prototype_->create( lua_state_, forge, lua_toolset_ );
     lua_setglobal( lua_state_, "forge" );
 
+    // Replace the standard Lua searcher, the second entry in 
+    // `package.searchers`, with one that loads through the BytecodeCache.
+    lua_getglobal( lua_state_, "package" );
+    lua_getfield( lua_state_, -1, "searchers" );
+    lua_pushlightuserdata( lua_state_, forge );
+    lua_pushcclosure( lua_state_, &search_lua_module, 1 );
+    lua_rawseti( lua_state_, -2, 2 );
+    lua_pop( lua_state_, 2 );
+
     lua_context_->create( forge, lua_state_ );
     lua_file_system_->create( forge, lua_state_ );
     lua_graph_->create( forge, lua_state_ );
@@ -145,6 +191,9 @@ void Lua::destroy()
         lua_close( lua_state_ );
     }
 
+    delete lua_allocator_;
+    lua_allocator_ = nullptr;
+
     lua_state_ = nullptr;
     forge_ = nullptr;
 }
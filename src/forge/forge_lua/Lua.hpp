@@ -9,6 +9,13 @@ struct lua_State;
 
 namespace sweet
 {
+
+namespace luaxx
+{
+
+class LuaAllocator;
+
+}
     
 namespace forge
 {
@@ -29,6 +36,7 @@ class LuaToolsetPrototype;
 class Lua
 {
     Forge* forge_;
+    luaxx::LuaAllocator* lua_allocator_;
     lua_State* lua_state_;
     LuaFileSystem* lua_file_system_;
     LuaContext* lua_context_;
@@ -4,6 +4,7 @@
 //
 
 #include "LuaGraph.hpp"
+#include "LuaTarget.hpp"
 #include "types.hpp"
 #include <forge/Context.hpp>
 #include <forge/Forge.hpp>
@@ -12,10 +13,12 @@
 #include <forge/Toolset.hpp>
 #include <forge/Target.hpp>
 #include <forge/TargetPrototype.hpp>
+#include <forge/Simulator.hpp>
 #include <luaxx/luaxx.hpp>
 #include <assert/assert.hpp>
 #include <lua.hpp>
 #include <algorithm>
+#include <string.h>
 
 using std::min;
 using std::string;
@@ -54,6 +57,16 @@ void LuaGraph::create( Forge* forge, lua_State* lua_state )
         { "postorder", &LuaGraph::postorder },
         { "print_dependencies", &LuaGraph::print_dependencies },
         { "print_namespace", &LuaGraph::print_namespace },
+        { "print_explanation", &LuaGraph::print_explanation },
+        { "print_usage", &LuaGraph::print_usage },
+        { "print_simulation", &LuaGraph::print_simulation },
+        { "print_stale_targets", &LuaGraph::print_stale_targets },
+        { "remove_stale_targets", &LuaGraph::remove_stale_targets },
+        { "affected_targets", &LuaGraph::affected_targets },
+        { "transitive_libraries", &LuaGraph::transitive_libraries },
+        { "walk_tables", &LuaGraph::walk_tables },
+        { "walk_dependencies", &LuaGraph::walk_dependencies },
+        { "walk_ordering_dependencies", &LuaGraph::walk_ordering_dependencies },
         { "wait", &LuaGraph::wait },
         { "clear", &LuaGraph::clear },
         { "load_binary", &LuaGraph::load_binary },
@@ -277,6 +290,450 @@ int LuaGraph::print_namespace( lua_State* lua_state )
     return 0;
 }
 
+int LuaGraph::print_explanation( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    forge->graph()->print_explanation( target );
+    return 0;
+}
+
+int LuaGraph::print_usage( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    const int COUNT = 2;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    int count = int( luaL_optinteger(lua_state, COUNT, 10) );
+    forge->graph()->print_usage( target, count );
+    return 0;
+}
+
+int LuaGraph::print_simulation( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    const int PROCESSORS = 2;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    if ( !target )
+    {
+        return luaL_argerror( lua_state, TARGET, "expected target" );
+    }
+
+    // Simulate the numbers of processors passed or, by default, powers of 
+    // two up to the maximum number of parallel jobs.
+    vector<int> processors;
+    if ( lua_istable(lua_state, PROCESSORS) )
+    {
+        lua_Integer length = luaL_len( lua_state, PROCESSORS );
+        for ( lua_Integer i = 1; i <= length; ++i )
+        {
+            lua_rawgeti( lua_state, PROCESSORS, i );
+            processors.push_back( int(luaL_checkinteger(lua_state, -1)) );
+            lua_pop( lua_state, 1 );
+        }
+    }
+    else
+    {
+        int maximum_parallel_jobs = forge->maximum_parallel_jobs();
+        for ( int count = 1; count < maximum_parallel_jobs; count *= 2 )
+        {
+            processors.push_back( count );
+        }
+        processors.push_back( maximum_parallel_jobs );
+    }
+
+    Simulator simulator;
+    simulator.load( target );
+    simulator.print( processors );
+    return 0;
+}
+
+int LuaGraph::print_stale_targets( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    int stale_targets = forge->graph()->print_stale_targets();
+    lua_pushinteger( lua_state, stale_targets );
+    return 1;
+}
+
+int LuaGraph::affected_targets( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int PATHS = 1;
+    const int ALL = 2;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    luaL_checktype( lua_state, PATHS, LUA_TTABLE );
+
+    vector<string> paths;
+    lua_Integer length = luaL_len( lua_state, PATHS );
+    for ( lua_Integer i = 1; i <= length; ++i )
+    {
+        lua_rawgeti( lua_state, PATHS, i );
+        const char* path = lua_tostring( lua_state, -1 );
+        if ( path )
+        {
+            paths.push_back( forge->absolute(string(path)).generic_string() );
+        }
+        lua_pop( lua_state, 1 );
+    }
+
+    vector<Target*> targets;
+    bool all = lua_toboolean( lua_state, ALL ) != 0;
+    forge->graph()->affected_targets( paths, all, &targets );
+
+    lua_createtable( lua_state, int(targets.size()), 0 );
+    for ( size_t i = 0; i < targets.size(); ++i )
+    {
+        Target* target = targets[i];
+        if ( !target->referenced_by_script() )
+        {
+            forge->create_target_lua_binding( target );
+        }
+        luaxx_push( lua_state, target );
+        lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+    }
+    return 1;
+}
+
+int LuaGraph::transitive_libraries( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    const int STATIC_LIBRARY = 2;
+    const int DYNAMIC_LIBRARY = 3;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "expected target table" );
+    TargetPrototype* static_library = (TargetPrototype*) luaxx_to( lua_state, STATIC_LIBRARY, TARGET_PROTOTYPE_TYPE );
+    luaL_argcheck( lua_state, static_library != nullptr, STATIC_LIBRARY, "expected target prototype table" );
+    TargetPrototype* dynamic_library = (TargetPrototype*) luaxx_to( lua_state, DYNAMIC_LIBRARY, TARGET_PROTOTYPE_TYPE );
+
+    vector<Target*> libraries;
+    forge->graph()->transitive_libraries( target, static_library, dynamic_library, &libraries );
+
+    lua_createtable( lua_state, int(libraries.size()), 0 );
+    for ( size_t i = 0; i < libraries.size(); ++i )
+    {
+        Target* library = libraries[i];
+        if ( !library->referenced_by_script() )
+        {
+            forge->create_target_lua_binding( library );
+        }
+        luaxx_push( lua_state, library );
+        lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+    }
+    return 1;
+}
+
+/**
+// Continue a walk started by `walk_tables()`.
+//
+// The tables being walked and the index reached in each are kept in the 
+// table that is the first upvalue with the depth of the walk and the index
+// of the last value returned as the second and third upvalues.
+*/
+int LuaGraph::walk_tables_iterator( lua_State* lua_state )
+{
+    const int STACK = lua_upvalueindex( 1 );
+    const int DEPTH = lua_upvalueindex( 2 );
+    const int INDEX = lua_upvalueindex( 3 );
+
+    lua_Integer depth = lua_tointeger( lua_state, DEPTH );
+    while ( depth > 0 )
+    {
+        lua_rawgeti( lua_state, STACK, 2 * depth - 1 );
+        lua_rawgeti( lua_state, STACK, 2 * depth );
+        lua_Integer i = lua_tointeger( lua_state, -1 ) + 1;
+        lua_pop( lua_state, 1 );
+        lua_pushinteger( lua_state, i );
+        lua_rawseti( lua_state, STACK, 2 * depth );
+        lua_geti( lua_state, -1, i );
+        lua_remove( lua_state, -2 );
+
+        int type = lua_type( lua_state, -1 );
+        if ( type == LUA_TNIL )
+        {
+            lua_pop( lua_state, 1 );
+            lua_pushnil( lua_state );
+            lua_rawseti( lua_state, STACK, 2 * depth - 1 );
+            --depth;
+            continue;
+        }
+
+        bool target = false;
+        if ( type == LUA_TTABLE && luaL_getmetafield(lua_state, -1, "__name") != LUA_TNIL )
+        {
+            const char* name = lua_tostring( lua_state, -1 );
+            target = name && strcmp( name, LuaTarget::TARGET_METATABLE ) == 0;
+            lua_pop( lua_state, 1 );
+        }
+
+        if ( type != LUA_TTABLE || target )
+        {
+            lua_Integer index = lua_tointeger( lua_state, INDEX ) + 1;
+            lua_pushinteger( lua_state, index );
+            lua_replace( lua_state, INDEX );
+            lua_pushinteger( lua_state, depth );
+            lua_replace( lua_state, DEPTH );
+            lua_pushinteger( lua_state, index );
+            lua_insert( lua_state, -2 );
+            return 2;
+        }
+
+        ++depth;
+        lua_rawseti( lua_state, STACK, 2 * depth - 1 );
+        lua_pushinteger( lua_state, 0 );
+        lua_rawseti( lua_state, STACK, 2 * depth );
+    }
+
+    lua_pushinteger( lua_state, 0 );
+    lua_replace( lua_state, DEPTH );
+    return 0;
+}
+
+/**
+// Walk the values in a table and recursively in any nested tables that 
+// aren't targets.
+//
+// ~~~lua
+// for index, value in walk_tables( dependencies ) do
+//     ...
+// end
+// ~~~
+//
+// Values are visited in the same order as with nested calls to `ipairs()`.
+// The index returned with each value counts the values returned so far.
+*/
+int LuaGraph::walk_tables( lua_State* lua_state )
+{
+    const int VALUES = 1;
+    luaL_checkany( lua_state, VALUES );
+    lua_createtable( lua_state, 8, 0 );
+    lua_pushvalue( lua_state, VALUES );
+    lua_rawseti( lua_state, -2, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_rawseti( lua_state, -2, 2 );
+    lua_pushinteger( lua_state, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_pushcclosure( lua_state, &LuaGraph::walk_tables_iterator, 3 );
+    return 1;
+}
+
+/**
+// Continue a walk started by `walk_dependencies()` or 
+// `walk_ordering_dependencies()`.
+//
+// The targets being walked and the index of the dependency reached in each
+// are kept in the table that is the second upvalue.  The other upvalues are
+// the Forge, the depth of the walk, the index of the last dependency 
+// returned, the dependency returned last that is still to be considered 
+// for recursion, whether ordering dependencies are walked, and the 
+// optional functions that decide which dependencies to return and which to
+// recurse into.
+//
+// Recursion into a dependency is only considered after it has been 
+// returned and the body of the loop has run in the same way as the 
+// coroutine based implementations that these iterators replace.
+*/
+int LuaGraph::walk_dependencies_iterator( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int STACK = lua_upvalueindex( 2 );
+    const int DEPTH = lua_upvalueindex( 3 );
+    const int INDEX = lua_upvalueindex( 4 );
+    const int PENDING = lua_upvalueindex( 5 );
+    const int ORDERING = lua_upvalueindex( 6 );
+    const int YIELD = lua_upvalueindex( 7 );
+    const int RECURSE = lua_upvalueindex( 8 );
+
+    struct Predicate
+    {
+        static bool call( lua_State* lua_state, int function, Forge* forge, Target* target )
+        {
+            if ( lua_isnil(lua_state, function) )
+            {
+                return true;
+            }
+            if ( !target->referenced_by_script() )
+            {
+                forge->create_target_lua_binding( target );
+            }
+            lua_pushvalue( lua_state, function );
+            luaxx_push( lua_state, target );
+            lua_call( lua_state, 1, 1 );
+            bool result = lua_toboolean( lua_state, -1 ) != 0;
+            lua_pop( lua_state, 1 );
+            return result;
+        }
+    };
+
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    bool ordering = lua_toboolean( lua_state, ORDERING ) != 0;
+    lua_Integer depth = lua_tointeger( lua_state, DEPTH );
+
+    Target* pending = (Target*) lua_touserdata( lua_state, PENDING );
+    if ( pending )
+    {
+        lua_pushnil( lua_state );
+        lua_replace( lua_state, PENDING );
+        bool recurse = ordering ? Predicate::call( lua_state, RECURSE, forge, pending ) : false;
+        if ( recurse )
+        {
+            ++depth;
+            lua_pushlightuserdata( lua_state, pending );
+            lua_rawseti( lua_state, STACK, 2 * depth - 1 );
+            lua_pushinteger( lua_state, 0 );
+            lua_rawseti( lua_state, STACK, 2 * depth );
+        }
+    }
+
+    while ( depth > 0 )
+    {
+        lua_rawgeti( lua_state, STACK, 2 * depth - 1 );
+        Target* target = (Target*) lua_touserdata( lua_state, -1 );
+        lua_pop( lua_state, 1 );
+        lua_rawgeti( lua_state, STACK, 2 * depth );
+        int i = static_cast<int>( lua_tointeger(lua_state, -1) );
+        lua_pop( lua_state, 1 );
+        lua_pushinteger( lua_state, i + 1 );
+        lua_rawseti( lua_state, STACK, 2 * depth );
+
+        Target* dependency = ordering ? target->ordering_dependency( i ) : target->explicit_dependency( i );
+        if ( !dependency )
+        {
+            --depth;
+            continue;
+        }
+
+        bool phony = dependency->filenames().empty() || dependency->filename( 0 ).empty();
+        bool yield = ordering ? Predicate::call( lua_state, YIELD, forge, dependency ) : !phony;
+        if ( yield )
+        {
+            lua_Integer index = lua_tointeger( lua_state, INDEX ) + 1;
+            lua_pushinteger( lua_state, index );
+            lua_replace( lua_state, INDEX );
+            lua_pushinteger( lua_state, depth );
+            lua_replace( lua_state, DEPTH );
+            lua_pushlightuserdata( lua_state, dependency );
+            lua_replace( lua_state, PENDING );
+            if ( !ordering && !phony )
+            {
+                lua_pushnil( lua_state );
+                lua_replace( lua_state, PENDING );
+            }
+            if ( !dependency->referenced_by_script() )
+            {
+                forge->create_target_lua_binding( dependency );
+            }
+            lua_pushinteger( lua_state, index );
+            luaxx_push( lua_state, dependency );
+            return 2;
+        }
+
+        bool recurse = ordering ? Predicate::call( lua_state, RECURSE, forge, dependency ) : phony;
+        if ( recurse )
+        {
+            ++depth;
+            lua_pushlightuserdata( lua_state, dependency );
+            lua_rawseti( lua_state, STACK, 2 * depth - 1 );
+            lua_pushinteger( lua_state, 0 );
+            lua_rawseti( lua_state, STACK, 2 * depth );
+        }
+    }
+
+    lua_pushinteger( lua_state, 0 );
+    lua_replace( lua_state, DEPTH );
+    return 0;
+}
+
+/**
+// Walk the dependencies of a target recursing into dependencies that 
+// aren't bound to files.
+//
+// ~~~lua
+// for index, dependency in walk_dependencies( target ) do
+//     ...
+// end
+// ~~~
+//
+// Only dependencies that are bound to files are returned.
+*/
+int LuaGraph::walk_dependencies( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "expected target table" );
+    lua_pushvalue( lua_state, FORGE );
+    lua_createtable( lua_state, 8, 0 );
+    lua_pushlightuserdata( lua_state, target );
+    lua_rawseti( lua_state, -2, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_rawseti( lua_state, -2, 2 );
+    lua_pushinteger( lua_state, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_pushnil( lua_state );
+    lua_pushboolean( lua_state, 0 );
+    lua_pushnil( lua_state );
+    lua_pushnil( lua_state );
+    lua_pushcclosure( lua_state, &LuaGraph::walk_dependencies_iterator, 8 );
+    return 1;
+}
+
+/**
+// Walk the ordering dependencies of a target.
+//
+// ~~~lua
+// for index, dependency in walk_ordering_dependencies( target, yield, recurse ) do
+//     ...
+// end
+// ~~~
+//
+// The optional functions `yield` and `recurse` are called with each 
+// ordering dependency to decide whether it is returned and whether its own
+// ordering dependencies are walked.  Both default to accepting every 
+// dependency.
+*/
+int LuaGraph::walk_ordering_dependencies( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int TARGET = 1;
+    const int YIELD = 2;
+    const int RECURSE = 3;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "expected target table" );
+    lua_settop( lua_state, RECURSE );
+    lua_pushvalue( lua_state, FORGE );
+    lua_createtable( lua_state, 8, 0 );
+    lua_pushlightuserdata( lua_state, target );
+    lua_rawseti( lua_state, -2, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_rawseti( lua_state, -2, 2 );
+    lua_pushinteger( lua_state, 1 );
+    lua_pushinteger( lua_state, 0 );
+    lua_pushnil( lua_state );
+    lua_pushboolean( lua_state, 1 );
+    lua_pushvalue( lua_state, YIELD );
+    lua_pushvalue( lua_state, RECURSE );
+    lua_pushcclosure( lua_state, &LuaGraph::walk_dependencies_iterator, 8 );
+    return 1;
+}
+
+int LuaGraph::remove_stale_targets( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    int removed = forge->graph()->remove_stale_targets();
+    lua_pushinteger( lua_state, removed );
+    return 1;
+}
+
 int LuaGraph::wait( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -33,6 +33,18 @@ private:
     static int postorder( lua_State* lua_state );
     static int print_dependencies( lua_State* lua_state );
     static int print_namespace( lua_State* lua_state );
+    static int print_explanation( lua_State* lua_state );
+    static int print_usage( lua_State* lua_state );
+    static int print_simulation( lua_State* lua_state );
+    static int print_stale_targets( lua_State* lua_state );
+    static int remove_stale_targets( lua_State* lua_state );
+    static int affected_targets( lua_State* lua_state );
+    static int transitive_libraries( lua_State* lua_state );
+    static int walk_tables_iterator( lua_State* lua_state );
+    static int walk_tables( lua_State* lua_state );
+    static int walk_dependencies_iterator( lua_State* lua_state );
+    static int walk_dependencies( lua_State* lua_state );
+    static int walk_ordering_dependencies( lua_State* lua_state );
     static int wait( lua_State* lua_state );
     static int clear( lua_State* lua_state );
     static int load_binary( lua_State* lua_state );
@@ -6,31 +6,55 @@
 #include "LuaSystem.hpp"
 #include "types.hpp"
 #include <forge/Forge.hpp>
+#include <forge/Context.hpp>
 #include <forge/System.hpp>
+#include <forge/Phases.hpp>
+#include <forge/Statistics.hpp>
 #include <forge/Filter.hpp>
 #include <forge/Arguments.hpp>
 #include <forge/Scheduler.hpp>
+#include <forge/Job.hpp>
+#include <forge/Target.hpp>
 #include <process/Environment.hpp>
+#include <process/Usage.hpp>
 #include <luaxx/luaxx.hpp>
+#include <luaxx/LuaAllocator.hpp>
 #include <assert/assert.hpp>
 #include <lua.hpp>
-#include <meow_hash/meow_intrinsics.h>
-#if defined BUILD_OS_MACOS
-// Ignore unused function warning for 'MeowHash_Accelerated'
-#pragma clang diagnostic ignored "-Wunused-function"
-#endif
-#include <meow_hash/meow_hash.h>
-#include <meow_hash/more/meow_more.h>
-#include <luaxx/luaxx.hpp>
-#include <assert/assert.hpp>
-#include <lua.hpp>
+#include <string.h>
 
 using std::string;
+using std::vector;
 using std::unique_ptr;
 using namespace sweet;
 using namespace sweet::luaxx;
 using namespace sweet::forge;
 
+/**
+// The address used as the registry key of the table of cached hashes.
+*/
+static const char HASHES_KEY = 0;
+
+/**
+// The address used as the registry key of the table of cached hashes of 
+// the settings named by lists of settings keys.
+*/
+static const char SETTINGS_KEYS_HASHES_KEY = 0;
+
+/**
+// Return the next field of a table as `next()` does.
+*/
+static int next_field( lua_State* lua_state )
+{
+    lua_settop( lua_state, 2 );
+    if ( lua_next(lua_state, 1) )
+    {
+        return 2;
+    }
+    lua_pushnil( lua_state );
+    return 1;
+}
+
 LuaSystem::LuaSystem()
 {
 }
@@ -51,11 +75,19 @@ void LuaSystem::create( Forge* forge, lua_State* lua_state )
         { "set_forge_hooks_library", &LuaSystem::set_forge_hooks_library },
         { "forge_hooks_library", &LuaSystem::forge_hooks_library },
         { "hash", &LuaSystem::hash },
+        { "invalidate_hashes", &LuaSystem::invalidate_hashes },
         { "execute", &LuaSystem::execute },
         { "print", &LuaSystem::print },
         { "getenv", &LuaSystem::getenv },
         { "sleep", &LuaSystem::sleep },
         { "ticks", &LuaSystem::ticks },
+        { "begin_phase", &LuaSystem::begin_phase },
+        { "end_phase", &LuaSystem::end_phase },
+        { "add_counter", &LuaSystem::add_counter },
+        { "phases", &LuaSystem::phases },
+        { "counters", &LuaSystem::counters },
+        { "lua_memory", &LuaSystem::lua_memory },
+        { "print_statistics", &LuaSystem::print_statistics },
         { "operating_system", &LuaSystem::operating_system },
         { NULL, NULL }
     };
@@ -69,6 +101,35 @@ void LuaSystem::destroy()
 {
 }
 
+/**
+// Push a table describing the resources used by a process.
+//
+// Times are in milliseconds and peak memory is in bytes.
+//
+// @param lua_state
+//  The Lua state to push the table onto.
+//
+// @param usage
+//  The resources used.
+*/
+void LuaSystem::push_usage( lua_State* lua_state, const process::Usage& usage )
+{
+    SWEET_ASSERT( lua_state );
+    lua_createtable( lua_state, 0, 6 );
+    lua_pushnumber( lua_state, lua_Number(usage.wall_time) / 1000.0 );
+    lua_setfield( lua_state, -2, "wall_time" );
+    lua_pushnumber( lua_state, lua_Number(usage.user_time) / 1000.0 );
+    lua_setfield( lua_state, -2, "user_time" );
+    lua_pushnumber( lua_state, lua_Number(usage.system_time) / 1000.0 );
+    lua_setfield( lua_state, -2, "system_time" );
+    lua_pushinteger( lua_state, lua_Integer(usage.peak_memory) );
+    lua_setfield( lua_state, -2, "peak_memory" );
+    lua_pushinteger( lua_state, lua_Integer(usage.input_blocks) );
+    lua_setfield( lua_state, -2, "input_blocks" );
+    lua_pushinteger( lua_state, lua_Integer(usage.output_blocks) );
+    lua_setfield( lua_state, -2, "output_blocks" );
+}
+
 int LuaSystem::set_forge_hooks_library( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -96,7 +157,7 @@ int LuaSystem::hash( lua_State* lua_state )
     for ( int index = TABLE; index <= args; ++index )
     {
         luaL_checktype( lua_state, index, LUA_TTABLE );
-        hash ^= hash_recursively( lua_state, index, false );
+        hash ^= hash_settings( lua_state, index );
     }
     lua_pushinteger( lua_state, hash );
     return 1;
@@ -117,10 +178,22 @@ int LuaSystem::execute( lua_State* lua_state )
 
         Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
 
+        // A Target that replayed its first command must not execute another
+        // as that command would run against stale output.  Only Targets whose
+        // prototypes build them with a single command replay commands (see
+        // TargetPrototype::single_command()) so this is an error in the
+        // prototype's build function.
+        Job* job = forge->context()->job();
+        if ( job && job->replayed() )
+        {
+            return luaL_error( lua_state, "Target '%s' executed another command after replaying its only command", job->target()->id().c_str() );
+        }
+
         size_t command_line_length = 0;
         const char* command_line = luaL_checklstring( lua_state, COMMAND_LINE, &command_line_length );
 
         unique_ptr<process::Environment> environment;
+        uint64_t environment_hash = 0;
         if ( !lua_isnoneornil(lua_state, ENVIRONMENT) )
         {
             if ( !lua_istable(lua_state, ENVIRONMENT) )
@@ -129,18 +202,48 @@ int LuaSystem::execute( lua_State* lua_state )
                 return lua_error( lua_state );
             }
             
+            // Iterate over the environment as `pairs()` does so that 
+            // environments kept in settings, which hold their fields behind
+            // `__pairs` (see Settings.lua), are seen.
             environment.reset( new process::Environment );
-            lua_pushnil( lua_state );
-            while ( lua_next(lua_state, ENVIRONMENT) )
+            if ( luaL_getmetafield(lua_state, ENVIRONMENT, "__pairs") != LUA_TNIL )
+            {
+                lua_pushvalue( lua_state, ENVIRONMENT );
+                lua_call( lua_state, 1, 3 );
+            }
+            else
+            {
+                lua_pushcfunction( lua_state, &next_field );
+                lua_pushvalue( lua_state, ENVIRONMENT );
+                lua_pushnil( lua_state );
+            }
+            const int ITERATOR = lua_gettop( lua_state ) - 2;
+            const int STATE = ITERATOR + 1;
+            const int KEY = ITERATOR + 2;
+            for ( ;; )
             {
-                if ( lua_isstring(lua_state, -2) )
+                lua_pushvalue( lua_state, ITERATOR );
+                lua_pushvalue( lua_state, STATE );
+                lua_pushvalue( lua_state, KEY );
+                lua_call( lua_state, 2, 2 );
+                if ( lua_isnil(lua_state, -2) )
+                {
+                    lua_pop( lua_state, 2 );
+                    break;
+                }
+                if ( lua_type(lua_state, -2) == LUA_TSTRING )
                 {
                     const char* key = lua_tostring( lua_state, -2 );
                     const char* value = lua_tostring( lua_state, -1 );
                     environment->append( key, value );
+                    uint64_t key_hash = hash_bytes( key, strlen(key), LUA_TSTRING );
+                    uint64_t value_hash = hash_bytes( value, strlen(value), LUA_TSTRING );
+                    environment_hash += mix( key_hash * 0x9e3779b97f4a7c15ull + value_hash );
                 }
                 lua_pop( lua_state, 1 );
+                lua_replace( lua_state, KEY );
             }
+            lua_pop( lua_state, 3 );
         }
 
         unique_ptr<Filter> dependencies_filter;
@@ -197,15 +300,28 @@ int LuaSystem::execute( lua_State* lua_state )
         string command_string( command, command_length );
         string command_line_string( command_line, command_line_length );
 
+        // Fingerprint the command, command line, environment, and working
+        // directory so that a Target rebuilt only because its settings 
+        // changed can replay an identical command rather than execute it 
+        // (see Job::replay()).  The environment is hashed independently of
+        // the order that `lua_next()` visits it in.
+        Context* context = forge->context();
+        string directory = context->directory().generic_string();
+        uint64_t fingerprint = hash_bytes( command, command_length, LUA_TSTRING );
+        fingerprint = mix( fingerprint * 0x9e3779b97f4a7c15ull + hash_bytes(command_line, command_line_length, LUA_TSTRING) );
+        fingerprint = mix( fingerprint * 0x9e3779b97f4a7c15ull + environment_hash );
+        fingerprint = mix( fingerprint * 0x9e3779b97f4a7c15ull + hash_bytes(directory.c_str(), directory.size(), LUA_TSTRING) );
+
         forge->scheduler()->execute(
             command_string,
             command_line_string,
+            fingerprint,
             environment.release(),
             dependencies_filter.release(),
             stdout_filter.release(),
             stderr_filter.release(),
             arguments.release(),
-            forge->context()
+            context
         );
 
         return lua_yield( lua_state, 0 );
@@ -256,11 +372,135 @@ int LuaSystem::ticks( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
     Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
-    float ticks = forge->system()->ticks();
+    double ticks = forge->system()->ticks();
     lua_pushnumber( lua_state, ticks );
     return 1;
 }
 
+int LuaSystem::begin_phase( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    forge->phases()->begin( luaL_checkstring(lua_state, NAME) );
+    return 0;
+}
+
+int LuaSystem::end_phase( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* name = luaL_checkstring( lua_state, NAME );
+    if ( !forge->phases()->end(name) )
+    {
+        return luaL_error( lua_state, "Ending phase '%s' that hasn't begun", name );
+    }
+    return 0;
+}
+
+int LuaSystem::add_counter( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    const int NAME = 1;
+    const int AMOUNT = 2;
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const char* name = luaL_checkstring( lua_state, NAME );
+    lua_Integer amount = luaL_optinteger( lua_state, AMOUNT, 1 );
+    forge->phases()->count( name, int64_t(amount) );
+    return 0;
+}
+
+int LuaSystem::phases( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const vector<Phases::Phase>& phases = forge->phases()->phases();
+    lua_createtable( lua_state, int(phases.size()), 0 );
+    for ( size_t i = 0; i < phases.size(); ++i )
+    {
+        const Phases::Phase& phase = phases[i];
+        lua_createtable( lua_state, 0, 3 );
+        lua_pushlstring( lua_state, phase.name.c_str(), phase.name.size() );
+        lua_setfield( lua_state, -2, "name" );
+        lua_pushnumber( lua_state, phase.milliseconds );
+        lua_setfield( lua_state, -2, "milliseconds" );
+        lua_pushinteger( lua_state, lua_Integer(phase.count) );
+        lua_setfield( lua_state, -2, "count" );
+        lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+    }
+    return 1;
+}
+
+int LuaSystem::counters( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    const vector<Phases::Counter>& counters = forge->phases()->counters();
+    lua_createtable( lua_state, int(counters.size()), 0 );
+    for ( size_t i = 0; i < counters.size(); ++i )
+    {
+        const Phases::Counter& counter = counters[i];
+        lua_createtable( lua_state, 0, 2 );
+        lua_pushlstring( lua_state, counter.name.c_str(), counter.name.size() );
+        lua_setfield( lua_state, -2, "name" );
+        lua_pushinteger( lua_state, lua_Integer(counter.total) );
+        lua_setfield( lua_state, -2, "total" );
+        lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+    }
+    return 1;
+}
+
+int LuaSystem::lua_memory( lua_State* lua_state )
+{
+    void* context = nullptr;
+    lua_Alloc allocate = lua_getallocf( lua_state, &context );
+    if ( allocate != &LuaAllocator::allocate )
+    {
+        return 0;
+    }
+
+    const LuaAllocator* allocator = reinterpret_cast<const LuaAllocator*>( context );
+    SWEET_ASSERT( allocator );
+    lua_createtable( lua_state, 0, 5 );
+    lua_pushinteger( lua_state, lua_Integer(allocator->live_bytes()) );
+    lua_setfield( lua_state, -2, "live" );
+    lua_pushinteger( lua_state, lua_Integer(allocator->peak_bytes()) );
+    lua_setfield( lua_state, -2, "peak" );
+    lua_pushinteger( lua_state, lua_Integer(allocator->reserved_bytes()) );
+    lua_setfield( lua_state, -2, "reserved" );
+    lua_pushinteger( lua_state, lua_Integer(allocator->allocations()) );
+    lua_setfield( lua_state, -2, "allocations" );
+
+    lua_createtable( lua_state, int(LuaAllocator::SIZE_CLASSES), 0 );
+    for ( size_t i = 0; i < LuaAllocator::SIZE_CLASSES; ++i )
+    {
+        const LuaAllocator::SizeClass& size_class = allocator->size_class( i );
+        lua_createtable( lua_state, 0, 4 );
+        lua_pushinteger( lua_state, lua_Integer(size_class.size) );
+        lua_setfield( lua_state, -2, "size" );
+        lua_pushinteger( lua_state, lua_Integer(size_class.live) );
+        lua_setfield( lua_state, -2, "live" );
+        lua_pushinteger( lua_state, lua_Integer(size_class.peak) );
+        lua_setfield( lua_state, -2, "peak" );
+        lua_pushinteger( lua_state, lua_Integer(size_class.allocations) );
+        lua_setfield( lua_state, -2, "allocations" );
+        lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+    }
+    lua_setfield( lua_state, -2, "size_classes" );
+    return 1;
+}
+
+int LuaSystem::print_statistics( lua_State* lua_state )
+{
+    const int FORGE = lua_upvalueindex( 1 );
+    Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
+    Statistics statistics;
+    statistics.collect( forge );
+    statistics.print();
+    return 0;
+}
+
 int LuaSystem::operating_system( lua_State* lua_state )
 {
     const int FORGE = lua_upvalueindex( 1 );
@@ -270,97 +510,304 @@ int LuaSystem::operating_system( lua_State* lua_state )
     return 1;
 }
 
-lua_Integer LuaSystem::hash_recursively( lua_State* lua_state, int table, bool hash_integer_keys )
+/**
+// Calculate the order independent hash of the fields in a settings table.
+//
+// Hashes are cached per table in a weak keyed table in the registry so that
+// creating many targets from the same settings only hashes those settings
+// once.  The cache is discarded by `invalidate_hashes()` whenever any 
+// settings are modified.
+//
+// @param lua_state
+//  The lua_State that the table is in.
+//
+// @param table
+//  The stack index of the table to hash.
+//
+// @return
+//  The hash of the fields in the table, the tables it contains, and the 
+//  tables it inherits from through `__index`.
+*/
+lua_Integer LuaSystem::hash_settings( lua_State* lua_state, int table )
+{
+    SWEET_ASSERT( lua_state );
+    SWEET_ASSERT( lua_istable(lua_state, table) );
+
+    table = lua_absindex( lua_state, table );
+    int hashes = push_hashes( lua_state, &HASHES_KEY );
+    lua_Integer hash = lua_Integer(hash_recursively(lua_state, table, hashes, false, 0));
+    lua_pop( lua_state, 1 );
+    return hash;
+}
+
+/**
+// Calculate the order independent hash of just the fields in a settings 
+// table named by \e keys.
+//
+// Fields are looked up as if read from Lua, including through `__index`,
+// so that the hash covers exactly the values that a build function reading
+// those settings would have seen.  Fields that aren't set contribute to the
+// hash too so that setting them later changes the hash.
+//
+// Hashes are cached per table and list of keys in the same way as hashes of
+// whole settings tables.  Lists of keys are identified by address and so
+// must be interned (see Graph::intern_settings_keys()).
+//
+// @param lua_state
+//  The lua_State that the table is in.
+//
+// @param table
+//  The stack index of the table to hash.
+//
+// @param keys
+//  The names of the fields to hash.
+//
+// @return
+//  The hash of the named fields in the table and the tables they contain.
+*/
+lua_Integer LuaSystem::hash_settings( lua_State* lua_state, int table, const std::vector<std::string>& keys )
 {
-    const char HASH_KEYWORD [] = "__forge_hash";
-    const size_t HASH_KEYWORD_LENGTH = sizeof(HASH_KEYWORD) - 1;
-
-    // Hashed and sealed tables store their hash value in "__forge_hash".  
-    // Checking for the presence of "__forge_hash" also prevents infinite
-    // recursion in the case of cyclic references in the tables.
-    lua_pushlstring( lua_state, HASH_KEYWORD, HASH_KEYWORD_LENGTH );
-    if ( lua_rawget(lua_state, table) != LUA_TNIL )
+    SWEET_ASSERT( lua_state );
+    SWEET_ASSERT( lua_istable(lua_state, table) );
+
+    table = lua_absindex( lua_state, table );
+    int hashes = push_hashes( lua_state, &HASHES_KEY );
+    push_hashes( lua_state, &SETTINGS_KEYS_HASHES_KEY );
+    lua_pushvalue( lua_state, table );
+    if ( lua_rawget(lua_state, -2) != LUA_TTABLE )
     {
-        lua_Integer hash = luaL_checkinteger( lua_state, -1 );
         lua_pop( lua_state, 1 );
-        return hash;
+        lua_newtable( lua_state );
+        lua_pushvalue( lua_state, table );
+        lua_pushvalue( lua_state, -2 );
+        lua_rawset( lua_state, -4 );
     }
+    int settings_keys_hashes = lua_gettop( lua_state );
 
-    // Initiate iteration with the nil left on top of the stack by the call
-    // to `lua_getfield()` that failed to find a "__forge_hash" field.
     lua_Integer hash = 0;
-    while ( lua_next(lua_state, table) )
+    if ( lua_rawgetp(lua_state, settings_keys_hashes, &keys) == LUA_TNUMBER )
     {
-        meow_hash_state state;
-        MeowHashBegin( &state );
-
-        bool hash_value = false;
-        int type = lua_type( lua_state, -2 );
-        if ( type == LUA_TSTRING || (hash_integer_keys && type == LUA_TNUMBER) )
+        hash = lua_tointeger( lua_state, -1 );
+    }
+    else
+    {
+        uint64_t keys_hash = 0;
+        for ( vector<string>::const_iterator key = keys.begin(); key != keys.end(); ++key )
         {
-            if ( type == LUA_TSTRING )
-            {
-                size_t length = 0;
-                const char* key = lua_tolstring( lua_state, -2, &length );
-                MeowHashAbsorb( &state, length, (void*) key );
-                hash_value = true;
-            }
-            else
-            {
-                lua_Integer key = lua_tointeger( lua_state, -2 );
-                MeowHashAbsorb( &state, sizeof(key), (void*) &key );
-                hash_value = true;
-            }
+            uint64_t key_hash = hash_bytes( key->c_str(), key->size(), LUA_TSTRING );
+            lua_getfield( lua_state, table, key->c_str() );
+            uint64_t value_hash = hash_value( lua_state, lua_gettop(lua_state), hashes, 0 );
+            keys_hash += mix( key_hash * 0x9e3779b97f4a7c15ull + value_hash );
+            lua_pop( lua_state, 1 );
+        }
+        hash = lua_Integer(keys_hash);
+        lua_pushinteger( lua_state, hash );
+        lua_rawsetp( lua_state, settings_keys_hashes, &keys );
+    }
+    lua_pop( lua_state, 4 );
+    return hash;
+}
 
-            if ( lua_type(lua_state, -1) == LUA_TSTRING )
-            {
-                size_t length = 0;
-                const char* value = lua_tolstring( lua_state, -1, &length );
-                MeowHashAbsorb( &state, length, (void*) value );
-            }
-            else if ( lua_isinteger(lua_state, -1) )
-            {
-                lua_Integer value = lua_tointeger( lua_state, -1 );
-                MeowHashAbsorb( &state, sizeof(value), (void*) &value );
-            }
-            else if ( lua_isnumber(lua_state, -1) )
-            {
-                lua_Number value = lua_tonumber( lua_state, -1 );
-                MeowHashAbsorb( &state, sizeof(value), (void*) &value );
-            }
-            else if ( lua_isboolean(lua_state, -1) )
-            {
-                bool value = lua_toboolean( lua_state, -1 ) == 1;
-                MeowHashAbsorb( &state, sizeof(value), (void*) &value );
-            }
-            else if ( lua_istable(lua_state, -1) )
-            {
-                hash ^= hash_recursively( lua_state, lua_gettop(lua_state), true );
-            }
+int LuaSystem::invalidate_hashes( lua_State* lua_state )
+{
+    lua_pushnil( lua_state );
+    lua_rawsetp( lua_state, LUA_REGISTRYINDEX, &HASHES_KEY );
+    lua_pushnil( lua_state );
+    lua_rawsetp( lua_state, LUA_REGISTRYINDEX, &SETTINGS_KEYS_HASHES_KEY );
+    return 0;
+}
+
+/**
+// Push a table of cached hashes from the registry creating it first if it
+// doesn't exist.
+//
+// Tables of cached hashes are weak keyed by the settings tables that they
+// cache hashes for so that they don't keep discarded settings alive.
+//
+// @param lua_state
+//  The lua_State to push the table onto.
+//
+// @param key
+//  The address used as the registry key of the table.
+//
+// @return
+//  The stack index of the table.
+*/
+int LuaSystem::push_hashes( lua_State* lua_state, const void* key )
+{
+    if ( lua_rawgetp(lua_state, LUA_REGISTRYINDEX, key) != LUA_TTABLE )
+    {
+        lua_pop( lua_state, 1 );
+        lua_newtable( lua_state );
+        lua_newtable( lua_state );
+        lua_pushstring( lua_state, "k" );
+        lua_setfield( lua_state, -2, "__mode" );
+        lua_setmetatable( lua_state, -2 );
+        lua_pushvalue( lua_state, -1 );
+        lua_rawsetp( lua_state, LUA_REGISTRYINDEX, key );
+    }
+    return lua_gettop( lua_state );
+}
+
+uint64_t LuaSystem::hash_recursively( lua_State* lua_state, int table, int hashes, bool hash_integer_keys, int depth )
+{
+    const int MAXIMUM_DEPTH = 64;
+    if ( depth > MAXIMUM_DEPTH )
+    {
+        luaL_error( lua_state, "Settings are nested too deeply or contain cycles" );
+        return 0;
+    }
+
+    // Only the top-level and inherited tables are cached; tables nested 
+    // in those are rehashed as part of their containing table.
+    if ( !hash_integer_keys )
+    {
+        lua_pushvalue( lua_state, table );
+        if ( lua_rawget(lua_state, hashes) == LUA_TNUMBER )
+        {
+            uint64_t hash = uint64_t(lua_tointeger( lua_state, -1 ));
+            lua_pop( lua_state, 1 );
+            return hash;
+        }
+        lua_pop( lua_state, 1 );
+    }
 
-            meow_hash working_hash = MeowHashEnd( &state, 0xc0dedbad );
-            hash ^= MeowU64From( working_hash, 0 );
+    uint64_t hash = 0;
+    lua_pushnil( lua_state );
+    while ( lua_next(lua_state, table) )
+    {
+        uint64_t key_hash = 0;
+        int key_type = lua_type( lua_state, -2 );
+        if ( key_type == LUA_TSTRING )
+        {
+            size_t length = 0;
+            const char* key = lua_tolstring( lua_state, -2, &length );
+            key_hash = hash_bytes( key, length, LUA_TSTRING );
+        }
+        else if ( hash_integer_keys && key_type == LUA_TNUMBER )
+        {
+            lua_Integer key = lua_tointeger( lua_state, -2 );
+            key_hash = hash_bytes( &key, sizeof(key), LUA_TNUMBER );
+        }
+        else
+        {
+            lua_pop( lua_state, 1 );
+            continue;
         }
+
+        uint64_t value_hash = hash_value( lua_state, lua_gettop(lua_state), hashes, depth );
+
+        // Sum the hashes of each key and value pair so that the hash is
+        // independent of the order that `lua_next()` visits fields in.
+        hash += mix( key_hash * 0x9e3779b97f4a7c15ull + value_hash );
         lua_pop( lua_state, 1 );
     }
 
     // Recursively calculate hashes from fields in tables that this table
-    // inherits from.
+    // inherits from.  Integer keys are hashed in inherited tables when they
+    // are hashed in this table so that the fields of settings, which are 
+    // held in a table that the settings inherit from (see Settings.lua), 
+    // are hashed the same way as those of plain tables.
     int type = luaL_getmetafield( lua_state, table, "__index" );
     if ( type != LUA_TNIL )
     {
         if ( type == LUA_TTABLE )
         {
-            hash ^= hash_recursively( lua_state, lua_gettop(lua_state), false );
+            hash += mix( hash_recursively(lua_state, lua_gettop(lua_state), hashes, hash_integer_keys, depth + 1) );
         }
         lua_pop( lua_state, 1 );
     }
 
-    // Store the hash in the "__forge_hash" key in the table to make it
-    // available afterwards and to mark the table as hashed and sealed.
-    lua_pushstring( lua_state, HASH_KEYWORD );
-    lua_pushinteger( lua_state, hash );
-    lua_rawset( lua_state, table );
+    if ( !hash_integer_keys )
+    {
+        lua_pushvalue( lua_state, table );
+        lua_pushinteger( lua_state, lua_Integer(hash) );
+        lua_rawset( lua_state, hashes );
+    }
+    return hash;
+}
+
+/**
+// Hash a single value.
+//
+// Strings, numbers, and booleans are hashed along with their type.  Tables
+// are hashed recursively including their integer keys.  Any other values, 
+// including nil, hash to zero.
+//
+// @return
+//  The hash.
+*/
+uint64_t LuaSystem::hash_value( lua_State* lua_state, int value, int hashes, int depth )
+{
+    uint64_t hash = 0;
+    int type = lua_type( lua_state, value );
+    if ( type == LUA_TSTRING )
+    {
+        size_t length = 0;
+        const char* string_value = lua_tolstring( lua_state, value, &length );
+        hash = hash_bytes( string_value, length, LUA_TSTRING );
+    }
+    else if ( lua_isinteger(lua_state, value) )
+    {
+        lua_Integer integer_value = lua_tointeger( lua_state, value );
+        hash = hash_bytes( &integer_value, sizeof(integer_value), LUA_TNUMBER );
+    }
+    else if ( type == LUA_TNUMBER )
+    {
+        lua_Number number_value = lua_tonumber( lua_state, value );
+        hash = hash_bytes( &number_value, sizeof(number_value), LUA_TNUMBER );
+    }
+    else if ( type == LUA_TBOOLEAN )
+    {
+        uint8_t boolean_value = lua_toboolean( lua_state, value ) ? 1 : 0;
+        hash = hash_bytes( &boolean_value, sizeof(boolean_value), LUA_TBOOLEAN );
+    }
+    else if ( type == LUA_TTABLE )
+    {
+        hash = hash_recursively( lua_state, value, hashes, true, depth + 1 );
+    }
+    return hash;
+}
 
+/**
+// Hash bytes with the 64 bit FNV-1a hash.
+//
+// @param data
+//  The bytes to hash.
+//
+// @param length
+//  The number of bytes to hash.
+//
+// @param type
+//  The Lua type of the value that the bytes are from (mixed into the hash so
+//  that values of different types with the same bytes hash differently).
+//
+// @return
+//  The hash.
+*/
+uint64_t LuaSystem::hash_bytes( const void* data, size_t length, int type )
+{
+    const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+    const uint64_t FNV_PRIME = 0x100000001b3ull;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( data );
+    uint64_t hash = (FNV_OFFSET_BASIS ^ uint64_t(type)) * FNV_PRIME;
+    for ( size_t i = 0; i < length; ++i )
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+// Mix the bits of a hash (the MurmurHash3 64 bit finalizer).
+*/
+uint64_t LuaSystem::mix( uint64_t hash )
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
     return hash;
 }
@@ -2,10 +2,20 @@
 #define FORGE_LUASYSTEM_HPP_INCLUDED
 
 #include <lua.hpp>
+#include <vector>
+#include <string>
+#include <stdint.h>
 
 namespace sweet
 {
 
+namespace process
+{
+
+struct Usage;
+
+}
+
 namespace forge
 {
 
@@ -18,18 +28,33 @@ public:
     ~LuaSystem();
     void create( Forge* forge, lua_State* lua_state );
     void destroy();
+    static lua_Integer hash_settings( lua_State* lua_state, int table );
+    static lua_Integer hash_settings( lua_State* lua_state, int table, const std::vector<std::string>& keys );
+    static void push_usage( lua_State* lua_state, const process::Usage& usage );
 
 private:
     static int set_forge_hooks_library( lua_State* lua_state );
     static int forge_hooks_library( lua_State* lua_state );
     static int hash( lua_State* lua_state );
+    static int invalidate_hashes( lua_State* lua_state );
     static int execute( lua_State* lua_state );
     static int print( lua_State* lua_state );
     static int getenv( lua_State* lua_state );
     static int sleep( lua_State* lua_state );
     static int ticks( lua_State* lua_state );
+    static int begin_phase( lua_State* lua_state );
+    static int end_phase( lua_State* lua_state );
+    static int add_counter( lua_State* lua_state );
+    static int phases( lua_State* lua_state );
+    static int counters( lua_State* lua_state );
+    static int lua_memory( lua_State* lua_state );
+    static int print_statistics( lua_State* lua_state );
     static int operating_system( lua_State* lua_state );
-    static lua_Integer hash_recursively( lua_State* lua_state, int table, bool hash_integer_keys );
+    static int push_hashes( lua_State* lua_state, const void* key );
+    static uint64_t hash_recursively( lua_State* lua_state, int table, int hashes, bool hash_integer_keys, int depth );
+    static uint64_t hash_value( lua_State* lua_state, int value, int hashes, int depth );
+    static uint64_t hash_bytes( const void* data, size_t length, int type );
+    static uint64_t mix( uint64_t hash );
 };
 
 }
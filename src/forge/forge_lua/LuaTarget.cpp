@@ -5,6 +5,7 @@
 
 #include "LuaTarget.hpp"
 #include "LuaGraph.hpp"
+#include "LuaSystem.hpp"
 #include "types.hpp"
 #include <forge/Target.hpp>
 #include <forge/TargetPrototype.hpp>
@@ -15,11 +16,14 @@
 #include <assert/assert.hpp>
 #include <lua.hpp>
 #include <algorithm>
+#include <memory>
 
 using std::min;
 using std::max;
 using std::string;
 using std::vector;
+using std::shared_ptr;
+using std::make_shared;
 using namespace sweet;
 using namespace sweet::luaxx;
 using namespace sweet::forge;
@@ -57,6 +61,10 @@ void LuaTarget::create( lua_State* lua_state, Forge* forge )
         { "cleanable", &LuaTarget::cleanable },
         { "set_built", &LuaTarget::set_built },
         { "built", &LuaTarget::built },
+        { "set_settings_keys", &LuaTarget::set_settings_keys },
+        { "settings_keys", &LuaTarget::settings_keys },
+        { "fingerprint", &LuaTarget::fingerprint },
+        { "usage", &LuaTarget::usage },
         { "timestamp", &LuaTarget::timestamp },
         { "last_write_time", &LuaTarget::last_write_time },
         { "outdated", &LuaTarget::outdated },
@@ -90,6 +98,7 @@ void LuaTarget::create( lua_State* lua_state, Forge* forge )
         { "ordering_dependencies", &LuaTarget::ordering_dependencies },
         { "any_dependency", &LuaTarget::any_dependency },
         { "any_dependencies", &LuaTarget::any_dependencies },
+        { "outdated_reason", &LuaTarget::outdated_reason },
         { nullptr, nullptr }
     };
     luaxx_push( lua_state_, this );
@@ -314,6 +323,105 @@ int LuaTarget::built( lua_State* lua_state )
     return 0;
 }
 
+/**
+// Record the names of the settings read when a target was built.
+//
+// The names are passed as the keys of a table, e.g. `{debug = true, 
+// standard = true}`, or as nil if the settings read couldn't be tracked.  The
+// target's hash is then recalculated from just those settings of the 
+// toolset that it was created with, or from all of them if the settings 
+// read couldn't be tracked, so that the target is only outdated by changes
+// to settings that building it actually read.
+*/
+int LuaTarget::set_settings_keys( lua_State* lua_state )
+{
+    const int TARGET = 1;
+    const int SETTINGS_KEYS = 2;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "nil target" );
+    if ( target )
+    {
+        shared_ptr<vector<string>> settings_keys;
+        if ( lua_istable(lua_state, SETTINGS_KEYS) )
+        {
+            settings_keys = make_shared<vector<string>>();
+            lua_pushnil( lua_state );
+            while ( lua_next(lua_state, SETTINGS_KEYS) )
+            {
+                if ( lua_type(lua_state, -2) == LUA_TSTRING && lua_toboolean(lua_state, -1) )
+                {
+                    size_t length = 0;
+                    const char* key = lua_tolstring( lua_state, -2, &length );
+                    settings_keys->push_back( string(key, length) );
+                }
+                lua_pop( lua_state, 1 );
+            }
+            std::sort( settings_keys->begin(), settings_keys->end() );
+            settings_keys = target->graph()->intern_settings_keys( settings_keys );
+        }
+
+        uint64_t hash = 0;
+        lua_getfield( lua_state, TARGET, "toolset" );
+        if ( lua_istable(lua_state, -1) )
+        {
+            lua_getfield( lua_state, -1, "settings" );
+            if ( lua_istable(lua_state, -1) )
+            {
+                hash = uint64_t(settings_keys ? LuaSystem::hash_settings(lua_state, -1, *settings_keys) : LuaSystem::hash_settings(lua_state, -1));
+            }
+            lua_pop( lua_state, 1 );
+        }
+        lua_pop( lua_state, 1 );
+        target->set_settings_keys( settings_keys, hash );
+    }
+    return 0;
+}
+
+int LuaTarget::settings_keys( lua_State* lua_state )
+{
+    const int TARGET = 1;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "nil target" );
+    if ( target && target->settings_keys() )
+    {
+        const vector<string>& settings_keys = *target->settings_keys();
+        lua_createtable( lua_state, int(settings_keys.size()), 0 );
+        for ( size_t i = 0; i < settings_keys.size(); ++i )
+        {
+            lua_pushlstring( lua_state, settings_keys[i].c_str(), settings_keys[i].size() );
+            lua_rawseti( lua_state, -2, lua_Integer(i + 1) );
+        }
+        return 1;
+    }
+    return 0;
+}
+
+int LuaTarget::fingerprint( lua_State* lua_state )
+{
+    const int TARGET = 1;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "nil target" );
+    if ( target )
+    {
+        lua_pushinteger( lua_state, lua_Integer(target->fingerprint()) );
+        return 1;
+    }
+    return 0;
+}
+
+int LuaTarget::usage( lua_State* lua_state )
+{
+    const int TARGET = 1;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "nil target" );
+    if ( target && target->usage() )
+    {
+        LuaSystem::push_usage( lua_state, *target->usage() );
+        return 1;
+    }
+    return 0;
+}
+
 int LuaTarget::timestamp( lua_State* lua_state )
 {
     const int TARGET = 1;
@@ -353,6 +461,43 @@ int LuaTarget::outdated( lua_State* lua_state )
     return 0;
 }
 
+int LuaTarget::outdated_reason( lua_State* lua_state )
+{
+    static const char* REASONS [] = 
+    {
+        nullptr,
+        "missing_file",
+        "not_built",
+        "settings_changed",
+        "dependency_outdated",
+        "dependency_newer"
+    };
+
+    const int TARGET = 1;
+    Target* target = (Target*) luaxx_to( lua_state, TARGET, TARGET_TYPE );
+    luaL_argcheck( lua_state, target != nullptr, TARGET, "nil target" );
+    if ( target && target->outdated_reason() != OUTDATED_NONE )
+    {
+        int reason = int(target->outdated_reason());
+        SWEET_ASSERT( reason > 0 && reason < int(sizeof(REASONS) / sizeof(REASONS[0])) );
+        lua_pushstring( lua_state, REASONS[reason] );
+        Target* dependency = target->outdated_dependency();
+        if ( dependency )
+        {
+            if ( !dependency->referenced_by_script() )
+            {
+                LuaTarget* lua_target = (LuaTarget*) lua_touserdata( lua_state, lua_upvalueindex(1) );
+                SWEET_ASSERT( lua_target );
+                lua_target->create_target( dependency );
+            }
+            luaxx_push( lua_state, dependency );
+            return 2;
+        }
+        return 1;
+    }
+    return 0;
+}
+
 int LuaTarget::add_filename( lua_State* lua_state )
 {
     const int TARGET = 1;
@@ -959,6 +1104,23 @@ int LuaTarget::target_call_metamethod( lua_State* lua_state )
     // Ignore `Target` passed as first parameter.
     (void) TARGET;
 
+    // Build functions are passed a view of their toolset that records the
+    // settings that they read (see `build_visit()` in init.lua).  Create 
+    // targets with the toolset that the view wraps instead so that they 
+    // aren't left referring to the view after the build has finished.
+    if ( lua_istable(lua_state, TOOLSET) )
+    {
+        lua_pushliteral( lua_state, "__toolset" );
+        if ( lua_rawget(lua_state, TOOLSET) == LUA_TTABLE )
+        {
+            lua_replace( lua_state, TOOLSET );
+        }
+        else
+        {
+            lua_pop( lua_state, 1 );
+        }
+    }
+
     Forge* forge = (Forge*) lua_touserdata( lua_state, FORGE );
     Context* context = forge->context();
     Graph* graph = forge->graph();
@@ -1009,22 +1171,14 @@ int LuaTarget::target_call_metamethod( lua_State* lua_state )
         lua_setfield( lua_state, -2, "toolset" );
         lua_pop( lua_state, 1 );
 
-        lua_getglobal( lua_state, "hash" );
         lua_getfield( lua_state, TOOLSET, "settings" );
         if ( lua_istable(lua_state, -1) )
         {
-            lua_call( lua_state, 1, 1 );
-            const lua_Integer hash = luaL_checkinteger( lua_state, -1 );
+            const vector<string>* settings_keys = target->settings_keys();
+            const lua_Integer hash = settings_keys ? LuaSystem::hash_settings( lua_state, -1, *settings_keys ) : LuaSystem::hash_settings( lua_state, -1 );
             target->set_hash( hash );
         }
         lua_pop( lua_state, 1 );
-
-        // The following calculation of the hash of the settings table without
-        // calling into the Lua API so much should work but crashes for some
-        // reason I don't understand.
-        // lua_getfield( lua_state, TOOLSET, "settings" );
-        // lua_Integer hash = LuaSystem::hash_recursively( lua_state, -1, false );
-        // lua_pop( lua_state, 1 );
     }
 
     luaxx_push( lua_state, target );    
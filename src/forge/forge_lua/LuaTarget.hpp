@@ -40,6 +40,11 @@ public:
     static int cleanable( lua_State* lua_state );
     static int set_built( lua_State* lua_state );
     static int built( lua_State* lua_state );
+    static int set_settings_keys( lua_State* lua_state );
+    static int settings_keys( lua_State* lua_state );
+    static int fingerprint( lua_State* lua_state );
+    static int usage( lua_State* lua_state );
+    static int outdated_reason( lua_State* lua_state );
     static int timestamp( lua_State* lua_state );
     static int last_write_time( lua_State* lua_state );
     static int outdated( lua_State* lua_state );
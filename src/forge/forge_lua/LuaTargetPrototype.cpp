@@ -53,11 +53,23 @@ void LuaTargetPrototype::create( lua_State* lua_state, Forge* forge, LuaTarget*
     lua_pop( lua_state_, 1 );
 
     // Create a metatable for target prototypes to redirect index operations
-    // to `forge.Target` and calls to `TargetPrototype.create()` via
+    // to target prototype functions and then `forge.Target` and calls to 
+    // `TargetPrototype.create()` via 
     // `LuaTargetPrototype::create_call_metamethod()`.
+    static const luaL_Reg functions[] = 
+    {
+        { "set_single_command", &LuaTargetPrototype::set_single_command },
+        { "single_command", &LuaTargetPrototype::single_command },
+        { nullptr, nullptr }
+    };
     luaL_newmetatable( lua_state_, TARGET_PROTOTYPE_METATABLE );
+    lua_newtable( lua_state_ );
+    luaL_setfuncs( lua_state_, functions, 0 );
+    lua_newtable( lua_state_ );
     luaxx_push( lua_state_, lua_target );
     lua_setfield( lua_state_, -2, "__index" );
+    lua_setmetatable( lua_state_, -2 );
+    lua_setfield( lua_state_, -2, "__index" );
     lua_pushcfunction( lua_state_, &LuaTargetPrototype::create_target_call_metamethod );
     lua_setfield( lua_state_, -2, "__call" );
     lua_pop( lua_state_, 1 );
@@ -170,3 +182,30 @@ int LuaTargetPrototype::create_target_call_metamethod( lua_State* lua_state )
     lua_call( lua_state, args, 1 );
     return 1;
 }
+
+int LuaTargetPrototype::set_single_command( lua_State* lua_state )
+{
+    const int TARGET_PROTOTYPE = 1;
+    const int SINGLE_COMMAND = 2;
+    TargetPrototype* target_prototype = (TargetPrototype*) luaxx_to( lua_state, TARGET_PROTOTYPE, TARGET_PROTOTYPE_TYPE );
+    luaL_argcheck( lua_state, target_prototype != nullptr, TARGET_PROTOTYPE, "nil target prototype" );
+    if ( target_prototype )
+    {
+        bool single_command = lua_toboolean( lua_state, SINGLE_COMMAND ) != 0;
+        target_prototype->set_single_command( single_command );
+    }
+    return 0;
+}
+
+int LuaTargetPrototype::single_command( lua_State* lua_state )
+{
+    const int TARGET_PROTOTYPE = 1;
+    TargetPrototype* target_prototype = (TargetPrototype*) luaxx_to( lua_state, TARGET_PROTOTYPE, TARGET_PROTOTYPE_TYPE );
+    luaL_argcheck( lua_state, target_prototype != nullptr, TARGET_PROTOTYPE, "nil target prototype" );
+    if ( target_prototype )
+    {
+        lua_pushboolean( lua_state, target_prototype->single_command() ? 1 : 0 );
+        return 1;
+    }
+    return 0;
+}
@@ -26,6 +26,8 @@ public:
     void destroy_target_prototype( TargetPrototype* target_prototype );
     static int create_target_prototype_call_metamethod( lua_State* lua_state );
     static int create_target_call_metamethod( lua_State *lua_state );
+    static int set_single_command( lua_State* lua_state );
+    static int single_command( lua_State* lua_state );
 };
     
 }
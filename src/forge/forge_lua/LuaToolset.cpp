@@ -11,16 +11,53 @@
 #include <luaxx/luaxx.hpp>
 #include <assert/assert.hpp>
 #include <lua.hpp>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
 
 using std::string;
+using std::vector;
+using std::unique_ptr;
 using namespace sweet;
 using namespace sweet::luaxx;
 using namespace sweet::forge;
 
 const char* LuaToolset::TOOLSET_METATABLE = "forge.Toolset";
 
+/**
+// The maximum number of compiled templates to cache before the cache is 
+// discarded and templates are compiled again as they're interpolated.
+*/
+static const size_t MAXIMUM_TEMPLATES = 16384;
+
+/**
+// A template compiled by `Toolset.interpolate()`.
+//
+// The template is split into segments of literal text that are each 
+// followed by a `${...}` expression and the literal text that follows the
+// last expression.  Expressions that contain no nested expressions are 
+// split into their parameters when they're compiled.  Expressions that do
+// contain nested expressions are compiled into templates of their own that
+// are interpolated and then split into parameters each time the template is
+// interpolated.
+*/
+struct LuaToolset::Template
+{
+    struct Segment
+    {
+        string literal; ///< The literal text that precedes the expression.
+        vector<string> parameters; ///< The parameters of the expression if it has no nested expressions.
+        unique_ptr<Template> expression; ///< The compiled expression if it has nested expressions otherwise null.
+    };
+
+    vector<Segment> segments; ///< The segments of literal text and expressions in this template.
+    string tail; ///< The literal text after the last expression in this template.
+};
+
 LuaToolset::LuaToolset()
-: lua_state_( nullptr )
+: lua_state_( nullptr ),
+  templates_(),
+  interpolations_( 0 )
 {
 }
 
@@ -46,6 +83,10 @@ void LuaToolset::create( lua_State* lua_state )
     };
     luaxx_push( lua_state_, this );
     luaL_setfuncs( lua_state_, functions, 0 );
+    lua_pushlightuserdata( lua_state_, this );
+    lua_newtable( lua_state_ );
+    lua_pushcclosure( lua_state_, &LuaToolset::interpolate, 2 );
+    lua_setfield( lua_state_, -2, "interpolate" );
     lua_pop( lua_state_, 1 );
 
     // Set the metatable for `Toolset` to redirect calls to create new
@@ -83,6 +124,7 @@ void LuaToolset::destroy()
         luaxx_destroy( lua_state_, this );
         lua_state_ = nullptr;
     }
+    templates_.clear();
 }
 
 void LuaToolset::create_toolset( Toolset* toolset )
@@ -185,3 +227,365 @@ int LuaToolset::continue_create_call_metamethod( lua_State* /*lua_state*/, int /
 {
     return 1;
 }
+
+/**
+// Provide GNU Make like string substitution.
+//
+// Each `${...}` expression in the template is replaced by the value found 
+// for its first whitespace separated parameter, the identifier, in 
+// `variables`, the settings of the toolset, the fields and functions of the
+// toolset, global variables, and finally environment variables.  Functions
+// are called with the toolset and any remaining parameters and tables are
+// indexed by the second parameter to give the value that is substituted.  
+// Expressions may contain nested expressions that are substituted first.
+//
+// Templates are compiled once and cached by their text in the table that is
+// this function's second upvalue so that repeated interpolations of the 
+// same template don't parse it again.  Templates without expressions are 
+// returned unchanged without being compiled.
+//
+// ~~~lua
+// function Toolset.interpolate( toolset, template, variables )
+// ~~~
+*/
+int LuaToolset::interpolate( lua_State* lua_state )
+{
+    const int LUA_TOOLSET = lua_upvalueindex( 1 );
+    const int TEMPLATES = lua_upvalueindex( 2 );
+    const int TOOLSET = 1;
+    const int TEMPLATE = 2;
+    const int VARIABLES = 3;
+    const int SETTINGS = 4;
+
+    size_t length = 0;
+    const char* source = luaL_checklstring( lua_state, TEMPLATE, &length );
+    bool expressions = false;
+    for ( const char* i = source; i + 1 < source + length && !expressions; ++i )
+    {
+        expressions = i[0] == '$' && i[1] == '{';
+    }
+    if ( !expressions )
+    {
+        lua_settop( lua_state, TEMPLATE );
+        return 1;
+    }
+
+    LuaToolset* lua_toolset = (LuaToolset*) lua_touserdata( lua_state, LUA_TOOLSET );
+    SWEET_ASSERT( lua_toolset );
+
+    lua_settop( lua_state, VARIABLES );
+    lua_getfield( lua_state, TOOLSET, "settings" );
+
+    lua_pushvalue( lua_state, TEMPLATE );
+    lua_rawget( lua_state, TEMPLATES );
+    const Template* compiled_template = (const Template*) lua_touserdata( lua_state, -1 );
+    lua_pop( lua_state, 1 );
+    if ( !compiled_template )
+    {
+        // Discard the cached templates when there are too many of them but
+        // only when no other interpolations are in progress, e.g. from 
+        // functions called to provide substitutions, that might still be
+        // using them.
+        if ( lua_toolset->templates_.size() >= MAXIMUM_TEMPLATES && lua_toolset->interpolations_ == 0 )
+        {
+            lua_toolset->templates_.clear();
+            lua_newtable( lua_state );
+            lua_replace( lua_state, TEMPLATES );
+        }
+        lua_toolset->templates_.push_back( compile(source, source + length) );
+        compiled_template = lua_toolset->templates_.back().get();
+        lua_pushvalue( lua_state, TEMPLATE );
+        lua_pushlightuserdata( lua_state, const_cast<Template*>(compiled_template) );
+        lua_rawset( lua_state, TEMPLATES );
+    }
+
+    struct ScopedInterpolation
+    {
+        LuaToolset* lua_toolset_;
+
+        ScopedInterpolation( LuaToolset* lua_toolset )
+        : lua_toolset_( lua_toolset )
+        {
+            ++lua_toolset_->interpolations_;
+        }
+
+        ~ScopedInterpolation()
+        {
+            --lua_toolset_->interpolations_;
+        }
+    };
+
+    // Push the result or the error message before raising any error so 
+    // that the C++ objects used to substitute are destroyed first.
+    bool substituted = false;
+    {
+        string output;
+        string error;
+        ScopedInterpolation interpolation( lua_toolset );
+        int variables = lua_toboolean( lua_state, VARIABLES ) ? VARIABLES : SETTINGS;
+        substituted = substitute( lua_state, *compiled_template, TOOLSET, variables, SETTINGS, source, &output, &error );
+        const string& result = substituted ? output : error;
+        lua_pushlstring( lua_state, result.c_str(), result.size() );
+    }
+    return substituted ? 1 : lua_error( lua_state );
+}
+
+/**
+// Compile the template in [\e begin, \e end).
+//
+// Expressions are matched in the same way as the Lua pattern `%$(%b{})`; a 
+// `$` that isn't followed by balanced braces is literal text.
+//
+// @return
+//  The compiled template.
+*/
+std::unique_ptr<LuaToolset::Template> LuaToolset::compile( const char* begin, const char* end )
+{
+    SWEET_ASSERT( begin <= end );
+
+    unique_ptr<Template> compiled_template( new Template );
+    const char* literal = begin;
+    const char* i = begin;
+    while ( i != end )
+    {
+        const char* close = nullptr;
+        if ( *i == '$' && i + 1 != end && i[1] == '{' )
+        {
+            int depth = 1;
+            const char* j = i + 2;
+            while ( j != end && depth > 0 )
+            {
+                depth += *j == '{' ? 1 : *j == '}' ? -1 : 0;
+                ++j;
+            }
+            close = depth == 0 ? j - 1 : nullptr;
+        }
+
+        if ( close )
+        {
+            compiled_template->segments.push_back( Template::Segment() );
+            Template::Segment& segment = compiled_template->segments.back();
+            segment.literal.assign( literal, i );
+            unique_ptr<Template> expression = compile( i + 2, close );
+            if ( expression->segments.empty() )
+            {
+                const string& text = expression->tail;
+                split( text.c_str(), text.c_str() + text.size(), &segment.parameters );
+            }
+            else
+            {
+                segment.expression = std::move( expression );
+            }
+            i = close + 1;
+            literal = i;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    compiled_template->tail.assign( literal, end );
+    return compiled_template;
+}
+
+/**
+// Split [\e begin, \e end) into whitespace separated parameters.
+*/
+void LuaToolset::split( const char* begin, const char* end, std::vector<std::string>* parameters )
+{
+    SWEET_ASSERT( parameters );
+    const char* i = begin;
+    while ( i != end )
+    {
+        while ( i != end && isspace((unsigned char) *i) )
+        {
+            ++i;
+        }
+        const char* parameter = i;
+        while ( i != end && !isspace((unsigned char) *i) )
+        {
+            ++i;
+        }
+        if ( parameter != i )
+        {
+            parameters->push_back( string(parameter, i) );
+        }
+    }
+}
+
+/**
+// Append the substitution of \e compiled_template to \e output.
+//
+// Values are looked up and substitution functions called in a protected 
+// call to `substitution()` so that errors, raised with `longjmp()` by Lua,
+// never unwind through this function and skip the destructors of its 
+// locals.  The first error stops substitution and its message is returned 
+// in \e error to be raised once the caller has cleaned up.
+//
+// @param toolset
+//  The stack index of the toolset.
+//
+// @param variables
+//  The stack index of the variables to look up values in first.
+//
+// @param settings
+//  The stack index of the settings of the toolset.
+//
+// @param source
+//  The text of the template being interpolated for error messages.
+//
+// @param output
+//  The string to append the substitution to.
+//
+// @param error
+//  The string to set to the error message if substitution fails.
+//
+// @return
+//  True if substitution succeeded otherwise false.
+*/
+bool LuaToolset::substitute( lua_State* lua_state, const Template& compiled_template, int toolset, int variables, int settings, const char* source, std::string* output, std::string* error )
+{
+    SWEET_ASSERT( output );
+    SWEET_ASSERT( error );
+
+    vector<string> expression_parameters;
+    for ( vector<Template::Segment>::const_iterator segment = compiled_template.segments.begin(); segment != compiled_template.segments.end(); ++segment )
+    {
+        output->append( segment->literal );
+
+        const vector<string>* parameters = &segment->parameters;
+        if ( segment->expression )
+        {
+            string expression;
+            if ( !substitute(lua_state, *segment->expression, toolset, variables, settings, source, &expression, error) )
+            {
+                return false;
+            }
+            expression_parameters.clear();
+            split( expression.c_str(), expression.c_str() + expression.size(), &expression_parameters );
+            parameters = &expression_parameters;
+        }
+
+        lua_pushcfunction( lua_state, &LuaToolset::substitution );
+        lua_pushvalue( lua_state, toolset );
+        lua_pushvalue( lua_state, variables );
+        lua_pushvalue( lua_state, settings );
+        lua_pushstring( lua_state, source );
+        lua_pushstring( lua_state, !parameters->empty() ? parameters->front().c_str() : "" );
+        for ( size_t i = 1; i < parameters->size(); ++i )
+        {
+            const string& parameter = (*parameters)[i];
+            lua_pushlstring( lua_state, parameter.c_str(), parameter.size() );
+        }
+        int arguments = 5 + int(parameters->size() > 1 ? parameters->size() - 1 : 0);
+        if ( lua_pcall(lua_state, arguments, 1, 0) != LUA_OK )
+        {
+            const char* message = lua_tostring( lua_state, -1 );
+            error->assign( message ? message : "Error in substitution" );
+            lua_pop( lua_state, 1 );
+            return false;
+        }
+
+        size_t length = 0;
+        const char* value = lua_tolstring( lua_state, -1, &length );
+        output->append( value, length );
+        lua_pop( lua_state, 1 );
+    }
+    output->append( compiled_template.tail );
+    return true;
+}
+
+/**
+// Find the value to substitute for an expression.
+//
+// Called as a protected call from `substitute()` with the toolset, 
+// variables, settings, template text, identifier, and any other parameters
+// of the expression.  Errors are raised normally as no C++ objects live in
+// this function.
+//
+// @return
+//  The string to substitute.
+*/
+int LuaToolset::substitution( lua_State* lua_state )
+{
+    const int TOOLSET = 1;
+    const int VARIABLES = 2;
+    const int SETTINGS = 3;
+    const int SOURCE = 4;
+    const int IDENTIFIER = 5;
+    const int PARAMETERS = 6;
+
+    const int parameters = lua_gettop( lua_state ) - IDENTIFIER;
+    const char* identifier = lua_tostring( lua_state, IDENTIFIER );
+    if ( lua_toboolean(lua_state, VARIABLES) )
+    {
+        lua_getfield( lua_state, VARIABLES, identifier );
+    }
+    else
+    {
+        lua_pushnil( lua_state );
+    }
+    if ( !lua_toboolean(lua_state, -1) && !lua_rawequal(lua_state, SETTINGS, VARIABLES) && lua_toboolean(lua_state, SETTINGS) )
+    {
+        lua_pop( lua_state, 1 );
+        lua_getfield( lua_state, SETTINGS, identifier );
+    }
+    if ( !lua_toboolean(lua_state, -1) )
+    {
+        lua_pop( lua_state, 1 );
+        lua_getfield( lua_state, TOOLSET, identifier );
+    }
+    if ( !lua_toboolean(lua_state, -1) )
+    {
+        lua_pop( lua_state, 1 );
+        lua_getglobal( lua_state, identifier );
+    }
+    if ( !lua_toboolean(lua_state, -1) )
+    {
+        lua_pop( lua_state, 1 );
+        const char* value = ::getenv( identifier );
+        if ( value )
+        {
+            lua_pushstring( lua_state, value );
+        }
+        else
+        {
+            lua_pushnil( lua_state );
+        }
+    }
+
+    int type = lua_type( lua_state, -1 );
+    if ( type == LUA_TFUNCTION )
+    {
+        lua_pushvalue( lua_state, TOOLSET );
+        for ( int i = 0; i < parameters; ++i )
+        {
+            lua_pushvalue( lua_state, PARAMETERS + i );
+        }
+        lua_call( lua_state, parameters + 1, 1 );
+    }
+    else if ( type == LUA_TTABLE )
+    {
+        if ( parameters > 0 )
+        {
+            lua_pushvalue( lua_state, PARAMETERS );
+        }
+        else
+        {
+            lua_pushnil( lua_state );
+        }
+        lua_gettable( lua_state, -2 );
+        lua_remove( lua_state, -2 );
+    }
+
+    if ( !lua_toboolean(lua_state, -1) )
+    {
+        return luaL_error( lua_state, "Missing substitute for \"%s\" in \"%s\"", identifier, lua_tostring(lua_state, SOURCE) );
+    }
+    else if ( !lua_isstring(lua_state, -1) )
+    {
+        return luaL_error( lua_state, "invalid replacement value (a %s)", luaL_typename(lua_state, -1) );
+    }
+    lua_tostring( lua_state, -1 );
+    return 1;
+}
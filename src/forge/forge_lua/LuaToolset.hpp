@@ -2,6 +2,9 @@
 #define FORGE_LUATOOLSET_HPP_INCLUDED
 
 #include <ctime>
+#include <string>
+#include <vector>
+#include <memory>
 #include <lua.hpp>
 
 struct lua_State;
@@ -16,7 +19,11 @@ class Toolset;
 
 class LuaToolset
 {
+    struct Template;
+
     lua_State* lua_state_; ///< The main Lua virtual machine to create the toolset API in.
+    std::vector<std::unique_ptr<Template>> templates_; ///< The templates compiled by `Toolset.interpolate()` in the order they were first interpolated.
+    int interpolations_; ///< The number of calls to `Toolset.interpolate()` currently in progress.
 
 public:
     static const char* TOOLSET_METATABLE;
@@ -34,6 +41,13 @@ public:
     static int prototype( lua_State* lua_state );
     static int create_call_metamethod( lua_State* lua_state );
     static int continue_create_call_metamethod( lua_State* lua_state, int /*status*/, lua_KContext /*context*/ );
+    static int interpolate( lua_State* lua_state );
+
+private:
+    static std::unique_ptr<Template> compile( const char* begin, const char* end );
+    static void split( const char* begin, const char* end, std::vector<std::string>* parameters );
+    static bool substitute( lua_State* lua_state, const Template& compiled_template, int toolset, int variables, int settings, const char* source, std::string* output, std::string* error );
+    static int substitution( lua_State* lua_state );
 };
 
 }
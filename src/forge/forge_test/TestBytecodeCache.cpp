@@ -0,0 +1,162 @@
+//
+// TestBytecodeCache.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "FileChecker.hpp"
+#include <forge/BytecodeCache.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <string>
+#include <lua.hpp>
+#include <UnitTest++/UnitTest++.h>
+
+using std::string;
+using namespace sweet::forge;
+
+namespace
+{
+
+const char* CACHE_DIRECTORY = "bytecode_cache_test";
+
+// A Lua state and a BytecodeCache that caches into CACHE_DIRECTORY, which 
+// is removed again when the test finishes.
+struct BytecodeCacheChecker : public FileChecker
+{
+    lua_State* lua_state_;
+    BytecodeCache cache_;
+
+    BytecodeCacheChecker()
+    : FileChecker(),
+      lua_state_( luaL_newstate() ),
+      cache_()
+    {
+        boost::filesystem::remove_all( CACHE_DIRECTORY );
+        cache_.set_directory( CACHE_DIRECTORY );
+    }
+
+    ~BytecodeCacheChecker()
+    {
+        lua_close( lua_state_ );
+        boost::filesystem::remove_all( CACHE_DIRECTORY );
+    }
+
+    // Load and call the chunk in \e filename returning the integer that it
+    // returns or -1 if it fails to load.
+    int load( const char* filename )
+    {
+        if ( cache_.load(lua_state_, filename) != LUA_OK )
+        {
+            lua_pop( lua_state_, 1 );
+            return -1;
+        }
+        lua_call( lua_state_, 0, 1 );
+        int value = int(lua_tointeger( lua_state_, -1 ));
+        lua_pop( lua_state_, 1 );
+        return value;
+    }
+
+    // Count the files in the cache directory.
+    int cache_files() const
+    {
+        int count = 0;
+        if ( !boost::filesystem::exists(CACHE_DIRECTORY) )
+        {
+            return count;
+        }
+        boost::filesystem::directory_iterator end;
+        for ( boost::filesystem::directory_iterator i(CACHE_DIRECTORY); i != end; ++i )
+        {
+            ++count;
+        }
+        return count;
+    }
+};
+
+}
+
+SUITE( TestBytecodeCache )
+{
+    TEST_FIXTURE( BytecodeCacheChecker, unchanged_sources_are_loaded_from_the_cache )
+    {
+        create( "bytecode.lua", "return 1", 1000000000 );
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        CHECK_EQUAL( 1, cache_.misses() );
+        CHECK_EQUAL( 1, cache_.hits() );
+        CHECK_EQUAL( 1, cache_files() );
+    }
+
+    TEST_FIXTURE( BytecodeCacheChecker, edits_that_keep_the_size_and_time_are_not_loaded_from_the_cache )
+    {
+        create( "bytecode.lua", "return 1", 1000000000 );
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        create( "bytecode.lua", "return 2", 1000000000 );
+        CHECK_EQUAL( 2, load("bytecode.lua") );
+        CHECK_EQUAL( 2, load("bytecode.lua") );
+        CHECK_EQUAL( 2, cache_.misses() );
+        CHECK_EQUAL( 1, cache_.hits() );
+        CHECK_EQUAL( 1, cache_files() );
+    }
+
+    TEST_FIXTURE( BytecodeCacheChecker, damaged_bytecode_is_compiled_from_source )
+    {
+        create( "bytecode.lua", "return 1" );
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        CHECK_EQUAL( 1, cache_files() );
+
+        // Flip bits in the last byte of the bytecode so that the checksum
+        // no longer matches.
+        boost::filesystem::path cache_filename = boost::filesystem::directory_iterator( CACHE_DIRECTORY )->path();
+        boost::uintmax_t size = boost::filesystem::file_size( cache_filename );
+        {
+            std::fstream file( cache_filename.string(), std::ios::binary | std::ios::in | std::ios::out );
+            file.seekg( size - 1 );
+            char byte = char(file.get());
+            file.seekp( size - 1 );
+            file.put( char(byte ^ 0xff) );
+        }
+
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        CHECK_EQUAL( 1, load("bytecode.lua") );
+        CHECK_EQUAL( 2, cache_.misses() );
+        CHECK_EQUAL( 1, cache_.hits() );
+        CHECK_EQUAL( 1, cache_files() );
+    }
+
+    TEST_FIXTURE( BytecodeCacheChecker, leading_comment_lines_are_skipped )
+    {
+        create( "bytecode.lua", "#!/usr/bin/env lua\nreturn 3" );
+        CHECK_EQUAL( 3, load("bytecode.lua") );
+        CHECK_EQUAL( 3, load("bytecode.lua") );
+        CHECK_EQUAL( 1, cache_.hits() );
+    }
+
+    TEST_FIXTURE( BytecodeCacheChecker, precompiled_chunks_are_loaded_without_caching )
+    {
+        struct Writer
+        {
+            static int write( lua_State* /*lua_state*/, const void* data, size_t size, void* context )
+            {
+                static_cast<string*>( context )->append( static_cast<const char*>(data), size );
+                return 0;
+            }
+        };
+
+        string bytecode;
+        CHECK( luaL_loadstring(lua_state_, "return 4") == LUA_OK );
+        lua_dump( lua_state_, &Writer::write, &bytecode, 0 );
+        lua_pop( lua_state_, 1 );
+        {
+            std::ofstream file( "bytecode.luac", std::ios::binary );
+            file.write( bytecode.data(), bytecode.size() );
+        }
+        files_.push_back( "bytecode.luac" );
+
+        CHECK_EQUAL( 4, load("bytecode.luac") );
+        CHECK_EQUAL( 4, load("bytecode.luac") );
+        CHECK_EQUAL( 0, cache_.hits() );
+        CHECK_EQUAL( 0, cache_files() );
+    }
+}
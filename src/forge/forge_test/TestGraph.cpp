@@ -6,8 +6,16 @@
 #include "stdafx.hpp"
 #include "ErrorChecker.hpp"
 #include "FileChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <forge/Simulator.hpp>
+#include <process/Usage.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <UnitTest++/UnitTest++.h>
 
+using namespace boost::filesystem;
 using namespace sweet::forge;
 
 SUITE( TestGraph )
@@ -68,6 +76,36 @@ SUITE( TestGraph )
         CHECK( errors == 0 );
     }
 
+    TEST_FIXTURE( FileChecker, outdated_targets_record_why_they_are_outdated )
+    {
+        const char* script = 
+            "local foo_cpp = Target( forge, 'foo.cpp' ); \n"
+            "foo_cpp:set_filename( foo_cpp:path() ); \n"
+            "local foo_hpp = Target( forge, 'foo.hpp' ); \n"
+            "foo_hpp:set_filename( foo_hpp:path() ); \n"
+            "local foo_obj = Target( forge, 'foo.obj' ); \n"
+            "foo_obj:set_filename( foo_obj:path() ); \n"
+            "local bar_obj = Target( forge, 'bar.obj' ); \n"
+            "bar_obj:set_filename( bar_obj:path() ); \n"
+            "foo_cpp:add_dependency( foo_hpp ); \n"
+            "foo_obj:add_dependency( foo_cpp ); \n"
+            "bar_obj:add_dependency( foo_hpp ); \n"
+            "postorder( foo_obj, function() end ); \n"
+            "postorder( bar_obj, function() end ); \n"
+            "assert( foo_hpp:outdated_reason() == nil ); \n"
+            "local reason, dependency = foo_cpp:outdated_reason(); \n"
+            "assert( reason == 'dependency_newer' and dependency == foo_hpp ); \n"
+            "reason, dependency = foo_obj:outdated_reason(); \n"
+            "assert( reason == 'dependency_outdated' and dependency == foo_cpp ); \n"
+            "assert( bar_obj:outdated_reason() == 'missing_file' ); \n"
+        ;
+        create( "foo.cpp", "", 1 );
+        create( "foo.hpp", "", 2 );
+        create( "foo.obj", "", 1 );
+        test( script );
+        CHECK( errors == 0 );
+    }
+
     TEST_FIXTURE( ErrorChecker, creating_the_same_target_with_different_prototypes_fails )
     {
         const char* expected_message = 
@@ -94,4 +132,434 @@ SUITE( TestGraph )
         test( script );
         CHECK( errors == 0 );
     }
+
+    TEST_FIXTURE( ErrorChecker, walks_recurse_into_nested_tables_and_phony_dependencies )
+    {
+        const char* script =
+            "local function ids( iterator ) \n"
+            "    local values = {}; \n"
+            "    for index, value in iterator do \n"
+            "        assert( index == #values + 1 ); \n"
+            "        table.insert( values, type(value) == 'table' and value:id() or tostring(value) ); \n"
+            "    end \n"
+            "    return table.concat( values, ',' ); \n"
+            "end \n"
+            "local a = Target( forge, 'a' ); \n"
+            "a:set_filename( 'a' ); \n"
+            "local b = Target( forge, 'b' ); \n"
+            "local c = Target( forge, 'c' ); \n"
+            "c:set_filename( 'c' ); \n"
+            "local d = Target( forge, 'd' ); \n"
+            "d:add_dependency( a ); \n"
+            "b:add_dependency( c ); \n"
+            "b:add_dependency( d ); \n"
+            "local all = Target( forge, 'all' ); \n"
+            "all:add_dependency( b ); \n"
+            "all:add_dependency( a ); \n"
+            "assert( ids(walk_tables({'x', {{'y'}, a, {}}, 3})) == 'x,y,a,3' ); \n"
+            "assert( ids(walk_dependencies(all)) == 'c,a,a' ); \n"
+            "local e = Target( forge, 'e' ); \n"
+            "local f = Target( forge, 'f' ); \n"
+            "e:add_ordering_dependency( f ); \n"
+            "f:add_ordering_dependency( c ); \n"
+            "assert( ids(walk_ordering_dependencies(e)) == 'f,c' ); \n"
+            "local function bound( target ) return target:filename() ~= ''; end \n"
+            "local function phony( target ) return target:filename() == ''; end \n"
+            "assert( ids(walk_ordering_dependencies(e, bound, phony)) == 'c' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, transitive_libraries_are_listed_before_the_libraries_they_depend_on )
+    {
+        const char* script =
+            "local StaticLibrary = TargetPrototype( 'StaticLibrary' ); \n"
+            "local DynamicLibrary = TargetPrototype( 'DynamicLibrary' ); \n"
+            "local function Library( id, prototype ) \n"
+            "    local library = Target( forge, id, prototype ); \n"
+            "    library:set_filename( id ); \n"
+            "    return library; \n"
+            "end \n"
+            "local base = Library( 'base', StaticLibrary ); \n"
+            "local util = Library( 'util', StaticLibrary ); \n"
+            "local math = Library( 'math', StaticLibrary ); \n"
+            "local plugin = Library( 'plugin', DynamicLibrary ); \n"
+            "util:add_ordering_dependency( base ); \n"
+            "math:add_ordering_dependency( base ); \n"
+            "math:add_ordering_dependency( util ); \n"
+            "plugin:add_ordering_dependency( util ); \n"
+            "local libraries = Target( forge, 'libraries' ); \n"
+            "libraries:add_dependency( util ); \n"
+            "libraries:add_dependency( plugin ); \n"
+            "local foo_exe = Library( 'foo.exe' ); \n"
+            "foo_exe:add_dependency( math ); \n"
+            "foo_exe:add_dependency( libraries ); \n"
+            "local ids = {}; \n"
+            "for _, library in ipairs(transitive_libraries(foo_exe, StaticLibrary, DynamicLibrary)) do \n"
+            "    table.insert( ids, library:id() ); \n"
+            "end \n"
+            "assert( table.concat(ids, ',') == 'math,plugin,util,base' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, stale_targets_are_removed_on_request )
+    {
+        const char* first_script =
+            "load_binary( 'stale.forge' ); \n"
+            "Target( forge, 'foo.obj' ); \n"
+            "Target( forge, 'bar.obj' ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'stale.forge' ); \n"
+            "Target( forge, 'foo.obj' ); \n"
+            "assert( remove_stale_targets() == 1 ); \n"
+            "save_binary(); \n"
+        ;
+        const char* third_script =
+            "load_binary( 'stale.forge' ); \n"
+            "assert( find_target('foo.obj') ); \n"
+            "assert( find_target('bar.obj') == nil ); \n"
+        ;
+        files_.push_back( "stale.forge" );
+        files_.push_back( "stale.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+        test( third_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, targets_outside_of_the_current_run_survive_saving )
+    {
+        const char* debug_script =
+            "load_binary( 'variants.forge' ); \n"
+            "forge.settings = { variant = 'debug'; }; \n"
+            "local foo = Target( forge, 'debug/foo.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* release_script =
+            "load_binary( 'variants.forge' ); \n"
+            "forge.settings = { variant = 'release'; }; \n"
+            "local foo = Target( forge, 'release/foo.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_debug_script =
+            "load_binary( 'variants.forge' ); \n"
+            "forge.settings = { variant = 'debug'; }; \n"
+            "local foo = Target( forge, 'debug/foo.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( target:built() ); \n"
+            "    assert( not target:outdated() ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_release_script =
+            "load_binary( 'variants.forge' ); \n"
+            "forge.settings = { variant = 'release'; }; \n"
+            "local foo = Target( forge, 'release/foo.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( target:built() ); \n"
+            "    assert( not target:outdated() ); \n"
+            "end ); \n"
+        ;
+        files_.push_back( "variants.forge" );
+        files_.push_back( "variants.forge.journal" );
+        test( debug_script );
+        CHECK( errors == 0 );
+        test( release_script );
+        CHECK( errors == 0 );
+        test( second_debug_script );
+        CHECK( errors == 0 );
+        test( second_release_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, targets_that_depend_on_changed_files_are_affected )
+    {
+        const char* script =
+            "local SourceFile = TargetPrototype( 'SourceFile' ); \n"
+            "local Cc = TargetPrototype( 'Cc' ); \n"
+            "local Executable = TargetPrototype( 'Executable' ); \n"
+            "local foo_cpp = Target( forge, 'foo.cpp', SourceFile ); \n"
+            "local foo_hpp = Target( forge, 'foo.hpp', SourceFile ); \n"
+            "local foo_obj = Target( forge, 'foo.obj', Cc ); \n"
+            "local bar_obj = Target( forge, 'bar.obj', Cc ); \n"
+            "local foo_exe = Target( forge, 'foo.exe', Executable ); \n"
+            "local all = Target( forge, 'all' ); \n"
+            "foo_obj:add_dependency( foo_cpp ); \n"
+            "foo_obj:add_implicit_dependency( foo_hpp ); \n"
+            "foo_exe:add_dependency( foo_obj ); \n"
+            "foo_exe:add_dependency( bar_obj ); \n"
+            "all:add_dependency( foo_exe ); \n"
+            "local goals = affected_targets( {'foo.hpp'} ); \n"
+            "assert( #goals == 1 and goals[1] == foo_exe ); \n"
+            "assert( #affected_targets({'foo.hpp'}, true) == 4 ); \n"
+            "assert( #affected_targets({'bar.obj'}, true) == 3 ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, added_files_and_buildfiles_affect_the_targets_defined_in_their_directory )
+    {
+        const char* script =
+            "local Cc = TargetPrototype( 'Cc' ); \n"
+            "local Executable = TargetPrototype( 'Executable' ); \n"
+            "pushd( 'foo' ); \n"
+            "local foo_obj = Target( forge, 'foo.obj', Cc ); \n"
+            "local foo_exe = Target( forge, 'foo.exe', Executable ); \n"
+            "foo_exe:add_dependency( foo_obj ); \n"
+            "popd(); \n"
+            "pushd( 'bar' ); \n"
+            "local bar_obj = Target( forge, 'bar.obj', Cc ); \n"
+            "local bar_exe = Target( forge, 'bar.exe', Executable ); \n"
+            "bar_exe:add_dependency( bar_obj ); \n"
+            "popd(); \n"
+            "local goals = affected_targets( {'foo/added.cpp'} ); \n"
+            "assert( #goals == 1 and goals[1] == foo_exe ); \n"
+            "goals = affected_targets( {'bar/nested/added.hpp'} ); \n"
+            "assert( #goals == 1 and goals[1] == bar_exe ); \n"
+            "goals = affected_targets( {'bar/bar.forge'} ); \n"
+            "assert( #goals == 1 and goals[1] == bar_exe ); \n"
+            "assert( #affected_targets({'bar/bar.forge'}, true) == 2 ); \n"
+            "assert( #affected_targets({'foo/toolset.lua'}) == 2 ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, targets_are_only_outdated_by_changes_to_settings_read_when_built )
+    {
+        const char* first_script =
+            "load_binary( 'settings.forge' ); \n"
+            "forge.settings = { debug = true; strip = false; }; \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "foo:set_built( true ); \n"
+            "foo:set_settings_keys( {debug = true} ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'settings.forge' ); \n"
+            "forge.settings = { debug = true; strip = true; }; \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "postorder( foo, function() end ); \n"
+            "assert( not foo:outdated() ); \n"
+            "assert( #foo:settings_keys() == 1 and foo:settings_keys()[1] == 'debug' ); \n"
+            "foo:set_settings_keys( {debug = true; standard = true} ); \n"
+            "save_binary(); \n"
+        ;
+        const char* third_script =
+            "load_binary( 'settings.forge' ); \n"
+            "forge.settings = { debug = false; strip = true; }; \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "postorder( foo, function() end ); \n"
+            "assert( foo:outdated() ); \n"
+            "assert( #foo:settings_keys() == 2 ); \n"
+        ;
+        files_.push_back( "settings.forge" );
+        files_.push_back( "settings.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+        test( third_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, identical_commands_are_replayed_when_only_settings_change )
+    {
+        const char* first_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = true; }; \n"
+            "local Obj = TargetPrototype( 'Obj' ); \n"
+            "Obj:set_single_command( true ); \n"
+            "assert( Obj:single_command() ); \n"
+            "local foo = Target( forge, 'foo.obj', Obj ); \n"
+            "foo:set_filename( 'replay.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.obj') ~= 0 ); \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "assert( foo:fingerprint() ~= 0 ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = false; }; \n"
+            "local Obj = TargetPrototype( 'Obj' ); \n"
+            "Obj:set_single_command( true ); \n"
+            "local foo = Target( forge, 'foo.obj', Obj ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( target:outdated() ); \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.obj') == 0 ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* third_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = true; }; \n"
+            "local Obj = TargetPrototype( 'Obj' ); \n"
+            "Obj:set_single_command( true ); \n"
+            "local foo = Target( forge, 'foo.obj', Obj ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing -g foo.obj') ~= 0 ); \n"
+            "end ); \n"
+        ;
+        create( "replay.obj", "replay.obj" );
+        files_.push_back( "replay.forge" );
+        files_.push_back( "replay.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+        test( third_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, commands_are_executed_when_a_build_executes_more_commands_than_last_time )
+    {
+        const char* first_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = true; }; \n"
+            "local Exe = TargetPrototype( 'Exe' ); \n"
+            "local foo = Target( forge, 'foo.exe', Exe ); \n"
+            "foo:set_filename( 'replay.exe' ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.exe') ~= 0 ); \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = false; }; \n"
+            "local Exe = TargetPrototype( 'Exe' ); \n"
+            "local foo = Target( forge, 'foo.exe', Exe ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( target:outdated() ); \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.exe') ~= 0 ); \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing -manifest foo.exe') ~= 0 ); \n"
+            "end ); \n"
+        ;
+        create( "replay.exe", "replay.exe" );
+        files_.push_back( "replay.forge" );
+        files_.push_back( "replay.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, single_command_builds_fail_when_they_execute_another_command_after_replaying )
+    {
+        const char* first_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = true; }; \n"
+            "local Obj = TargetPrototype( 'Obj' ); \n"
+            "Obj:set_single_command( true ); \n"
+            "local foo = Target( forge, 'foo.obj', Obj ); \n"
+            "foo:set_filename( 'replay.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.obj') ~= 0 ); \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'replay.forge' ); \n"
+            "forge.settings = { debug = false; }; \n"
+            "local Obj = TargetPrototype( 'Obj' ); \n"
+            "Obj:set_single_command( true ); \n"
+            "local foo = Target( forge, 'foo.obj', Obj ); \n"
+            "postorder( foo, function(target) \n"
+            "    assert( execute('forge-replay-missing', 'forge-replay-missing foo.obj') == 0 ); \n"
+            "    execute( 'forge-replay-missing', 'forge-replay-missing -strip foo.obj' ); \n"
+            "end ); \n"
+        ;
+        create( "replay.obj", "replay.obj" );
+        files_.push_back( "replay.forge" );
+        files_.push_back( "replay.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 1 );
+    }
+
+    TEST_FIXTURE( FileChecker, resources_used_by_commands_are_recorded_with_their_targets )
+    {
+        const char* first_script =
+            "load_binary( 'usage.forge' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "foo:set_filename( 'usage.obj' ); \n"
+            "postorder( foo, function(target) \n"
+            "    local shell, arguments = '/bin/sh', 'sh -c true'; \n"
+            "    if operating_system() == 'windows' then \n"
+            "        shell, arguments = getenv('COMSPEC'), 'cmd /c exit 0'; \n"
+            "    end \n"
+            "    local exit_code, usage = execute( shell, arguments ); \n"
+            "    assert( exit_code == 0 ); \n"
+            "    assert( usage.wall_time > 0 and usage.user_time >= 0 and usage.system_time >= 0 ); \n"
+            "    target:set_built( true ); \n"
+            "end ); \n"
+            "assert( foo:usage() ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'usage.forge' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "assert( foo:usage() and foo:usage().peak_memory >= 0 ); \n"
+        ;
+        create( "usage.obj", "usage.obj" );
+        files_.push_back( "usage.forge" );
+        files_.push_back( "usage.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, simulated_builds_replay_recorded_times_under_each_policy )
+    {
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        Graph* graph = forge.graph();
+
+        // The goal depends on a 20ms job and then a chain of two 10ms jobs
+        // so the waves policy holds the chain's second job back until the
+        // 20ms job in the first wave has finished.
+        const char* ids[] = { "a", "b", "c", "all" };
+        const int64_t wall_times[] = { 10000, 10000, 20000, 0 };
+        Target* targets[4];
+        for ( int i = 0; i < 4; ++i )
+        {
+            sweet::process::Usage usage = { wall_times[i], 0, 0, 0, 0, 0 };
+            targets[i] = graph->target( ids[i] );
+            targets[i]->set_referenced_by_script( true );
+            targets[i]->set_usage( usage );
+        }
+        targets[1]->add_explicit_dependency( targets[0] );
+        targets[3]->add_explicit_dependency( targets[2] );
+        targets[3]->add_explicit_dependency( targets[1] );
+
+        Simulator simulator;
+        simulator.load( targets[3] );
+        CHECK_EQUAL( 4, simulator.jobs() );
+        CHECK_EQUAL( 40000, simulator.work() );
+        CHECK_EQUAL( 20000, simulator.critical_path() );
+        CHECK_EQUAL( 40000, simulator.simulate(SCHEDULE_WAVES, 1) );
+        CHECK_EQUAL( 30000, simulator.simulate(SCHEDULE_WAVES, 2) );
+        CHECK_EQUAL( 20000, simulator.simulate(SCHEDULE_DEPENDENCIES, 2) );
+        CHECK_EQUAL( 20000, simulator.simulate(SCHEDULE_CRITICAL_PATH, 2) );
+    }
 }
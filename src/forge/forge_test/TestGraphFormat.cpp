@@ -0,0 +1,189 @@
+//
+// TestGraphFormat.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "ErrorChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <forge/GraphFormat.hpp>
+#include <forge/GraphReader.hpp>
+#include <forge/GraphWriter.hpp>
+#include <process/Usage.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <string.h>
+#include <UnitTest++/UnitTest++.h>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::shared_ptr;
+using std::make_shared;
+using std::stringstream;
+using namespace boost::filesystem;
+using namespace sweet::forge;
+
+namespace
+{
+
+// Write a small graph with a child that has children, an implicit
+// dependency, filenames, flags, settings keys, and usage set and return the
+// bytes written.
+string write_graph( Forge* forge )
+{
+    Graph* graph = forge->graph();
+    Target* header = graph->target( "directory/header.hpp" );
+    Target* object = graph->target( "directory/object.o" );
+    object->add_filename( "/obj/object.o" );
+    object->add_filename( "/obj/object.d" );
+    object->add_implicit_dependency( header );
+    object->set_built( true );
+    object->set_fingerprint( 0xfedcba9876543210ULL );
+    shared_ptr<vector<string>> settings_keys = make_shared<vector<string>>();
+    settings_keys->push_back( "cc" );
+    settings_keys->push_back( "defines" );
+    object->set_settings_keys( settings_keys, 0x1122334455667788ULL );
+    sweet::process::Usage usage = { 12000, 8000, 2000, 4096 * 1024, 3, 4 };
+    object->set_usage( usage );
+
+    stringstream stream;
+    GraphWriter writer( &stream );
+    writer.write( graph->root_target() );
+    return stream.str();
+}
+
+// Read a graph from \e bytes returning its root Target or null if the
+// bytes aren't a valid graph.
+unique_ptr<Target> read_graph( const string& bytes, sweet::error::ErrorPolicy* error_policy )
+{
+    stringstream stream( bytes );
+    GraphReader reader( &stream, error_policy );
+    return reader.read( "test.forge" );
+}
+
+}
+
+SUITE( TestGraphFormat )
+{
+    TEST_FIXTURE( ErrorChecker, graphs_survive_writing_and_reading )
+    {
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        string bytes = write_graph( &forge );
+        unique_ptr<Target> root_target = read_graph( bytes, this );
+        CHECK( root_target.get() != nullptr );
+        if ( !root_target )
+        {
+            return;
+        }
+
+        Target* directory = root_target->find_target_by_id( "directory" );
+        CHECK( directory != nullptr );
+        if ( !directory )
+        {
+            return;
+        }
+        CHECK_EQUAL( 2u, directory->targets().size() );
+        Target* header = directory->find_target_by_id( "header.hpp" );
+        Target* object = directory->find_target_by_id( "object.o" );
+        CHECK( header != nullptr && object != nullptr );
+        if ( !header || !object )
+        {
+            return;
+        }
+
+        CHECK_EQUAL( 2u, object->filenames().size() );
+        CHECK_EQUAL( string("/obj/object.o"), object->filename(0) );
+        CHECK_EQUAL( string("/obj/object.d"), object->filename(1) );
+        CHECK_EQUAL( 1u, object->implicit_dependencies().size() );
+        CHECK( object->implicit_dependency(0) == header );
+        CHECK( object->built() );
+        CHECK( !header->built() );
+        CHECK( object->hash() == 0x1122334455667788ULL );
+        CHECK( object->fingerprint() == 0xfedcba9876543210ULL );
+
+        const vector<string>* settings_keys = object->settings_keys();
+        CHECK( settings_keys != nullptr );
+        CHECK( header->settings_keys() == nullptr );
+        if ( settings_keys )
+        {
+            CHECK_EQUAL( 2u, settings_keys->size() );
+            CHECK_EQUAL( string("cc"), settings_keys->front() );
+            CHECK_EQUAL( string("defines"), settings_keys->back() );
+        }
+
+        const sweet::process::Usage* usage = object->usage();
+        CHECK( usage != nullptr );
+        CHECK( header->usage() == nullptr );
+        if ( usage )
+        {
+            CHECK_EQUAL( 12000, usage->wall_time );
+            CHECK_EQUAL( 8000, usage->user_time );
+            CHECK_EQUAL( 2000, usage->system_time );
+            CHECK_EQUAL( 4096 * 1024, usage->peak_memory );
+            CHECK_EQUAL( 3, usage->input_blocks );
+            CHECK_EQUAL( 4, usage->output_blocks );
+        }
+    }
+
+    TEST_FIXTURE( ErrorChecker, truncated_graphs_are_rejected )
+    {
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        string bytes = write_graph( &forge );
+        CHECK( read_graph(bytes.substr(0, sizeof(GraphHeader) / 2), this) == nullptr );
+        CHECK( read_graph(bytes.substr(0, sizeof(GraphHeader)), this) == nullptr );
+        CHECK( read_graph(bytes.substr(0, bytes.size() - 1), this) == nullptr );
+    }
+
+    TEST_FIXTURE( ErrorChecker, graphs_with_out_of_range_references_are_rejected )
+    {
+        struct Corrupt
+        {
+            static string implicit_dependency( const string& bytes, uint32_t value )
+            {
+                GraphHeader header;
+                memcpy( &header, bytes.data(), sizeof(header) );
+                string corrupt = bytes;
+                for ( uint32_t i = 0; i < header.targets; ++i )
+                {
+                    size_t offset = sizeof(GraphHeader) + i * sizeof(GraphTargetRecord);
+                    GraphTargetRecord record;
+                    memcpy( &record, bytes.data() + offset, sizeof(record) );
+                    if ( record.implicit_dependencies.count > 0 )
+                    {
+                        size_t reference = sizeof(GraphHeader) + header.targets * sizeof(GraphTargetRecord) + record.implicit_dependencies.first * sizeof(uint32_t);
+                        memcpy( &corrupt[reference], &value, sizeof(value) );
+                    }
+                }
+                return corrupt;
+            }
+
+            static string record( const string& bytes, size_t field, uint32_t value )
+            {
+                string corrupt = bytes;
+                memcpy( &corrupt[sizeof(GraphHeader) + field], &value, sizeof(value) );
+                return corrupt;
+            }
+        };
+
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        string bytes = write_graph( &forge );
+        GraphHeader header;
+        memcpy( &header, bytes.data(), sizeof(header) );
+        CHECK( read_graph(bytes, this) != nullptr );
+        CHECK( read_graph(Corrupt::implicit_dependency(bytes, header.targets), this) == nullptr );
+        CHECK( read_graph(Corrupt::record(bytes, offsetof(GraphTargetRecord, id), header.strings_size), this) == nullptr );
+        CHECK( read_graph(Corrupt::record(bytes, offsetof(GraphTargetRecord, filenames) + sizeof(uint32_t), header.references + 1), this) == nullptr );
+        CHECK( read_graph(Corrupt::record(bytes, offsetof(GraphTargetRecord, targets) + sizeof(uint32_t), header.targets), this) == nullptr );
+    }
+}
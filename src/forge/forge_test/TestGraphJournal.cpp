@@ -0,0 +1,162 @@
+//
+// TestGraphJournal.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "FileChecker.hpp"
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+#include <stdint.h>
+#include <string.h>
+#include <UnitTest++/UnitTest++.h>
+
+using namespace sweet::forge;
+
+// Define enough targets that the snapshot is much larger than a journal
+// entry and so isn't compacted as soon as a single entry is appended.
+#define DEFINE_TARGETS \
+    "load_binary( 'journal.forge' ); \n" \
+    "for i = 1, 200 do Target( forge, ('padding%d.obj'):format(i) ); end \n" \
+    "local foo = Target( forge, 'foo.obj' ); \n" \
+    "local bar = Target( forge, 'bar.obj' ); \n"
+
+SUITE( TestGraphJournal )
+{
+    TEST_FIXTURE( FileChecker, journal_entries_are_replayed_onto_the_snapshot )
+    {
+        const char* first_script =
+            DEFINE_TARGETS
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            DEFINE_TARGETS
+            "foo:set_built( true ); \n"
+            "save_binary(); \n"
+        ;
+        const char* third_script =
+            DEFINE_TARGETS
+            "assert( foo:built() ); \n"
+            "assert( not bar:built() ); \n"
+        ;
+        files_.push_back( "journal.forge" );
+        files_.push_back( "journal.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        uintmax_t snapshot_size = boost::filesystem::file_size( "journal.forge" );
+        uintmax_t journal_size = boost::filesystem::file_size( "journal.forge.journal" );
+        test( second_script );
+        CHECK( errors == 0 );
+        CHECK( boost::filesystem::file_size("journal.forge") == snapshot_size );
+        CHECK( boost::filesystem::file_size("journal.forge.journal") > journal_size );
+        test( third_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, truncated_and_oversized_journal_entries_are_ignored )
+    {
+        struct Journal
+        {
+            static void append( uint32_t size, const char* bytes )
+            {
+                std::ofstream journal( "journal.forge.journal", std::ios::binary | std::ios::app );
+                journal.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+                journal.write( bytes, strlen(bytes) );
+            }
+        };
+
+        const char* first_script =
+            DEFINE_TARGETS
+            "save_binary(); \n"
+        ;
+        const char* foo_script =
+            DEFINE_TARGETS
+            "foo:set_built( true ); \n"
+            "save_binary(); \n"
+        ;
+        const char* bar_script =
+            DEFINE_TARGETS
+            "assert( foo:built() ); \n"
+            "bar:set_built( true ); \n"
+            "save_binary(); \n"
+        ;
+        const char* truncated_script =
+            DEFINE_TARGETS
+            "assert( foo:built() ); \n"
+            "assert( not bar:built() ); \n"
+        ;
+        const char* check_script =
+            DEFINE_TARGETS
+            "assert( foo:built() ); \n"
+            "assert( bar:built() ); \n"
+        ;
+        files_.push_back( "journal.forge" );
+        files_.push_back( "journal.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( foo_script );
+        CHECK( errors == 0 );
+        uintmax_t journal_size = boost::filesystem::file_size( "journal.forge.journal" );
+        test( bar_script );
+        CHECK( errors == 0 );
+
+        // Cut the entry for bar short as if the build was interrupted while
+        // appending it.  It is ignored and cut from the journal so that the
+        // entry appended for bar next time is replayed.
+        boost::filesystem::resize_file( "journal.forge.journal", boost::filesystem::file_size("journal.forge.journal") - 1 );
+        test( truncated_script );
+        CHECK( errors == 0 );
+        CHECK( boost::filesystem::file_size("journal.forge.journal") == journal_size );
+        test( bar_script );
+        CHECK( errors == 0 );
+        test( check_script );
+        CHECK( errors == 0 );
+
+        // An entry claiming to be larger than the rest of the file is ignored
+        // without trying to read it.
+        Journal::append( 0xfffffff0, "garbage" );
+        test( check_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, large_journals_are_compacted_into_the_snapshot )
+    {
+        const char* first_script =
+            "load_binary( 'journal.forge' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script =
+            "load_binary( 'journal.forge' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "for i = 1, 8 do \n"
+            "    foo:set_built( i % 2 == 0 ); \n"
+            "    save_binary(); \n"
+            "end \n"
+        ;
+        const char* third_script =
+            "load_binary( 'journal.forge' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "assert( foo:built() ); \n"
+        ;
+        files_.push_back( "journal.forge" );
+        files_.push_back( "journal.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        uintmax_t empty_journal_size = boost::filesystem::file_size( "journal.forge.journal" );
+        test( second_script );
+        CHECK( errors == 0 );
+        CHECK( boost::filesystem::file_size("journal.forge.journal") > boost::filesystem::file_size("journal.forge") / 4 );
+
+        // Loading compacts the journal into the snapshot by writing it to a
+        // temporary file and renaming it into place.  The state survives
+        // with the journal removed.
+        test( third_script );
+        CHECK( errors == 0 );
+        CHECK( boost::filesystem::file_size("journal.forge.journal") == empty_journal_size );
+        CHECK( !boost::filesystem::exists("journal.forge.tmp") );
+        boost::filesystem::remove( "journal.forge.journal" );
+        test( third_script );
+        CHECK( errors == 0 );
+    }
+}
@@ -0,0 +1,173 @@
+//
+// TestHash.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "FileChecker.hpp"
+#include <forge/Forge.hpp>
+#include <forge/Graph.hpp>
+#include <forge/Target.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <UnitTest++/UnitTest++.h>
+
+using namespace boost::filesystem;
+using namespace sweet::forge;
+
+SUITE( TestHash )
+{
+    TEST_FIXTURE( ErrorChecker, hashes_are_cached_until_invalidated )
+    {
+        const char* script = 
+            "local settings = { a = 1; b = 'b'; c = { 'x', 'y' } }; \n"
+            "local first = hash( settings ); \n"
+            "settings.a = 2; \n"
+            "assert( hash(settings) == first ); \n"
+            "invalidate_hashes(); \n"
+            "local second = hash( settings ); \n"
+            "assert( second ~= first ); \n"
+            "settings.c[2] = 'z'; \n"
+            "invalidate_hashes(); \n"
+            "assert( hash(settings) ~= second ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, hashes_include_inherited_settings )
+    {
+        const char* script = 
+            "local parent = { a = 1 }; \n"
+            "local child = setmetatable( { b = 2 }, {__index = parent} ); \n"
+            "local first = hash( child ); \n"
+            "parent.a = 2; \n"
+            "invalidate_hashes(); \n"
+            "assert( hash(child) ~= first ); \n"
+            "assert( hash({a = 1, b = 2}) == hash({b = 2, a = 1}) ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, assigning_settings_invalidates_cached_hashes )
+    {
+        const char* script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "local settings = forge.Settings { a = 1 }; \n"
+            "local child = settings:inherit { b = 2 }; \n"
+            "local first = hash( child ); \n"
+            "settings.a = 2; \n"
+            "local second = hash( child ); \n"
+            "assert( second ~= first ); \n"
+            "child.b = 3; \n"
+            "assert( hash(child) ~= second ); \n"
+            "child.b = 2; \n"
+            "assert( hash(child) == second ); \n"
+            "assert( settings.a == 2 and child.a == 2 and child.b == 2 ); \n"
+            "local keys = {}; \n"
+            "for key, value in pairs(child) do keys[#keys + 1] = key; end \n"
+            "assert( #keys == 1 and keys[1] == 'b' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, changing_nested_settings_invalidates_cached_hashes )
+    {
+        const char* script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "local settings = forge.Settings { gcc = { environment = { X = 'x' } }; defines = { 'A' } }; \n"
+            "local environment = settings.gcc.environment; \n"
+            "local first = hash( settings ); \n"
+            "environment.X = 'y'; \n"
+            "local second = hash( settings ); \n"
+            "assert( second ~= first ); \n"
+            "table.insert( settings.defines, 'B' ); \n"
+            "assert( #settings.defines == 2 and settings.defines[2] == 'B' ); \n"
+            "local third = hash( settings ); \n"
+            "assert( third ~= second ); \n"
+            "settings.libraries = { 'foo' }; \n"
+            "local fourth = hash( settings ); \n"
+            "settings.libraries[1] = 'bar'; \n"
+            "assert( hash(settings) ~= fourth ); \n"
+            "local values = { b = 2 }; \n"
+            "local child = settings:inherit( values ); \n"
+            "assert( child == values ); \n"
+            "local fifth = hash( child ); \n"
+            "values.b = 3; \n"
+            "assert( hash(child) ~= fifth ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( FileChecker, changing_nested_settings_outdates_targets_created_afterwards )
+    {
+        const char* first_script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "load_binary( 'hash.forge' ); \n"
+            "forge.settings = forge.Settings { gcc = { environment = { X = 'x' } } }; \n"
+            "local bar = Target( forge, 'bar.obj' ); \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "postorder( bar, function() end ); \n"
+            "postorder( foo, function() end ); \n"
+            "bar:set_built( true ); \n"
+            "foo:set_built( true ); \n"
+            "save_binary(); \n"
+        ;
+        const char* second_script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "load_binary( 'hash.forge' ); \n"
+            "forge.settings = forge.Settings { gcc = { environment = { X = 'x' } } }; \n"
+            "local bar = Target( forge, 'bar.obj' ); \n"
+            "forge.settings.gcc.environment.X = 'y'; \n"
+            "local foo = Target( forge, 'foo.obj' ); \n"
+            "postorder( bar, function() end ); \n"
+            "postorder( foo, function() end ); \n"
+            "assert( not bar:outdated() ); \n"
+            "assert( foo:outdated() ); \n"
+        ;
+        files_.push_back( "hash.forge" );
+        files_.push_back( "hash.forge.journal" );
+        test( first_script );
+        CHECK( errors == 0 );
+        test( second_script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, assigning_settings_changes_the_hashes_of_targets_created_afterwards )
+    {
+        const char* script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "local Parent = ToolsetPrototype( 'Parent' ); \n"
+            "local toolset = Parent { identifier = 'parent'; a = 1 }; \n"
+            "Target( toolset, 'first' ); \n"
+            "Target( toolset, 'unchanged' ); \n"
+            "toolset.settings.a = 2; \n"
+            "Target( toolset, 'second' ); \n"
+        ;
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        forge.set_root_directory( path.generic_string() );
+        forge.script( script );
+        CHECK( errors == 0 );
+        Target* first = forge.graph()->target( (path / "first").generic_string() );
+        Target* unchanged = forge.graph()->target( (path / "unchanged").generic_string() );
+        Target* second = forge.graph()->target( (path / "second").generic_string() );
+
+        // Hashes set when targets are created are pending until the targets
+        // are bound.
+        first->bind_to_file();
+        unchanged->bind_to_file();
+        second->bind_to_file();
+        CHECK( first->hash() != 0 );
+        CHECK( first->hash() == unchanged->hash() );
+        CHECK( first->hash() != second->hash() );
+    }
+}
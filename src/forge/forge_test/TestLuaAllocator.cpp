@@ -0,0 +1,107 @@
+//
+// TestLuaAllocator.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include <luaxx/LuaAllocator.hpp>
+#include <vector>
+#include <string.h>
+#include <UnitTest++/UnitTest++.h>
+
+using std::vector;
+using namespace sweet::luaxx;
+
+SUITE( TestLuaAllocator )
+{
+    TEST( blocks_are_counted_in_their_size_classes )
+    {
+        const size_t UNPOOLED = LuaAllocator::SIZE_CLASSES - 1;
+        LuaAllocator allocator;
+        void* block = allocator.reallocate( nullptr, 0, 10 );
+        CHECK( block != nullptr );
+        CHECK_EQUAL( 10u, allocator.live_bytes() );
+        CHECK_EQUAL( 1u, allocator.size_class(0).live );
+
+        memset( block, 'x', 10 );
+        block = allocator.reallocate( block, 10, 100 );
+        CHECK( block != nullptr && memcmp(block, "xxxxxxxxxx", 10) == 0 );
+        CHECK_EQUAL( 100u, allocator.live_bytes() );
+        CHECK_EQUAL( 0u, allocator.size_class(0).live );
+        CHECK_EQUAL( 1u, allocator.size_class(6).live );
+
+        block = allocator.reallocate( block, 100, 1000 );
+        CHECK( block != nullptr && memcmp(block, "xxxxxxxxxx", 10) == 0 );
+        CHECK_EQUAL( 1000u, allocator.live_bytes() );
+        CHECK_EQUAL( 1u, allocator.size_class(UNPOOLED).live );
+
+        allocator.reallocate( block, 1000, 0 );
+        CHECK_EQUAL( 0u, allocator.live_bytes() );
+        CHECK_EQUAL( 1100u, allocator.peak_bytes() );
+        CHECK_EQUAL( 3u, allocator.allocations() );
+        CHECK_EQUAL( 0u, allocator.size_class(UNPOOLED).live );
+    }
+
+    TEST( allocations_over_the_limit_fail )
+    {
+        LuaAllocator allocator;
+        allocator.set_limit( 1000 );
+        CHECK( allocator.reallocate(nullptr, 0, 16) == nullptr );
+        CHECK( allocator.reallocate(nullptr, 0, 2000) == nullptr );
+        void* block = allocator.reallocate( nullptr, 0, 1000 );
+        CHECK( block != nullptr );
+        CHECK( allocator.reallocate(block, 1000, 1001) == nullptr );
+        allocator.reallocate( block, 1000, 0 );
+        CHECK_EQUAL( 0u, allocator.live_bytes() );
+    }
+
+    TEST( shrinking_never_fails_when_a_smaller_block_cant_be_allocated )
+    {
+        const size_t UNPOOLED = LuaAllocator::SIZE_CLASSES - 1;
+        const size_t LARGEST = LuaAllocator::SIZE_CLASSES - 2;
+        const size_t SIZE = LuaAllocator::MAXIMUM_POOLED_SIZE;
+        LuaAllocator allocator;
+        allocator.set_limit( LuaAllocator::CHUNK_SIZE + 1000 );
+
+        void* unpooled = allocator.reallocate( nullptr, 0, 1000 );
+        CHECK( unpooled != nullptr );
+        memset( unpooled, 'x', 1000 );
+
+        // Fill a chunk with the largest pooled blocks so that the next
+        // pooled block needs another chunk, which the limit prevents.
+        vector<void*> blocks;
+        for ( size_t i = 0; i < LuaAllocator::CHUNK_SIZE / SIZE; ++i )
+        {
+            blocks.push_back( allocator.reallocate(nullptr, 0, SIZE) );
+            CHECK( blocks.back() != nullptr );
+        }
+        CHECK( allocator.reallocate(nullptr, 0, SIZE) == nullptr );
+
+        // Shrinking into the full size class keeps the block where it is
+        // and in its current size class.
+        void* block = allocator.reallocate( unpooled, 1000, SIZE );
+        CHECK( block == unpooled );
+        CHECK( memcmp(block, "xxxxxxxxxx", 10) == 0 );
+        CHECK_EQUAL( 1u, allocator.size_class(UNPOOLED).live );
+        CHECK_EQUAL( blocks.size(), allocator.size_class(LARGEST).live );
+        CHECK_EQUAL( SIZE * (blocks.size() + 1), allocator.live_bytes() );
+
+        // Freeing a pooled block lets the shrunk block move into its size
+        // class when it is next reallocated.
+        allocator.reallocate( blocks.back(), SIZE, 0 );
+        blocks.pop_back();
+        block = allocator.reallocate( block, SIZE, SIZE - 1 );
+        CHECK( block != nullptr && block != unpooled );
+        CHECK( memcmp(block, "xxxxxxxxxx", 10) == 0 );
+        CHECK_EQUAL( 0u, allocator.size_class(UNPOOLED).live );
+        CHECK_EQUAL( blocks.size() + 1, allocator.size_class(LARGEST).live );
+
+        allocator.reallocate( block, SIZE - 1, 0 );
+        for ( vector<void*>::const_iterator i = blocks.begin(); i != blocks.end(); ++i )
+        {
+            allocator.reallocate( *i, SIZE, 0 );
+        }
+        CHECK_EQUAL( 0u, allocator.live_bytes() );
+        CHECK_EQUAL( 0u, allocator.size_class(LARGEST).live );
+    }
+}
@@ -3,8 +3,16 @@
 #include "ErrorChecker.hpp"
 #include <forge/Forge.hpp>
 #include <forge/ForgeEventSink.hpp>
+#include <forge/Profiler.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <string>
+#include <vector>
 #include <UnitTest++/UnitTest++.h>
 
+using std::string;
+using std::vector;
+using namespace boost::filesystem;
 using namespace sweet::forge;
 
 SUITE( TestPostorder )
@@ -69,4 +77,57 @@ SUITE( TestPostorder )
         }
         CHECK( errors == 2 );
     }
+
+    TEST_FIXTURE( ErrorChecker, postorder_and_nested_phases_are_timed_once_per_outermost_phase )
+    {
+        const char* script = 
+            "local Phased = TargetPrototype( 'Phased' ); \n"
+            "local phased = Target( forge, 'phased', Phased ); \n"
+            "postorder( phased, function(target) \n"
+            "    begin_phase( 'visit' ); \n"
+            "    begin_phase( 'visit' ); \n"
+            "    add_counter( 'visits' ); \n"
+            "    add_counter( 'visits', 2 ); \n"
+            "    end_phase( 'visit' ); \n"
+            "    end_phase( 'visit' ); \n"
+            "end ); \n"
+            "local times = {}; \n"
+            "for _, phase in ipairs(phases()) do times[phase.name] = phase; end \n"
+            "local totals = {}; \n"
+            "for _, counter in ipairs(counters()) do totals[counter.name] = counter.total; end \n"
+            "assert( times.postorder.count == 1 ); \n"
+            "assert( times.visit.count == 1 ); \n"
+            "assert( times.visit.milliseconds <= times.postorder.milliseconds ); \n"
+            "assert( totals.visits == 3 ); \n"
+            "assert( totals.jobs == 1 ); \n"
+            "assert( not pcall(end_phase, 'visit') ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, lua_in_postorder_visits_is_sampled_by_function )
+    {
+        const char* script = 
+            "local Profiled = TargetPrototype( 'Profiled' ); \n"
+            "local profiled = Target( forge, 'profiled', Profiled ); \n"
+            "local function spin() local total = 0; for i = 1, 10000 do total = total + i; end return total; end \n"
+            "postorder( profiled, function(target) spin(); end ); \n"
+        ;
+        path path = initial_path<boost::filesystem::path>();
+        Forge forge( path.string(), *this, this );
+        forge.set_root_directory( path.generic_string() );
+        forge.profiler()->start( string(), 100 );
+        forge.script( string(script) );
+        CHECK( errors == 0 );
+        CHECK( forge.profiler()->samples() > 0 );
+
+        bool sampled_spin = false;
+        vector<Profiler::Function> functions = forge.profiler()->functions();
+        for ( vector<Profiler::Function>::const_iterator i = functions.begin(); i != functions.end(); ++i )
+        {
+            sampled_spin = sampled_spin || (i->name.find("spin") == 0 && i->self > 0);
+        }
+        CHECK( sampled_spin );
+    }
 }
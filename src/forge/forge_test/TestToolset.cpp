@@ -0,0 +1,112 @@
+//
+// TestToolset.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "stdafx.hpp"
+#include "ErrorChecker.hpp"
+#include <UnitTest++/UnitTest++.h>
+
+using namespace sweet::forge;
+
+SUITE( TestToolset )
+{
+    TEST_FIXTURE( ErrorChecker, interpolate_substitutes_variables_settings_fields_and_globals )
+    {
+        const char* script = 
+            "local toolset = setmetatable( { \n"
+            "    settings = { obj = '/obj'; architecture = 'x86_64'; nested = 'architecture'; flags = { debug = '-g' } }; \n"
+            "    join = function( toolset, a, b ) return a..'+'..b; end; \n"
+            "}, {__index = Toolset} ); \n"
+            "interpolate_global = 'global'; \n"
+            "assert( toolset:interpolate('main.cpp') == 'main.cpp' ); \n"
+            "assert( toolset:interpolate('${obj}/%1') == '/obj/%1' ); \n"
+            "assert( toolset:interpolate('${obj}/${obj}') == '/obj//obj' ); \n"
+            "assert( toolset:interpolate('${obj}', {obj = '/variables'}) == '/variables' ); \n"
+            "assert( toolset:interpolate('${architecture}', {obj = '/variables'}) == 'x86_64' ); \n"
+            "assert( toolset:interpolate('${${nested}}') == 'x86_64' ); \n"
+            "assert( toolset:interpolate('${join ${obj} b}') == '/obj+b' ); \n"
+            "assert( toolset:interpolate('${flags debug}') == '-g' ); \n"
+            "assert( toolset:interpolate('${interpolate_global}') == 'global' ); \n"
+            "assert( toolset:interpolate('$${obj} ${obj') == '$/obj ${obj' ); \n"
+            "assert( not pcall(toolset.interpolate, toolset, '${missing}') ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, interpolate_raises_errors_from_substitutions )
+    {
+        const char* script = 
+            "local toolset = setmetatable( { \n"
+            "    settings = { obj = '/obj'; flag = true }; \n"
+            "    fail = function( toolset ) error( 'failed substitution', 0 ); end; \n"
+            "    inner = function( toolset ) return toolset:interpolate( '${missing}' ); end; \n"
+            "}, {__index = Toolset} ); \n"
+            "for i = 1, 100 do \n"
+            "    local ok, message = pcall( toolset.interpolate, toolset, '${obj}/${missing} '..i ); \n"
+            "    assert( not ok and message:find('Missing substitute for \"missing\"', 1, true) ); \n"
+            "end \n"
+            "local ok, message = pcall( toolset.interpolate, toolset, '${obj}/${fail}' ); \n"
+            "assert( not ok and message == 'failed substitution' ); \n"
+            "ok, message = pcall( toolset.interpolate, toolset, '${${fail}}' ); \n"
+            "assert( not ok and message == 'failed substitution' ); \n"
+            "ok, message = pcall( toolset.interpolate, toolset, '${inner}' ); \n"
+            "assert( not ok and message:find('Missing substitute for \"missing\"', 1, true) ); \n"
+            "ok, message = pcall( toolset.interpolate, toolset, '${flag}' ); \n"
+            "assert( not ok and message:find('invalid replacement value', 1, true) ); \n"
+            "assert( toolset:interpolate('${obj}/%1') == '/obj/%1' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, inherited_and_cloned_toolsets_convert_to_the_toolset_they_inherit_from )
+    {
+        const char* script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "local Parent = ToolsetPrototype( 'Parent' ); \n"
+            "local toolset = Parent { identifier = 'parent' }; \n"
+            "local inherited = toolset:inherit( {} ); \n"
+            "local cloned = inherited:clone( {} ); \n"
+            "assert( Toolset.id(toolset) == 'parent' ); \n"
+            "assert( Toolset.id(inherited) == 'parent' ); \n"
+            "assert( Toolset.id(cloned) == 'parent' ); \n"
+            "assert( not pcall(Toolset.id, {}) ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+
+    TEST_FIXTURE( ErrorChecker, pattern_targets_share_attributes_until_they_are_added_to )
+    {
+        const char* script = 
+            "package.path = '" TEST_DIRECTORY "../lua/?.lua;" TEST_DIRECTORY "../lua/?/init.lua'; \n"
+            "require 'forge'; \n"
+            "local toolset = setmetatable( {settings = {}}, {__index = Toolset} ); \n"
+            "local Object = PatternPrototype( 'Object' ); \n"
+            "local objects = Object( toolset, '%1.o' ) { \n"
+            "    defines = { 'A', 'B' }; \n"
+            "    'foo.cpp', 'bar.cpp', 'baz.cpp', 'qux.cpp'; \n"
+            "}; \n"
+            "local foo_o, bar_o, baz_o = objects[1], objects[2], objects[3]; \n"
+            "assert( foo_o.defines ~= bar_o.defines ); \n"
+            "assert( #foo_o.defines == 2 and foo_o.defines[2] == 'B' ); \n"
+            "table.insert( foo_o.defines, 'C' ); \n"
+            "assert( table.concat(foo_o.defines, ',') == 'A,B,C' ); \n"
+            "assert( table.concat(bar_o.defines, ',') == 'A,B' ); \n"
+            "bar_o.defines[1] = 'X'; \n"
+            "assert( table.concat(foo_o.defines, ',') == 'A,B,C' ); \n"
+            "assert( table.concat(bar_o.defines, ',') == 'X,B' ); \n"
+            "forge:merge( baz_o, {defines = { 'D' }} ); \n"
+            "assert( table.concat(baz_o.defines, ',') == 'A,B,D' ); \n"
+            "assert( table.concat(bar_o.defines, ',') == 'X,B' ); \n"
+            "local defines = {}; \n"
+            "for _, define in ipairs(objects[4].defines) do table.insert( defines, define ); end \n"
+            "assert( table.concat(defines, ',') == 'A,B' ); \n"
+        ;
+        test( script );
+        CHECK( errors == 0 );
+    }
+}
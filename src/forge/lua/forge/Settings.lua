@@ -16,6 +16,60 @@ local function apply( destination, source )
     return destination;
 end
 
+-- Tables that are watched for changes by `watch()`.
+local watched = setmetatable( {}, {__mode = 'k'} );
+
+local watch;
+
+-- Watch *value* for changes if it is a plain table nested in settings.
+local function watch_nested( value )
+    if type(value) == 'table' and not watched[value] and getmetatable(value) == nil then
+        watch( value );
+    end
+end
+
+-- Watch *values* and the plain tables nested in it for changes, in place.
+--
+-- The fields of *values* are moved to a new table, which also takes over 
+-- the metatable of *values*, leaving *values* empty so that every 
+-- assignment to it, not just those that add fields, goes through 
+-- `__newindex` and discards the hashes cached by `hash()` before they go
+-- stale.  Reads go through `__index`, `#` through `__len`, and `pairs()` 
+-- through `__pairs` to the moved fields.  Tables nested in *values* are 
+-- watched in the same way when they're added so that changes to them, e.g.
+-- `settings.gcc.environment.PATH = path`, are seen too.  References to 
+-- *values* and nested tables held elsewhere keep working as they are the
+-- same tables.
+function watch( values )
+    local fields = setmetatable( {}, getmetatable(values) );
+    for key, value in next, values do
+        rawset( fields, key, value );
+    end
+    for key in next, fields do
+        rawset( values, key, nil );
+    end
+    setmetatable( values, {
+        __index = fields;
+        __newindex = function( _, key, value )
+            watch_nested( value );
+            rawset( fields, key, value );
+            invalidate_hashes();
+        end;
+        __len = function()
+            return rawlen( fields );
+        end;
+        __pairs = function()
+            return next, fields, nil;
+        end;
+    } );
+    watched[values] = true;
+    for _, value in next, fields do
+        watch_nested( value );
+    end
+    invalidate_hashes();
+    return values;
+end
+
 function Settings.create( self, values )
     local values = values or forge.local_settings;
     apply( self, values );
@@ -30,9 +84,9 @@ function Settings.clone( self, values )
 end
 
 function Settings.inherit( self, values )
-    local settings = values or {};
-    setmetatable( settings, {__index = self} );
-    return settings;
+    local values = values or {};
+    setmetatable( values, {__index = self} );
+    return watch( values );
 end
 
 function Settings.apply( self, values )
@@ -55,8 +109,7 @@ local settings_metatable = {
 
 setmetatable( Settings, {
     __call = function ( _, values )
-        local settings = {};
-        setmetatable( settings, settings_metatable );
+        local settings = watch( setmetatable({}, settings_metatable) );
         return settings:create( values );
     end
 } );
@@ -82,45 +82,8 @@ function Toolset:install( toolset_prototype )
     end
 end
 
--- Provide GNU Make like string substitution.
-function Toolset:interpolate( template, variables )
-    local function split( input )
-        local output = {};
-        for value in input:gmatch('%S+') do 
-            table.insert( output, value );
-        end
-        return output;
-    end
-
-    local settings = self.settings;
-    local variables = variables or settings;
-    local interpolate = self.interpolate;
-    return (template:gsub('%$(%b{})', function(word) 
-        local parameters = split( interpolate(self, word:sub(2, -2), variables) );
-        local identifier = parameters[1];
-        local index = 1;
-        local substitute = variables and variables[identifier];
-        if not substitute then 
-            substitute = settings and settings[identifier];
-        end
-        if not substitute then
-            substitute = self[identifier];
-        end
-        if not substitute then 
-            substitute = _G[identifier]
-        end
-        if not substitute then 
-            substitute = os.getenv( identifier );
-        end
-        if type(substitute) == 'function' then 
-            substitute = substitute( self, table.unpack(parameters, 2) );
-        elseif type(substitute) == 'table' then
-            substitute = substitute[parameters[2]];
-        end
-        assertf( substitute, 'Missing substitute for "%s" in "%s"', identifier, template );
-        return substitute or word;
-    end));
-end
+-- GNU Make like string substitution is provided by `Toolset.interpolate()`
+-- natively (see `LuaToolset::interpolate()`).
 
 -- Add dependencies detected by the injected build hooks library to the 
 -- target /target/.
@@ -22,34 +22,13 @@ end
 -- duplicate libraries preserving the most recently added duplicates at the
 -- end of the list.
 --
+-- The walk is done natively by `transitive_libraries()` which memoizes the
+-- static libraries reached from each library for the rest of the build.
+--
 -- Returns the list of static libraries to link with this executable.
 function Executable.find_transitive_libraries( target )
     local toolset = target.toolset;
-    local function is_static_library( target ) 
-        return target:prototype() == toolset.StaticLibrary; 
-    end
-
-    local all_libraries = {};
-    local index_by_library = {};
-    for _, dependency in walk_dependencies(target) do
-        local prototype = dependency:prototype();
-        if prototype == toolset.StaticLibrary or prototype == toolset.DynamicLibrary then
-            table.insert( all_libraries, dependency );
-            index_by_library[dependency] = #all_libraries;
-            for _, dependency in walk_ordering_dependencies(dependency, is_static_library, is_static_library) do
-                table.insert( all_libraries, dependency );
-                index_by_library[dependency] = #all_libraries;
-            end
-        end
-    end
-
-    local libraries = {};
-    for index, library in ipairs(all_libraries) do
-        if index == index_by_library[library] then
-            table.insert( libraries, library );
-        end
-    end
-    return libraries;
+    return transitive_libraries( target, toolset.StaticLibrary, toolset.DynamicLibrary );
 end
 
 return Executable;
@@ -27,18 +27,22 @@ function clang.initialize( toolset )
     local Cc = PatternPrototype( 'Cc', clang.object_filename );
     Cc.language = 'c';
     Cc.build = clang.compile;
+    Cc:set_single_command( true );
 
     local Cxx = PatternPrototype( 'Cxx', clang.object_filename );
     Cxx.language = 'c++';
     Cxx.build = clang.compile;
+    Cxx:set_single_command( true );
 
     local ObjC = PatternPrototype( 'ObjC', clang.object_filename );
     ObjC.language = 'objective-c';
     ObjC.build = clang.compile;
+    ObjC:set_single_command( true );
 
     local ObjCxx = PatternPrototype( 'ObjCxx', clang.object_filename );
     ObjCxx.language = 'objective-c++';
     ObjCxx.build = clang.compile;
+    ObjCxx:set_single_command( true );
 
     toolset.static_library_filename = clang.static_library_filename;
     toolset.dynamic_library_filename = clang.dynamic_library_filename;
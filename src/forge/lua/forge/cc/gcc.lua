@@ -32,10 +32,12 @@ function gcc.initialize( toolset )
     local Cc = PatternPrototype( 'Cc', gcc.object_filename );
     Cc.language = 'c';
     Cc.build = gcc.compile;
+    Cc:set_single_command( true );
 
     local Cxx = PatternPrototype( 'Cxx', gcc.object_filename );
     Cxx.language = 'c++';
     Cxx.build = gcc.compile;
+    Cxx:set_single_command( true );
 
     toolset.static_library_filename = gcc.static_library_filename;
     toolset.dynamic_library_filename = gcc.dynamic_library_filename;
@@ -36,30 +36,109 @@ local function clean_visit( target )
     end
 end
 
+-- Return a view of *toolset* that records the names of the settings read 
+-- through it and a function that returns those names as the keys of a 
+-- table.  The function returns nil if the settings were enumerated or 
+-- indexed by anything other than strings as those reads can't be recorded
+-- by name.
+local function settings_tracking_toolset( toolset )
+    local settings = toolset.settings;
+    local keys = {};
+    local tracking_settings = setmetatable( {}, {
+        __index = function( _, key )
+            if type(key) == 'string' then
+                if keys then
+                    keys[key] = true;
+                end
+            else
+                keys = nil;
+            end
+            return settings[key];
+        end;
+        __newindex = settings;
+        __pairs = function()
+            keys = nil;
+            return pairs( settings );
+        end;
+    } );
+    local tracking_toolset = setmetatable( {
+        settings = tracking_settings;
+        __toolset = toolset;
+    }, {
+        __index = toolset;
+    } );
+    return tracking_toolset, function() return keys; end;
+end
+
 -- Visit a target by calling a member function "build" if it exists and 
 -- setting that Target's built flag to true if the function returns with
 -- no errors.
+--
+-- Build functions are passed a view of their toolset that records the 
+-- settings that they read.  The target's hash is then calculated from just
+-- those settings so that changing settings that a target's build didn't 
+-- read doesn't make it outdated.  Targets without build functions don't 
+-- read any settings.
 local function build_visit( target )
     if target:outdated() then
         local build_function = target.build;
         if build_function then 
-            local success, error_message = pcall( build_function, target.toolset, target );
+            local toolset, settings_keys = target.toolset, nil;
+            if toolset and type(toolset.settings) == 'table' then
+                toolset, settings_keys = settings_tracking_toolset( toolset );
+            end
+            local success, error_message = pcall( build_function, toolset, target );
             target:set_built( success );
             if not success then 
                 clean_visit( target );
                 assert( success, error_message );
             end
+            target:set_settings_keys( settings_keys and settings_keys() );
         else
             target:set_built( true );
+            target:set_settings_keys( {} );
         end
     end
 end
 
+-- Print the memory used by the Lua heap when it is available.
+local function print_lua_memory()
+    local memory = lua_memory();
+    if memory then 
+        printf( "forge: lua memory live=%dKB peak=%dKB reserved=%dKB allocations=%d", 
+            math.ceil(memory.live / 1024), 
+            math.ceil(memory.peak / 1024), 
+            math.ceil(memory.reserved / 1024),
+            memory.allocations
+        );
+    end
+end
+
+-- Print the wall-clock time spent in each phase, as a share of the time
+-- elapsed so far, followed by the totals of each counter.  Phases nest so
+-- shares may add up to more than 100%.
+local function print_phases()
+    local elapsed = math.max( ticks(), 1 );
+    for _, phase in ipairs(phases()) do
+        printf( "forge: phase %-16s %9.1fms %5.1f%% %6d", 
+            phase.name, 
+            phase.milliseconds, 
+            100 * phase.milliseconds / elapsed, 
+            phase.count
+        );
+    end
+    for _, counter in ipairs(counters()) do
+        printf( "forge: counter %-14s %9d", counter.name, counter.total );
+    end
+end
+
 -- Provide global build command.
 function build()
     local failures = postorder( find_initial_target(goal), build_visit );
     forge:save();
     printf( "forge: default (build)=%dms", math.ceil(ticks()) );
+    print_phases();
+    print_lua_memory();
     return failures;
 end
 
@@ -68,6 +147,7 @@ function clean()
     local failures = postorder( find_initial_target(goal), clean_visit );
     forge:save();
     printf( "forge: clean=%sms", tostring(math.ceil(ticks())) );
+    print_phases();
     return failures;
 end
 
@@ -89,18 +169,117 @@ function namespace()
     return 0;
 end
 
+-- Read the paths of changed files, one per line, from the file named by
+-- the `changed` variable or from stdin when `changed` isn't set (e.g. the 
+-- output of `git diff --name-only`).  Relative paths are relative to the
+-- initial working directory.
+local function changed_paths()
+    local paths = {};
+    local lines = changed and io.lines( changed ) or io.stdin:lines();
+    for line in lines do
+        if line ~= '' then
+            table.insert( paths, initial(line) );
+        end
+    end
+    return paths;
+end
+
+-- Provide global affected command.
+function affected()
+    for _, target in ipairs(affected_targets(changed_paths())) do
+        print( target:path() );
+    end
+    return 0;
+end
+
+-- Provide global build_affected command.
+function build_affected()
+    local failures = 0;
+    for _, target in ipairs(affected_targets(changed_paths())) do
+        failures = failures + postorder( target, build_visit );
+    end
+    forge:save();
+    printf( "forge: build_affected=%dms", math.ceil(ticks()) );
+    print_phases();
+    print_lua_memory();
+    return failures;
+end
+
+-- Provide global explain command.
+function explain()
+    print_explanation( find_initial_target(goal) );
+    return 0;
+end
+
+-- Provide global stats command.  The goal is traversed without building so
+-- that the times taken to bind and traverse it are included.  Statistics 
+-- are printed once the command finishes when the `statistics` variable is
+-- set so they're not printed here too.
+function stats()
+    postorder( find_initial_target(goal), function() end );
+    if not statistics then
+        print_statistics();
+    end
+    return 0;
+end
+
+-- Provide global usage command.  Targets are listed from the whole graph
+-- unless a goal is given as the files built for the initial directory are
+-- usually elsewhere in the target namespace.
+function usage()
+    print_usage( goal and find_initial_target(goal) or nil, tonumber(top) );
+    return 0;
+end
+
+-- Provide global simulate command.  The numbers of processors simulated 
+-- are read from the comma separated `processors` variable when it is set 
+-- (e.g. `processors=4,8,16`).
+function simulate()
+    local counts = nil;
+    if processors then
+        counts = {};
+        for count in tostring(processors):gmatch('%d+') do
+            table.insert( counts, tonumber(count) );
+        end
+    end
+    print_simulation( find_initial_target(goal), counts );
+    return 0;
+end
+
+-- Provide global gc command.
+function gc()
+    print_stale_targets();
+    remove_stale_targets();
+    forge:save();
+    return 0;
+end
+
 -- Provide global help command.
 function help()
     printf [[
 Variables:
   goal               Target to build (relative to current working directory).
   variant            Variant built (debug, release, or shipping).
+  changed            File listing changed paths (affected commands, default stdin).
+  trace              File to write a Chrome trace of the build to.
+  profile            File to write folded stacks of sampled Lua to.
+  statistics         File to write build statistics to as JSON.
+  progress           Report progress while building (default true).
+  processors         Processors simulated by simulate (e.g. 4,8,16).
+  top                Number of targets listed by usage (default 10).
 Commands:
   build              Build outdated targets.
   clean              Clean all targets.
   reconfigure        Regenerate per-machine configuration settings.
   dependencies       Print targets by dependency hierarchy.
   namespace          Print targets by namespace hierarchy.
+  explain            Print why the goal is outdated.
+  gc                 Remove stale targets from the dependency graph.
+  usage              Print targets that used the most time and memory.
+  stats              Print graph, memory, file system, and job statistics.
+  simulate           Print simulated build times under scheduling policies.
+  affected           Print goals affected by changed paths.
+  build_affected     Build goals affected by changed paths.
     ]];
 end
 
@@ -283,6 +462,38 @@ function JavaStylePrototype( identifier, pattern )
     return java_style_prototype;
 end
 
+-- Metatables of the copy-on-write views of attribute tables shared between
+-- the targets created by one call to a pattern prototype.
+local shared_attributes_metatables = setmetatable( {}, {__mode = 'k'} );
+
+-- Return a metatable for copy-on-write views of the shared table /values/.
+--
+-- Each target gets its own empty view that reads, measures, and iterates
+-- /values/ through `__index`, `__len`, and `__pairs`.  The first write to 
+-- a view, e.g. by `table.insert()`, copies /values/ into the view and 
+-- removes its metatable so that the write, and any after it, change only 
+-- that target's attributes.
+local function shared_attributes( values )
+    local shared_attributes_metatable = {
+        __index = values;
+        __len = function()
+            return #values;
+        end;
+        __pairs = function()
+            return next, values, nil;
+        end;
+        __newindex = function( view, key, value )
+            for copied_key, copied_value in pairs(values) do
+                rawset( view, copied_key, copied_value );
+            end
+            setmetatable( view, nil );
+            view[key] = value;
+        end;
+    };
+    shared_attributes_metatables[shared_attributes_metatable] = true;
+    return shared_attributes_metatable;
+end
+
 function PatternPrototype( identifier, replacement_modifier, pattern )
     local replacement_modifier = replacement_modifier or Toolset.interpolate;
     local pattern = pattern or '(.-([^\\/]-))%.?([^%.\\/]*)$';
@@ -293,11 +504,22 @@ function PatternPrototype( identifier, replacement_modifier, pattern )
         local targets_metatable = {
             __call = function( targets, dependencies )
                 local attributes = forge:merge( {}, dependencies );
+                local metatables = {};
+                for key, value in pairs(attributes) do
+                    if type(value) == 'table' then
+                        metatables[key] = shared_attributes( value );
+                    end
+                end
                 for _, filename in walk_tables(dependencies) do
                     local source_file = toolset:SourceFile( filename );
                     local identifier = root_relative( source_file ):gsub( pattern, replacement );
                     local target = toolset:File( identifier, pattern_prototype );
-                    forge:merge( target, attributes );
+                    local views = {};
+                    for key, value in pairs(attributes) do
+                        local metatable = metatables[key];
+                        views[key] = metatable and setmetatable( {}, metatable ) or value;
+                    end
+                    forge:merge( target, views );
                     local created = target.created;
                     if created then
                         created( toolset, target );
@@ -347,85 +569,31 @@ function GroupPrototype( identifier, replacement_modifier, pattern )
     return group_prototype;
 end
 
--- Recursively walk the tables passed in *dependencies* until reaching targets
--- or non-table values (e.g. strings) that are yielded back to the caller.
-function walk_tables( dependencies )
-    local function typename( value )
-        if type(value) == 'table' then 
-            local metatable = getmetatable( value );
-            return metatable and metatable.__name;
-        end
-    end
-
-    local index = 1;
-    local function walk( values )
-        for _, value in ipairs(values) do
-            if type(value) ~= 'table' or typename(value) == 'forge.Target' then
-                coroutine.yield( index, value );
-                index = index + 1;
-            else
-                walk( value );
-            end
-        end
-    end
-
-    return coroutine.wrap( function()
-        walk( dependencies );
-    end );
-end
-
--- Recursively walk the dependencies of *target* until a target with a 
--- filename is reached.
-function walk_dependencies( target )
-    local index = 1;
-    local function walk( target )
-        for _, dependency in target:dependencies() do 
-            local phony = dependency:filename() == '';
-            if not phony then
-                coroutine.yield( index, dependency );
-                index = index + 1;
-            end
-            if phony then 
-                walk( dependency );
-            end
-        end
-    end
-    return coroutine.wrap( function()
-        walk( target );
-    end );
-end
-
--- Recursively walk ordering dependencies using *yield* and *recurse* to
--- determine which targets to yield and/or recurse on.
-function walk_ordering_dependencies( target, yield, recurse )
-    local index = 1;
-    local yield = yield or function () return true end;
-    local walk = walk or function () return true end;
-    local function walk( target )
-        for _, dependency in target:ordering_dependencies() do
-            if yield(dependency) then
-                coroutine.yield( index, dependency );
-                index = index + 1;
-            end
-            if recurse(dependency) then
-                walk( dependency );
-            end
-        end
-    end
-    return coroutine.wrap( function()
-        walk( target, yield, walk );
-    end );
-end
+-- Walking nested tables of dependencies and the dependencies of targets is
+-- provided by `walk_tables()`, `walk_dependencies()`, and 
+-- `walk_ordering_dependencies()` natively (see `LuaGraph`).
 
 -- Merge fields with string keys from /source/ to /destination/.
+--
+-- Table fields are appended to the same field in /destination/.  Views of
+-- shared attribute tables from pattern prototypes are assigned by reference
+-- when /destination/ doesn't have that field yet and copy the shared table
+-- when they're first appended to.
 function forge:merge( destination, source )
     local destination = destination or {};
     for key, value in pairs(source) do
         if type(key) == 'string' then
             if type(value) == 'table' then
-                local values = destination[key] or {};
-                for _, other_value in ipairs(value) do 
-                    table.insert( values, other_value );
+                local values = destination[key];
+                if values == nil and shared_attributes_metatables[getmetatable(value)] then
+                    values = value;
+                else
+                    if values == nil then
+                        values = {};
+                    end
+                    for _, other_value in ipairs(value) do 
+                        table.insert( values, other_value );
+                    end
                 end
                 destination[key] = values;
             else
@@ -487,7 +655,7 @@ function forge:save()
                 file:write( ',\n' );
             end
             for k, v in pairs(value) do
-                if type(k) == 'string' and k ~= '__forge_hash' then
+                if type(k) == 'string' then
                     indent( level + 1 );
                     file:write( ('%s = '):format(k) );
                     serialize( file, v, level + 1 );
@@ -0,0 +1,378 @@
+//
+// LuaAllocator.cpp
+// Copyright (c) Charles Baker. All rights reserved.
+//
+
+#include "LuaAllocator.hpp"
+#include <assert/assert.hpp>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+using std::min;
+using std::max;
+using std::vector;
+using namespace sweet::luaxx;
+
+/**
+// Constructor.
+*/
+LuaAllocator::LuaAllocator()
+: chunks_(),
+  position_( nullptr ),
+  end_( nullptr ),
+  live_bytes_( 0 ),
+  peak_bytes_( 0 ),
+  allocations_( 0 ),
+  unpooled_bytes_( 0 ),
+  limit_( 0 ),
+  displaced_blocks_()
+{
+    memset( free_blocks_, 0, sizeof(free_blocks_) );
+    memset( size_classes_, 0, sizeof(size_classes_) );
+    for ( size_t i = 0; i < SIZE_CLASSES - 1; ++i )
+    {
+        size_classes_[i].size = (i + 1) * GRANULARITY;
+    }
+}
+
+/**
+// Destructor.
+//
+// Releases all of the chunks that pooled blocks were carved from.  The Lua
+// state that this allocator allocates for must have already been closed.
+*/
+LuaAllocator::~LuaAllocator()
+{
+    for ( vector<char*>::const_iterator i = chunks_.begin(); i != chunks_.end(); ++i )
+    {
+        free( *i );
+    }
+}
+
+/**
+// Get the number of bytes requested by live blocks.
+//
+// @return
+//  The number of bytes.
+*/
+size_t LuaAllocator::live_bytes() const
+{
+    return live_bytes_;
+}
+
+/**
+// Get the peak number of bytes requested by live blocks.
+//
+// @return
+//  The number of bytes.
+*/
+size_t LuaAllocator::peak_bytes() const
+{
+    return peak_bytes_;
+}
+
+/**
+// Get the number of bytes reserved in chunks for pooled blocks.
+//
+// @return
+//  The number of bytes.
+*/
+size_t LuaAllocator::reserved_bytes() const
+{
+    return chunks_.size() * CHUNK_SIZE;
+}
+
+/**
+// Get the total number of blocks allocated.
+//
+// @return
+//  The number of blocks.
+*/
+size_t LuaAllocator::allocations() const
+{
+    return allocations_;
+}
+
+/**
+// Limit the memory reserved from the system.
+//
+// Allocations that would take the chunks reserved for pooled blocks plus 
+// the bytes in live unpooled blocks over the limit fail.  Shrinking a block
+// never fails.
+//
+// @param limit
+//  The maximum number of bytes to reserve or 0 for no limit.
+*/
+void LuaAllocator::set_limit( size_t limit )
+{
+    limit_ = limit;
+}
+
+/**
+// Get the limit on the memory reserved from the system.
+//
+// @return
+//  The maximum number of bytes to reserve or 0 for no limit.
+*/
+size_t LuaAllocator::limit() const
+{
+    return limit_;
+}
+
+/**
+// Get the counters for a size class.
+//
+// @param index
+//  The index of the size class (the last size class, at `SIZE_CLASSES - 1`,
+//  counts unpooled blocks).
+//
+// @return
+//  The counters.
+*/
+const LuaAllocator::SizeClass& LuaAllocator::size_class( size_t index ) const
+{
+    SWEET_ASSERT( index < SIZE_CLASSES );
+    return size_classes_[index];
+}
+
+/**
+// Allocate, reallocate, or free a block of memory.
+//
+// @param ptr
+//  The address of any existing allocation to be reallocated or freed or null
+//  to allocate a new block of memory.
+//
+// @param osize
+//  The size of the existing block of memory when \e ptr isn't null 
+//  otherwise the type of object being allocated (ignored).
+//
+// @param nsize
+//  The size of the block of memory to allocate or 0 to free \e ptr.
+//
+// @return
+//  A pointer to the allocated memory or null if \e nsize is 0 or the 
+//  allocation failed.  Never null when \e ptr isn't null and \e nsize is
+//  greater than 0 and no larger than \e osize.
+*/
+void* LuaAllocator::reallocate( void* ptr, size_t osize, size_t nsize )
+{
+    if ( !ptr )
+    {
+        osize = 0;
+    }
+
+    size_t old_index = ptr ? block_index( ptr, osize ) : 0;
+    if ( nsize == 0 )
+    {
+        if ( ptr )
+        {
+            free_block( ptr, old_index );
+            count_free( old_index, osize );
+        }
+        return nullptr;
+    }
+
+    size_t new_index = size_class_index( nsize );
+    if ( ptr && old_index == new_index )
+    {
+        if ( !displaced_blocks_.empty() )
+        {
+            displaced_blocks_.erase( ptr );
+        }
+        if ( new_index == SIZE_CLASSES - 1 )
+        {
+            if ( nsize > osize && !reserve(nsize - osize) )
+            {
+                return nullptr;
+            }
+            void* block = realloc( ptr, nsize );
+            if ( block )
+            {
+                ptr = block;
+            }
+            else if ( nsize > osize )
+            {
+                return nullptr;
+            }
+            unpooled_bytes_ = unpooled_bytes_ - osize + nsize;
+        }
+        live_bytes_ = live_bytes_ - osize + nsize;
+        peak_bytes_ = max( peak_bytes_, live_bytes_ );
+        return ptr;
+    }
+
+    void* block = allocate_block( new_index, nsize );
+    if ( !block ) 
+    {
+        // Lua requires that shrinking a block never fails so keep the block
+        // in its current size class and remember that size class for when
+        // the block is next reallocated or freed.
+        if ( ptr && nsize <= osize )
+        {
+            displaced_blocks_[ptr] = old_index;
+            if ( old_index == SIZE_CLASSES - 1 )
+            {
+                unpooled_bytes_ -= osize - nsize;
+            }
+            live_bytes_ -= osize - nsize;
+            return ptr;
+        }
+        return nullptr;
+    }
+    count_allocation( new_index, nsize );
+    if ( ptr )
+    {
+        memcpy( block, ptr, min(osize, nsize) );
+        free_block( ptr, old_index );
+        count_free( old_index, osize );
+    }
+    return block;
+}
+
+/**
+// Allocate, reallocate, or free a block of memory on behalf of Lua.
+//
+// Matches the signature of `lua_Alloc` so that it can be passed to 
+// `lua_newstate()` with a LuaAllocator as its context.
+//
+// @param context
+//  The LuaAllocator to allocate with.
+//
+// @param ptr
+//  The address of any existing allocation to be reallocated or null to 
+//  allocate a new block of memory.
+// 
+// @param osize
+//  The old size of the memory block.
+// 
+// @param nsize
+//  The size of the memory block to allocate.
+// 
+// @return
+//  A pointer to the newly allocated memory.
+*/
+void* LuaAllocator::allocate( void* context, void* ptr, size_t osize, size_t nsize )
+{
+    SWEET_ASSERT( context );
+    LuaAllocator* allocator = reinterpret_cast<LuaAllocator*>( context );
+    return allocator->reallocate( ptr, osize, nsize );
+}
+
+size_t LuaAllocator::size_class_index( size_t size )
+{
+    if ( size == 0 )
+    {
+        return 0;
+    }
+    if ( size > MAXIMUM_POOLED_SIZE )
+    {
+        return SIZE_CLASSES - 1;
+    }
+    return (size + GRANULARITY - 1) / GRANULARITY - 1;
+}
+
+size_t LuaAllocator::block_index( void* ptr, size_t size ) const
+{
+    if ( !displaced_blocks_.empty() )
+    {
+        std::unordered_map<void*, size_t>::const_iterator i = displaced_blocks_.find( ptr );
+        if ( i != displaced_blocks_.end() )
+        {
+            return i->second;
+        }
+    }
+    return size_class_index( size );
+}
+
+bool LuaAllocator::reserve( size_t size ) const
+{
+    return limit_ == 0 || reserved_bytes() + unpooled_bytes_ + size <= limit_;
+}
+
+void* LuaAllocator::allocate_block( size_t index, size_t size )
+{
+    SWEET_ASSERT( index < SIZE_CLASSES );
+    const SizeClass& size_class = size_classes_[index];
+    if ( index == SIZE_CLASSES - 1 )
+    {
+        return reserve( size ) ? malloc( size ) : nullptr;
+    }
+
+    FreeBlock* free_block = free_blocks_[index];
+    if ( free_block )
+    {
+        free_blocks_[index] = free_block->next;
+        return free_block;
+    }
+
+    if ( size_t(end_ - position_) < size_class.size )
+    {
+        char* chunk = reserve( CHUNK_SIZE ) ? reinterpret_cast<char*>( malloc(CHUNK_SIZE) ) : nullptr;
+        if ( !chunk )
+        {
+            return nullptr;
+        }
+
+        // Put the remainder of the current chunk on the free list of the 
+        // size class that it exactly fits so that it isn't wasted.  Chunks
+        // and blocks are multiples of GRANULARITY so the remainder is too.
+        size_t remaining = size_t(end_ - position_);
+        if ( remaining >= GRANULARITY )
+        {
+            size_t remainder_index = size_class_index( remaining );
+            SWEET_ASSERT( size_classes_[remainder_index].size == remaining );
+            FreeBlock* remainder = reinterpret_cast<FreeBlock*>( position_ );
+            remainder->next = free_blocks_[remainder_index];
+            free_blocks_[remainder_index] = remainder;
+        }
+
+        chunks_.push_back( chunk );
+        position_ = chunk;
+        end_ = chunk + CHUNK_SIZE;
+    }
+
+    void* block = position_;
+    position_ += size_class.size;
+    return block;
+}
+
+void LuaAllocator::free_block( void* ptr, size_t index )
+{
+    SWEET_ASSERT( ptr );
+    SWEET_ASSERT( index < SIZE_CLASSES );
+    if ( !displaced_blocks_.empty() )
+    {
+        displaced_blocks_.erase( ptr );
+    }
+    if ( index == SIZE_CLASSES - 1 )
+    {
+        free( ptr );
+        return;
+    }
+    FreeBlock* free_block = reinterpret_cast<FreeBlock*>( ptr );
+    free_block->next = free_blocks_[index];
+    free_blocks_[index] = free_block;
+}
+
+void LuaAllocator::count_allocation( size_t index, size_t size )
+{
+    SizeClass& size_class = size_classes_[index];
+    ++size_class.live;
+    ++size_class.allocations;
+    size_class.peak = max( size_class.peak, size_class.live );
+    ++allocations_;
+    unpooled_bytes_ += index == SIZE_CLASSES - 1 ? size : 0;
+    live_bytes_ += size;
+    peak_bytes_ = max( peak_bytes_, live_bytes_ );
+}
+
+void LuaAllocator::count_free( size_t index, size_t size )
+{
+    SizeClass& size_class = size_classes_[index];
+    SWEET_ASSERT( size_class.live > 0 );
+    SWEET_ASSERT( live_bytes_ >= size );
+    --size_class.live;
+    unpooled_bytes_ -= index == SIZE_CLASSES - 1 ? size : 0;
+    live_bytes_ -= size;
+}
@@ -0,0 +1,100 @@
+#ifndef SWEET_LUAXX_LUAALLOCATOR_HPP_INCLUDED
+#define SWEET_LUAXX_LUAALLOCATOR_HPP_INCLUDED
+
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+namespace sweet
+{
+
+namespace luaxx
+{
+
+/**
+// A size-class pooled allocator for the Lua virtual machine.
+//
+// Blocks up to MAXIMUM_POOLED_SIZE bytes are rounded up to a multiple of 
+// GRANULARITY bytes and allocated from a free list per size class.  Free
+// lists are refilled by carving blocks out of CHUNK_SIZE byte chunks that
+// are only released when the allocator is destroyed.  Larger blocks are 
+// passed through to `realloc()` and `free()`.
+//
+// Lua always passes the size of the existing block when it frees or 
+// reallocates so no per block header is needed to recover the size class.
+// The exception is a block that shrinks into a smaller size class when no
+// block of that size class can be allocated.  Lua requires that shrinking
+// never fails so the block is kept where it is and its size class is
+// remembered until it is freed or moved.
+//
+// The memory reserved from the system, chunks and unpooled blocks, can be
+// limited so that allocations that would exceed the limit fail.
+//
+// Counters of live and peak bytes and of allocations per size class are
+// kept so that the memory used by the Lua heap can be reported.
+*/
+class LuaAllocator
+{
+public:
+    static const size_t GRANULARITY = 16; ///< The size of the smallest size class and the difference between size classes.
+    static const size_t MAXIMUM_POOLED_SIZE = 512; ///< The size of the largest pooled size class.
+    static const size_t SIZE_CLASSES = MAXIMUM_POOLED_SIZE / GRANULARITY + 1; ///< The number of size classes (the last size class counts unpooled blocks).
+    static const size_t CHUNK_SIZE = 64 * 1024; ///< The size of the chunks that pooled blocks are carved from.
+
+    /**
+    // Counters for a single size class.
+    */
+    struct SizeClass
+    {
+        size_t size; ///< The size of blocks in this size class (0 for unpooled blocks).
+        size_t live; ///< The number of live blocks in this size class.
+        size_t peak; ///< The peak number of live blocks in this size class.
+        size_t allocations; ///< The total number of blocks allocated in this size class.
+    };
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock* next; ///< The next free block in the same size class.
+    };
+
+    FreeBlock* free_blocks_ [SIZE_CLASSES]; ///< The free lists for each pooled size class.
+    SizeClass size_classes_ [SIZE_CLASSES]; ///< The counters for each size class.
+    std::vector<char*> chunks_; ///< The chunks that pooled blocks are carved from.
+    char* position_; ///< The position of the next block to carve from the current chunk.
+    char* end_; ///< The end of the current chunk.
+    size_t live_bytes_; ///< The number of bytes requested by live blocks.
+    size_t peak_bytes_; ///< The peak number of bytes requested by live blocks.
+    size_t allocations_; ///< The total number of blocks allocated.
+    size_t unpooled_bytes_; ///< The number of bytes in live unpooled blocks.
+    size_t limit_; ///< The maximum number of bytes reserved from the system or 0 for no limit.
+    std::unordered_map<void*, size_t> displaced_blocks_; ///< The size class index of blocks kept in a larger size class than their size after shrinking.
+
+public:
+    LuaAllocator();
+    ~LuaAllocator();
+    size_t live_bytes() const;
+    size_t peak_bytes() const;
+    size_t reserved_bytes() const;
+    size_t allocations() const;
+    void set_limit( size_t limit );
+    size_t limit() const;
+    const SizeClass& size_class( size_t index ) const;
+    void* reallocate( void* ptr, size_t osize, size_t nsize );
+    static void* allocate( void* context, void* ptr, size_t osize, size_t nsize );
+
+private:
+    static size_t size_class_index( size_t size );
+    size_t block_index( void* ptr, size_t size ) const;
+    bool reserve( size_t size ) const;
+    void* allocate_block( size_t index, size_t size );
+    void free_block( void* ptr, size_t index );
+    void count_allocation( size_t index, size_t size );
+    void count_free( size_t index, size_t size );
+};
+
+}
+
+}
+
+#endif
@@ -4,11 +4,13 @@
 //
 
 #include <luaxx/luaxx.hpp>
+#include <luaxx/LuaAllocator.hpp>
 #include <assert/assert.hpp>
 #include <lua.hpp>
 #include <algorithm>
 #include <string.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 using std::max;
 using namespace sweet::luaxx;
@@ -27,12 +29,14 @@ namespace luaxx
 {
 
 /** 
-// The keyword used to store the address of objects. 
+// The keyword whose address is used as the light userdata key that stores
+// the address of objects.
 */
 const char* THIS_KEYWORD = "__luaxx_this";
 
 /** 
-// The keyword used to store the type of an object.
+// The keyword whose address is used as the light userdata key that stores
+// the type of an object.
 */
 const char* TYPE_KEYWORD = "__luaxx_type";
 
@@ -41,15 +45,45 @@ const char* TYPE_KEYWORD = "__luaxx_type";
 */
 const char* WEAK_OBJECTS_KEYWORD = "__luaxx_weak_objects";
 
+/**
+// Report an error raised outside of any protected call and abort.
+//
+// @param lua_state
+//  The lua_State that the error was raised in.
+//
+// @return
+//  Never returns (Lua calls abort() when the panic function returns).
+*/
+static int luaxx_panic( lua_State* lua_state )
+{
+    const char* message = lua_tostring( lua_state, -1 );
+    fprintf( stderr, "PANIC: unprotected error in call to Lua API (%s)\n", message ? message : "error object is not a string" );
+    fflush( stderr );
+    return 0;
+}
+
 /**
 // Create a new, independent Lua state.
 //
+// @param allocator
+//  The LuaAllocator to allocate memory for the Lua state with or null to 
+//  use the standard allocator.  The allocator must outlive the Lua state.
+//
 // @return 
 //  The newly created lua_State.
 */
-lua_State* luaxx_newstate()
+lua_State* luaxx_newstate( LuaAllocator* allocator )
 {
-    lua_State* lua_state = luaL_newstate();
+    lua_State* lua_state = nullptr;
+    if ( allocator )
+    {
+        lua_state = lua_newstate( &LuaAllocator::allocate, allocator );
+        lua_atpanic( lua_state, &luaxx_panic );
+    }
+    else
+    {
+        lua_state = luaL_newstate();
+    }
     luaL_openlibs( lua_state );
 
     // Create the weak objects metatable and table.  The metatable is used to 
@@ -100,7 +134,7 @@ void luaxx_create( lua_State* lua, void* object, const char* tname )
 /**
 // Destroy the Lua object in \e lua identified by \e object.
 //
-// Sets the value of the field stored under the THIS_POINTER key to nil.
+// Sets the value of the field stored under the THIS_KEYWORD key to nil.
 // This stops the object being able to be used to refer back to an object
 // in C++ after that C++ object has been destroyed even though the Lua 
 // table will exist until it is garbage collected.
@@ -121,13 +155,11 @@ void luaxx_destroy( lua_State* lua, void* object )
     luaxx_push( lua, object );
     if ( lua_istable(lua, -1) )
     {
-        lua_pushstring( lua, THIS_KEYWORD );
         lua_pushnil( lua );
-        lua_rawset( lua, -3 );
+        lua_rawsetp( lua, -2, &THIS_KEYWORD );
 
-        lua_pushstring( lua, TYPE_KEYWORD );
         lua_pushnil( lua );
-        lua_rawset( lua, -3 );
+        lua_rawsetp( lua, -2, &TYPE_KEYWORD );
     }   
     lua_pop( lua, 1 );
     luaxx_detach( lua, object );
@@ -136,6 +168,12 @@ void luaxx_destroy( lua_State* lua, void* object )
 /**
 // Attach a C++ object to the Lua at the top of the stack.
 //
+// The address of the object and the address of \e tname are stored as 
+// light userdata values under light userdata keys (the addresses of 
+// THIS_KEYWORD and TYPE_KEYWORD) so that `luaxx_to()` can retrieve and 
+// type check objects with raw accesses and a pointer comparison.  Light 
+// userdata keys also can't be forged or accidentally overwritten from Lua.
+//
 // @param lua
 //  The lua_State to create the object in.
 //
@@ -143,7 +181,9 @@ void luaxx_destroy( lua_State* lua, void* object )
 //  The address to use to identify the object.
 //
 // @param tname
-//  The identifier that specifies the type of the object to attach to.
+//  The identifier that specifies the type of the object to attach to 
+//  (assumed to be a string with static storage duration, e.g. one of the
+//  type name constants in forge_lua/types.hpp).
 */
 void luaxx_attach( lua_State* lua, void* object, const char* tname )
 {
@@ -153,14 +193,12 @@ void luaxx_attach( lua_State* lua, void* object, const char* tname )
     SWEET_ASSERT( tname );
 
     // Set the this pointer stored in the Lua table to point to `object`.
-    lua_pushstring( lua, THIS_KEYWORD );
     lua_pushlightuserdata( lua, object );
-    lua_rawset( lua, -3 );
+    lua_rawsetp( lua, -2, &THIS_KEYWORD );
 
-    // Set the type stored in the Lua table to the value of `tname`.
-    lua_pushstring( lua, TYPE_KEYWORD );
-    lua_pushstring( lua, tname );
-    lua_rawset( lua, -3 );
+    // Set the type stored in the Lua table to the address of `tname`.
+    lua_pushlightuserdata( lua, const_cast<char*>(tname) );
+    lua_rawsetp( lua, -2, &TYPE_KEYWORD );
 
     // Store the Lua table in the registry accessed by `object`.
     lua_pushlightuserdata( lua, object );
@@ -420,29 +458,57 @@ bool luaxx_push( lua_State* lua, void* object )
 // @param tname
 //  The type to check that the object is (set luaL_newmetatable()).
 //
+// Tables that aren't attached to an object themselves but inherit from one
+// through a chain of `__index` tables, e.g. toolsets created by 
+// `Toolset:inherit()`, are converted to the first object found in that 
+// chain.
+//
 // @return
-//  The address of the object or null if there is no value at that position
-//  on the stack or if the value at that position is nil.
+//  The address of the object or null if the value at that position isn't
+//  a table, is a table that hasn't been attached to (or doesn't inherit 
+//  from) an object of type \e tname, or the object has been destroyed.
 */
 void* luaxx_to( lua_State* lua, int position, const char* tname )
 {
     SWEET_ASSERT( lua );
     SWEET_ASSERT( position > 0 || position < LUA_REGISTRYINDEX );
 
+    const int MAXIMUM_INDEX_DEPTH = 32;
+
+    // The type is almost always passed as the same constant that the object
+    // was attached with so a pointer comparison is enough.  Fall back to 
+    // comparing strings to allow for identical type names stored at 
+    // different addresses.
     void* object = nullptr;
-    if ( !lua_isnoneornil(lua, position) )
+    if ( lua_istable(lua, position) )
     {
-        lua_pushstring( lua, tname );
-        lua_pushstring( lua, TYPE_KEYWORD );
-        lua_gettable( lua, position );
-        if ( lua_rawequal(lua, -1, -2) )
+        lua_pushvalue( lua, position );
+        int depth = 0;
+        while ( lua_rawgetp(lua, -1, &TYPE_KEYWORD) == LUA_TNIL && depth < MAXIMUM_INDEX_DEPTH )
         {
-            lua_pushstring( lua, THIS_KEYWORD );
-            lua_gettable( lua, position );
-            if ( lua_islightuserdata(lua, -1) )
+            lua_pop( lua, 1 );
+            if ( !lua_getmetatable(lua, -1) )
+            {
+                lua_pushnil( lua );
+                break;
+            }
+            lua_pushstring( lua, "__index" );
+            lua_rawget( lua, -2 );
+            lua_remove( lua, -2 );
+            lua_remove( lua, -2 );
+            if ( !lua_istable(lua, -1) )
             {
-                object = lua_touserdata( lua, -1 );
+                lua_pushnil( lua );
+                break;
             }
+            ++depth;
+        }
+
+        const char* type = static_cast<const char*>( lua_touserdata(lua, -1) );
+        if ( type && (type == tname || strcmp(type, tname) == 0) )
+        {
+            lua_rawgetp( lua, -2, &THIS_KEYWORD );
+            object = lua_touserdata( lua, -1 );
             lua_pop( lua, 1 );
         }
         lua_pop( lua, 2 );
@@ -11,11 +11,13 @@ namespace sweet
 namespace luaxx
 {
 
+class LuaAllocator;
+
 extern const char* THIS_KEYWORD;
 extern const char* TYPE_KEYWORD;
 extern const char* WEAK_OBJECTS_KEYWORD;
 
-lua_State* luaxx_newstate();
+lua_State* luaxx_newstate( LuaAllocator* allocator = nullptr );
 void luaxx_create( lua_State* lua, void* object, const char* tname );
 void luaxx_destroy( lua_State* lua, void* object );
 void luaxx_attach( lua_State* lua, void* object, const char* tname );
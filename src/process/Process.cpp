@@ -9,9 +9,13 @@
 #include "Environment.hpp"
 #include "Error.hpp"
 #include <assert/assert.hpp>
+#include <chrono>
+#include <string.h>
 
 #if defined(BUILD_OS_WINDOWS)
 #include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
 #endif
 
 #if defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
@@ -23,12 +27,23 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/time.h>
+#include <sys/resource.h>
 #include <sys/syscall.h>
 #endif
 
 using std::vector;
 using namespace sweet::process;
 
+/**
+// Get the time from a monotonic clock in microseconds.
+*/
+static int64_t monotonic_microseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>( steady_clock::now().time_since_epoch() ).count();
+}
+
 #if defined(BUILD_OS_MACOS)
 extern char* const* environ;
 #endif
@@ -42,6 +57,9 @@ Process::Process()
   environment_( NULL ),
   start_suspended_( false ),
   inherit_environment_( false ),
+  pipes_(),
+  started_( 0 ),
+  usage_(),
 #if defined(BUILD_OS_WINDOWS)
   process_( INVALID_HANDLE_VALUE ),
   suspended_thread_( INVALID_HANDLE_VALUE )
@@ -192,6 +210,9 @@ void Process::run( const char* arguments )
     SWEET_ASSERT( executable_ );
     SWEET_ASSERT( arguments );
 
+    started_ = monotonic_microseconds();
+    memset( &usage_, 0, sizeof(usage_) );
+
 #if defined(BUILD_OS_WINDOWS)
     STARTUPINFO startup_info;
     memset( &startup_info, 0, sizeof(startup_info) );
@@ -490,14 +511,39 @@ void Process::wait()
         error::Error::format( ::GetLastError(), error, sizeof(error) );
         SWEET_ERROR( WaitForProcessFailedError("Waiting for a process failed - %s", error) );
     }
+    usage_.wall_time = monotonic_microseconds() - started_;
+
+    // File times are in 100 nanosecond intervals.
+    FILETIME creation_time, exit_time, kernel_time, user_time;
+    if ( ::GetProcessTimes(process_, &creation_time, &exit_time, &kernel_time, &user_time) )
+    {
+        usage_.user_time = int64_t((uint64_t(user_time.dwHighDateTime) << 32) | user_time.dwLowDateTime) / 10;
+        usage_.system_time = int64_t((uint64_t(kernel_time.dwHighDateTime) << 32) | kernel_time.dwLowDateTime) / 10;
+    }
+    PROCESS_MEMORY_COUNTERS memory_counters;
+    if ( ::GetProcessMemoryInfo(process_, &memory_counters, sizeof(memory_counters)) )
+    {
+        usage_.peak_memory = int64_t(memory_counters.PeakWorkingSetSize);
+    }
+    IO_COUNTERS io_counters;
+    if ( ::GetProcessIoCounters(process_, &io_counters) )
+    {
+        usage_.input_blocks = int64_t(io_counters.ReadOperationCount);
+        usage_.output_blocks = int64_t(io_counters.WriteOperationCount);
+    }
 
 #elif defined(BUILD_OS_MACOS) || defined(BUILD_OS_LINUX)
     SWEET_ASSERT( process_ != 0 );
 
-    pid_t result = waitpid( process_, &exit_code_, 0 );
+    // Wait with `wait4()` rather than `waitpid()` to collect the resources
+    // used by the process and any of its children that it waited for (e.g.
+    // the compiler proper run by a compiler driver).
+    struct rusage rusage;
+    memset( &rusage, 0, sizeof(rusage) );
+    pid_t result = wait4( process_, &exit_code_, 0, &rusage );
     while ( result < 0 && errno == EINTR )
     {
-        result = waitpid( process_, &exit_code_, 0 );
+        result = wait4( process_, &exit_code_, 0, &rusage );
     }
     if ( result != process_ )
     {
@@ -505,9 +551,32 @@ void Process::wait()
         SWEET_ERROR( WaitForProcessFailedError("Waiting for a process failed - %s", Error::format(errno, buffer, sizeof(buffer))) );
     }
     process_ = 0;
+
+    usage_.wall_time = monotonic_microseconds() - started_;
+    usage_.user_time = int64_t(rusage.ru_utime.tv_sec) * 1000000 + int64_t(rusage.ru_utime.tv_usec);
+    usage_.system_time = int64_t(rusage.ru_stime.tv_sec) * 1000000 + int64_t(rusage.ru_stime.tv_usec);
+#if defined(BUILD_OS_MACOS)
+    usage_.peak_memory = int64_t(rusage.ru_maxrss);
+#else
+    usage_.peak_memory = int64_t(rusage.ru_maxrss) * 1024;
+#endif
+    usage_.input_blocks = int64_t(rusage.ru_inblock);
+    usage_.output_blocks = int64_t(rusage.ru_oublock);
 #endif
 }
 
+/**
+// Get the resources used by this Process.
+//
+// @return
+//  The resources used by this Process and the processes that it waited 
+//  for or all zeros if this Process hasn't been waited for.
+*/
+const Usage& Process::usage() const
+{
+    return usage_;
+}
+
 /**
 // Get the exit code returned by this Process when it exited.
 //
@@ -1,6 +1,7 @@
 #ifndef SWEET_PROCESS_PROCESS_HPP_INCLUDED
 #define SWEET_PROCESS_PROCESS_HPP_INCLUDED
 
+#include "Usage.hpp"
 #include <build.hpp>
 #include <vector>
 #include <stdint.h>
@@ -44,6 +45,8 @@ class Process
     bool start_suspended_;
     bool inherit_environment_;
     std::vector<Pipe> pipes_;
+    int64_t started_; ///< The time that this Process was run in microseconds from an arbitrary, fixed point.
+    Usage usage_; ///< The resources used by this Process (valid after it has been waited for).
 
 #if defined(BUILD_OS_WINDOWS)
     void* process_; ///< The handle to this Process.
@@ -80,6 +83,7 @@ class Process
         void resume();
         void wait();
         int exit_code();
+        const Usage& usage() const;
 };
 
 }
@@ -0,0 +1,32 @@
+#ifndef SWEET_PROCESS_USAGE_HPP_INCLUDED
+#define SWEET_PROCESS_USAGE_HPP_INCLUDED
+
+#include <stdint.h>
+
+namespace sweet
+{
+
+namespace process
+{
+
+/**
+// The resources used by a process and the processes that it waited for.
+//
+// Block input and output are counted in blocks on Linux and macOS and in 
+// read and write operations on Windows.
+*/
+struct Usage
+{
+    int64_t wall_time; ///< The wall-clock time from running the process to it exiting in microseconds.
+    int64_t user_time; ///< The CPU time spent in user mode in microseconds.
+    int64_t system_time; ///< The CPU time spent in the kernel in microseconds.
+    int64_t peak_memory; ///< The peak resident set size in bytes.
+    int64_t input_blocks; ///< The number of block input operations.
+    int64_t output_blocks; ///< The number of block output operations.
+};
+
+}
+
+}
+
+#endif